@@ -0,0 +1,148 @@
+#include "AtmosphereTable.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+// Segment index and fraction in [0, 1] of an altitude, clamped to the table
+static inline int locate(double altitude, double minAltitude, double inverseStep, int last, double& t)
+{
+    double u = std::min(std::max((altitude - minAltitude) * inverseStep, 0.0), static_cast<double>(last + 1));
+    int i = std::min(static_cast<int>(u), last);
+    t = u - i;
+    return i;
+}
+
+static inline double horner(const double* c, double t)
+{
+    return ((c[3] * t + c[2]) * t + c[1]) * t + c[0];
+}
+
+
+AtmosphereTable::AtmosphereTable() : _intervals(0), _minAltitude(0.0), _step(0.0), _inverseStep(0.0)
+{
+}
+
+void AtmosphereTable::build(const std::function<AtmosphereSample(double)>& model, double minAltitude, double maxAltitude, double resolution)
+{
+    if (!(resolution > 0) || !(maxAltitude > minAltitude))
+    {
+        throw std::runtime_error("Error: Atmosphere table needs a positive resolution and an altitude range. resolution = " + std::to_string(resolution)
+            + ", range = " + std::to_string(minAltitude) + " to " + std::to_string(maxAltitude));
+    }
+
+    _intervals = static_cast<size_t>(std::ceil((maxAltitude - minAltitude) / resolution));
+    _minAltitude = minAltitude;
+    _step = (maxAltitude - minAltitude) / _intervals;
+    _inverseStep = 1.0 / _step;
+
+    // Values and slopes at the nodes. The end nodes use one-sided differences so the model is
+    // never evaluated outside the range, where it may not be defined.
+    const size_t nodes = _intervals + 1;
+    const double delta = 1e-3 * _step;
+
+    std::vector<AtmosphereSample> values(nodes), slopes(nodes);
+
+    for (size_t k = 0; k < nodes; k++)
+    {
+        double altitude = k == _intervals ? maxAltitude : minAltitude + k * _step;
+        values[k] = model(altitude);
+
+        AtmosphereSample a, b, c;
+        double wa, wb, wc;
+
+        if (k == 0)
+        {
+            a = values[k], b = model(altitude + delta), c = model(altitude + 2 * delta);
+            wa = -3, wb = 4, wc = -1;
+        }
+        else if (k == _intervals)
+        {
+            a = values[k], b = model(altitude - delta), c = model(altitude - 2 * delta);
+            wa = 3, wb = -4, wc = 1;
+        }
+        else
+        {
+            a = model(altitude + delta), b = model(altitude - delta);
+            wa = 1, wb = -1, wc = 0;
+        }
+
+        slopes[k].density = (wa * a.density + wb * b.density + wc * c.density) / (2 * delta);
+        slopes[k].temperature = (wa * a.temperature + wb * b.temperature + wc * c.temperature) / (2 * delta);
+        slopes[k].pressure = (wa * a.pressure + wb * b.pressure + wc * c.pressure) / (2 * delta);
+    }
+
+    // Hermite segment in the fraction t, with slopes scaled to the segment width
+    _coefficients.assign(STRIDE * _intervals, 0.0);
+
+    const double AtmosphereSample::* quantities[] = { &AtmosphereSample::density, &AtmosphereSample::temperature, &AtmosphereSample::pressure };
+    const int offsets[] = { DENSITY, TEMPERATURE, PRESSURE };
+
+    for (size_t k = 0; k < _intervals; k++)
+    {
+        for (int q = 0; q < 3; q++)
+        {
+            double p0 = values[k].*quantities[q];
+            double p1 = values[k + 1].*quantities[q];
+            double m0 = slopes[k].*quantities[q] * _step;
+            double m1 = slopes[k + 1].*quantities[q] * _step;
+
+            double* c = &_coefficients[STRIDE * k + offsets[q]];
+            c[0] = p0;
+            c[1] = m0;
+            c[2] = 3 * (p1 - p0) - 2 * m0 - m1;
+            c[3] = 2 * (p0 - p1) + m0 + m1;
+        }
+    }
+}
+
+double AtmosphereTable::getDensity(double altitude) const
+{
+    double t;
+    int i = locate(altitude, _minAltitude, _inverseStep, static_cast<int>(_intervals) - 1, t);
+    return std::max(horner(&_coefficients[STRIDE * i + DENSITY], t), 0.0);
+}
+
+AtmosphereSample AtmosphereTable::sample(double altitude) const
+{
+    double t;
+    int i = locate(altitude, _minAltitude, _inverseStep, static_cast<int>(_intervals) - 1, t);
+    const double* c = &_coefficients[STRIDE * i];
+
+    return AtmosphereSample(std::max(horner(c + DENSITY, t), 0.0), horner(c + TEMPERATURE, t), std::max(horner(c + PRESSURE, t), 0.0));
+}
+
+void AtmosphereTable::getDensities(const double* __restrict altitudes, double* __restrict densities, size_t count) const
+{
+    const double* __restrict coefficients = _coefficients.data();
+    const double minAltitude = _minAltitude;
+    const double inverseStep = _inverseStep;
+    const int last = static_cast<int>(_intervals) - 1;
+
+    for (size_t n = 0; n < count; n++)
+    {
+        double t;
+        int i = locate(altitudes[n], minAltitude, inverseStep, last, t);
+        densities[n] = std::max(horner(coefficients + STRIDE * i + DENSITY, t), 0.0);
+    }
+}
+
+void AtmosphereTable::sample(const double* __restrict altitudes, double* __restrict densities, double* __restrict temperatures, double* __restrict pressures, size_t count) const
+{
+    const double* __restrict coefficients = _coefficients.data();
+    const double minAltitude = _minAltitude;
+    const double inverseStep = _inverseStep;
+    const int last = static_cast<int>(_intervals) - 1;
+
+    for (size_t n = 0; n < count; n++)
+    {
+        double t;
+        int i = locate(altitudes[n], minAltitude, inverseStep, last, t);
+        const double* c = coefficients + STRIDE * i;
+
+        densities[n] = std::max(horner(c + DENSITY, t), 0.0);
+        temperatures[n] = horner(c + TEMPERATURE, t);
+        pressures[n] = std::max(horner(c + PRESSURE, t), 0.0);
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef ATMOSPHERETABLE_H
+#define ATMOSPHERETABLE_H
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+struct AtmosphereSample
+{
+    AtmosphereSample() : density(0.0), temperature(0.0), pressure(0.0) {}
+    AtmosphereSample(double _density, double _temperature, double _pressure) : density(_density), temperature(_temperature), pressure(_pressure) {}
+    ~AtmosphereSample() {}
+
+    double density;         // kg/m^3
+    double temperature;     // K
+    double pressure;        // Pa
+};
+
+
+// Density, temperature and pressure of an atmosphere model sampled on a uniform altitude grid and
+// interpolated with cubic Hermite segments, so a lookup is one index, one fraction and a Horner
+// polynomial instead of the model's pow() calls. Slopes at the nodes come from the model by
+// central differences.
+//
+// Error: on a segment of width h the interpolation error is at most h^4 / 384 * max|f''''|. For
+// the ISA troposphere at the default 100 m resolution the "atmosphere" benchmark checks a
+// relative density and pressure error below 1e-5 wherever the density is above 1e-6 of its sea
+// level value, and an absolute density error below 1e-10 kg/m^3 everywhere. Each halving of the
+// resolution cuts the error about 16 times. The relative error grows in the last few segments
+// below the ceiling, where the density goes to zero as a non-integer power; density and pressure
+// are clamped at zero there.
+//
+// Altitudes outside the table hold the value at the nearest end.
+class AtmosphereTable
+{
+    public:
+        AtmosphereTable();
+        ~AtmosphereTable() {}
+
+        // Samples `model` every `resolution` metres or less over [minAltitude, maxAltitude]
+        void build(const std::function<AtmosphereSample(double)>& model, double minAltitude, double maxAltitude, double resolution);
+
+        bool isBuilt() const { return _intervals > 0; }
+
+        double getDensity(double altitude) const;
+        AtmosphereSample sample(double altitude) const;
+
+        // Batch queries over contiguous arrays. The loops have no branches and vectorize.
+        void getDensities(const double* altitudes, double* densities, size_t count) const;
+        void sample(const double* altitudes, double* densities, double* temperatures, double* pressures, size_t count) const;
+
+        double getMinAltitude() const { return _minAltitude; }
+        double getMaxAltitude() const { return _minAltitude + _intervals * _step; }
+        double getStep() const { return _step; }
+        size_t getIntervalCount() const { return _intervals; }
+
+    protected:
+        // Coefficients c0..c3 of each quantity for one segment, next to each other so a lookup
+        // touches one or two cache lines
+        enum { DENSITY = 0, TEMPERATURE = 4, PRESSURE = 8, STRIDE = 12 };
+
+        size_t _intervals;
+        double _minAltitude;
+        double _step;
+        double _inverseStep;
+        std::vector<double> _coefficients;
+};
+
+#endif // ATMOSPHERETABLE_H
@@ -0,0 +1,211 @@
+#include "Attitude.h"
+
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+InertiaTensor InertiaTensor::inverse() const
+{
+    // Adjugate over determinant
+    double cxx = yy * zz - yz * yz;
+    double cxy = xz * yz - xy * zz;
+    double cxz = xy * yz - xz * yy;
+    double determinant = xx * cxx + xy * cxy + xz * cxz;
+
+    if (!(std::fabs(determinant) > 0))
+    {
+        throw std::runtime_error("Error: Inertia tensor is singular.");
+    }
+
+    double scale = 1.0 / determinant;
+    return InertiaTensor(cxx * scale, (xx * zz - xz * xz) * scale, (xx * yy - xy * xy) * scale,
+        cxy * scale, cxz * scale, (xy * xz - xx * yz) * scale);
+}
+
+// dw/dt from Euler's equations
+static inline Vector3<double> angularAcceleration(const Vector3<double>& rate, const InertiaTensor& inertia, const InertiaTensor& inverse, const Vector3<double>& torque)
+{
+    return inverse.apply(torque - rate.cross(inertia.apply(rate)));
+}
+
+// exp of a rotation vector as a quaternion. The series is evaluated at a quarter of the angle
+// and squared, which keeps it within 1e-12 up to 2 rad.
+static inline Quaternion<double> exponential(const Vector3<double>& rotation)
+{
+    Vector3<double> a = rotation * 0.25;
+    double t = a.magnitudeSquared();
+
+    double c = 1.0 - t / 2.0 * (1.0 - t / 12.0 * (1.0 - t / 30.0 * (1.0 - t / 56.0 * (1.0 - t / 90.0))));
+    double s = 1.0 - t / 6.0 * (1.0 - t / 20.0 * (1.0 - t / 42.0 * (1.0 - t / 72.0 * (1.0 - t / 110.0))));
+
+    double w = c * c - s * s * t;
+    double v = 2.0 * c * s;
+    return Quaternion<double>(w, a.x * v, a.y * v, a.z * v);
+}
+
+// The step shared by AttitudeDynamics and AttitudeFleet
+static inline void stepRigidBody(Quaternion<double>& attitude, Vector3<double>& rate, const InertiaTensor& inertia, const InertiaTensor& inverse,
+    const Vector3<double>& torque, double dt)
+{
+    const double h = dt;
+
+    Vector3<double> k1 = angularAcceleration(rate, inertia, inverse, torque);
+    Vector3<double> w2 = rate + k1 * (0.5 * h);
+    Vector3<double> k2 = angularAcceleration(w2, inertia, inverse, torque);
+    Vector3<double> w3 = rate + k2 * (0.5 * h);
+    Vector3<double> k3 = angularAcceleration(w3, inertia, inverse, torque);
+    Vector3<double> w4 = rate + k3 * h;
+    Vector3<double> k4 = angularAcceleration(w4, inertia, inverse, torque);
+    Vector3<double> next = rate + (k1 + (k2 + k3) * 2.0 + k4) * (h / 6.0);
+
+    // Rotation over the step: Simpson's rule on the rate plus the commutator term
+    Vector3<double> middle = (w2 + w3) * 0.5;
+    Vector3<double> rotation = (rate + middle * 4.0 + next) * (h / 6.0) + rate.cross(next) * (h * h / 12.0);
+
+    // The product is unit length to within rounding, so one Newton step for 1 / sqrt(n) from 1
+    // renormalises it exactly enough, without a square root in the loop
+    Quaternion<double> q = attitude * exponential(rotation);
+    double scale = 1.5 - 0.5 * (q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z);
+
+    attitude = Quaternion<double>(q.w * scale, q.x * scale, q.y * scale, q.z * scale);
+    rate = next;
+}
+
+void AttitudeDynamics::step(Quaternion<double>& attitude, Vector3<double>& rate, const InertiaTensor& inertia, const InertiaTensor& inverse,
+    const Vector3<double>& torque, double dt)
+{
+    stepRigidBody(attitude, rate, inertia, inverse, torque, dt);
+}
+
+size_t AttitudeFleet::add(const Quaternion<double>& attitude, const Vector3<double>& rate, const InertiaTensor& inertia)
+{
+    auto inverse = inertia.inverse();
+
+    _qw.push_back(attitude.w); _qx.push_back(attitude.x); _qy.push_back(attitude.y); _qz.push_back(attitude.z);
+    _wx.push_back(rate.x); _wy.push_back(rate.y); _wz.push_back(rate.z);
+    _tx.push_back(0.0); _ty.push_back(0.0); _tz.push_back(0.0);
+    _ixx.push_back(inertia.xx); _iyy.push_back(inertia.yy); _izz.push_back(inertia.zz);
+    _ixy.push_back(inertia.xy); _ixz.push_back(inertia.xz); _iyz.push_back(inertia.yz);
+    _jxx.push_back(inverse.xx); _jyy.push_back(inverse.yy); _jzz.push_back(inverse.zz);
+    _jxy.push_back(inverse.xy); _jxz.push_back(inverse.xz); _jyz.push_back(inverse.yz);
+
+    return _qw.size() - 1;
+}
+
+void AttitudeFleet::step(double dt, unsigned int threads)
+{
+    const size_t blocks = (size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+    parallelFor(blocks, threads, [this, dt](uint64_t block, unsigned int)
+    {
+        size_t begin = block * BLOCK_SIZE;
+        stepRange(begin, std::min(begin + BLOCK_SIZE, size()), dt);
+    });
+}
+
+void AttitudeFleet::stepRange(size_t begin, size_t end, double dt)
+{
+    // stepRigidBody written out component by component, in the same order of operations, so the
+    // loop has no objects or calls in it. The spacecraft go through in runs of a fixed length
+    // whose results land in local arrays first; locals cannot alias the inputs and the trip count
+    // is known, so the compiler is free to vectorise the loop over a run. The last few spacecraft,
+    // short of a run, take the scalar step, which gives the same results.
+    const size_t RUN = 16;
+    double outW[RUN], outX[RUN], outY[RUN], outZ[RUN], outRx[RUN], outRy[RUN], outRz[RUN];
+
+    const double h = dt, half = 0.5 * h, sixth = h / 6.0, twelfth = h * h / 12.0;
+
+    size_t run = begin;
+    for (; run + RUN <= end; run += RUN)
+    {
+        const double* qw = &_qw[run]; const double* qx = &_qx[run]; const double* qy = &_qy[run]; const double* qz = &_qz[run];
+        const double* wx = &_wx[run]; const double* wy = &_wy[run]; const double* wz = &_wz[run];
+        const double* tx = &_tx[run]; const double* ty = &_ty[run]; const double* tz = &_tz[run];
+        const double* ixx = &_ixx[run]; const double* iyy = &_iyy[run]; const double* izz = &_izz[run];
+        const double* ixy = &_ixy[run]; const double* ixz = &_ixz[run]; const double* iyz = &_iyz[run];
+        const double* jxx = &_jxx[run]; const double* jyy = &_jyy[run]; const double* jzz = &_jzz[run];
+        const double* jxy = &_jxy[run]; const double* jxz = &_jxz[run]; const double* jyz = &_jyz[run];
+
+        for (size_t i = 0; i < RUN; i++)
+        {
+            const double rx = wx[i], ry = wy[i], rz = wz[i];
+
+            const double Ixx = ixx[i], Iyy = iyy[i], Izz = izz[i], Ixy = ixy[i], Ixz = ixz[i], Iyz = iyz[i];
+            const double Jxx = jxx[i], Jyy = jyy[i], Jzz = jzz[i], Jxy = jxy[i], Jxz = jxz[i], Jyz = jyz[i];
+            const double Tx = tx[i], Ty = ty[i], Tz = tz[i];
+
+            // dw/dt = I^-1 (torque - w x (I w)) at (x, y, z)
+            double ax, ay, az;
+            auto rate = [&](double x, double y, double z)
+            {
+                double lx = Ixx * x + Ixy * y + Ixz * z;
+                double ly = Ixy * x + Iyy * y + Iyz * z;
+                double lz = Ixz * x + Iyz * y + Izz * z;
+
+                double mx = Tx - (y * lz - z * ly);
+                double my = Ty - (z * lx - x * lz);
+                double mz = Tz - (x * ly - y * lx);
+
+                ax = Jxx * mx + Jxy * my + Jxz * mz;
+                ay = Jxy * mx + Jyy * my + Jyz * mz;
+                az = Jxz * mx + Jyz * my + Jzz * mz;
+            };
+
+            rate(rx, ry, rz);
+            const double k1x = ax, k1y = ay, k1z = az;
+            const double w2x = rx + k1x * half, w2y = ry + k1y * half, w2z = rz + k1z * half;
+
+            rate(w2x, w2y, w2z);
+            const double k2x = ax, k2y = ay, k2z = az;
+            const double w3x = rx + k2x * half, w3y = ry + k2y * half, w3z = rz + k2z * half;
+
+            rate(w3x, w3y, w3z);
+            const double k3x = ax, k3y = ay, k3z = az;
+
+            rate(rx + k3x * h, ry + k3y * h, rz + k3z * h);
+            const double nx = rx + (k1x + (k2x + k3x) * 2.0 + ax) * sixth;
+            const double ny = ry + (k1y + (k2y + k3y) * 2.0 + ay) * sixth;
+            const double nz = rz + (k1z + (k2z + k3z) * 2.0 + az) * sixth;
+
+            // Rotation over the step, a quarter of it for the exponential series
+            const double mx = (w2x + w3x) * 0.5, my = (w2y + w3y) * 0.5, mz = (w2z + w3z) * 0.5;
+            const double ex = ((rx + mx * 4.0 + nx) * sixth + (ry * nz - rz * ny) * twelfth) * 0.25;
+            const double ey = ((ry + my * 4.0 + ny) * sixth + (rz * nx - rx * nz) * twelfth) * 0.25;
+            const double ez = ((rz + mz * 4.0 + nz) * sixth + (rx * ny - ry * nx) * twelfth) * 0.25;
+            const double t = ex * ex + ey * ey + ez * ez;
+
+            const double c = 1.0 - t / 2.0 * (1.0 - t / 12.0 * (1.0 - t / 30.0 * (1.0 - t / 56.0 * (1.0 - t / 90.0))));
+            const double s = 1.0 - t / 6.0 * (1.0 - t / 20.0 * (1.0 - t / 42.0 * (1.0 - t / 72.0 * (1.0 - t / 110.0))));
+            const double v = 2.0 * c * s;
+            const double dw = c * c - s * s * t, dx = ex * v, dy = ey * v, dz = ez * v;
+
+            // attitude * exp(rotation), renormalised by one Newton step
+            const double pw = qw[i], px = qx[i], py = qy[i], pz = qz[i];
+            const double ow = pw * dw - px * dx - py * dy - pz * dz;
+            const double ox = pw * dx + px * dw + py * dz - pz * dy;
+            const double oy = pw * dy - px * dz + py * dw + pz * dx;
+            const double oz = pw * dz + px * dy - py * dx + pz * dw;
+            const double scale = 1.5 - 0.5 * (ow * ow + ox * ox + oy * oy + oz * oz);
+
+            outW[i] = ow * scale; outX[i] = ox * scale; outY[i] = oy * scale; outZ[i] = oz * scale;
+            outRx[i] = nx; outRy[i] = ny; outRz[i] = nz;
+        }
+
+        std::copy(outW, outW + RUN, &_qw[run]); std::copy(outX, outX + RUN, &_qx[run]); std::copy(outY, outY + RUN, &_qy[run]); std::copy(outZ, outZ + RUN, &_qz[run]);
+        std::copy(outRx, outRx + RUN, &_wx[run]); std::copy(outRy, outRy + RUN, &_wy[run]); std::copy(outRz, outRz + RUN, &_wz[run]);
+    }
+
+    for (size_t i = run; i < end; i++)
+    {
+        Quaternion<double> attitude = getAttitude(i);
+        Vector3<double> rate = getRate(i);
+
+        stepRigidBody(attitude, rate, InertiaTensor(_ixx[i], _iyy[i], _izz[i], _ixy[i], _ixz[i], _iyz[i]), InertiaTensor(_jxx[i], _jyy[i], _jzz[i], _jxy[i], _jxz[i], _jyz[i]),
+            Vector3<double>(_tx[i], _ty[i], _tz[i]), dt);
+
+        _qw[i] = attitude.w; _qx[i] = attitude.x; _qy[i] = attitude.y; _qz[i] = attitude.z;
+        _wx[i] = rate.x; _wy[i] = rate.y; _wz[i] = rate.z;
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef ATTITUDE_H
+#define ATTITUDE_H
+
+#include "Quaternion.h"
+#include "Vector3.h"
+
+#include <cstddef>
+#include <vector>
+
+// Symmetric inertia tensor in the body frame, kg m^2
+struct InertiaTensor
+{
+    InertiaTensor() : xx(1), yy(1), zz(1), xy(0), xz(0), yz(0) {}
+    InertiaTensor(double xx, double yy, double zz, double xy = 0, double xz = 0, double yz = 0) : xx(xx), yy(yy), zz(zz), xy(xy), xz(xz), yz(yz) {}
+    ~InertiaTensor() {}
+
+    // A uniform cube, the stand-in when nothing better is known about a spacecraft
+    static InertiaTensor cube(double mass, double side) { double i = mass * side * side / 6.0; return InertiaTensor(i, i, i); }
+
+    Vector3<double> apply(const Vector3<double>& v) const
+    {
+        return Vector3<double>(xx * v.x + xy * v.y + xz * v.z, xy * v.x + yy * v.y + yz * v.z, xz * v.x + yz * v.y + zz * v.z);
+    }
+
+    // Throws if the tensor is singular
+    InertiaTensor inverse() const;
+
+    double xx, yy, zz, xy, xz, yz;
+};
+
+// Rigid body attitude. One step integrates the body rate with RK4 on Euler's equations,
+// I dw/dt = torque - w x (I w), and turns the attitude by the exponential of the rotation over
+// the step, so the quaternion is unit length by construction; it is renormalised only against
+// rounding. The rotation is Simpson's rule on the rate plus the first commutator term, third
+// order overall. The exponential is a polynomial rather than sin and cos so the batched kernel
+// has no calls in it; it is accurate to 1e-12 for turns of up to 2 rad a step.
+class AttitudeDynamics
+{
+    public:
+        // Torque in the body frame
+        static void step(Quaternion<double>& attitude, Vector3<double>& rate, const InertiaTensor& inertia, const InertiaTensor& inverse,
+            const Vector3<double>& torque, double dt);
+
+        // Rotational kinetic energy and angular momentum in the inertial frame; both are constant without torque
+        static double getEnergy(const Vector3<double>& rate, const InertiaTensor& inertia) { return 0.5 * rate.dot(inertia.apply(rate)); }
+        static Vector3<double> getMomentum(const Quaternion<double>& attitude, const Vector3<double>& rate, const InertiaTensor& inertia) { return attitude.rotate(inertia.apply(rate)); }
+};
+
+// Attitudes of a fleet as structure of arrays, stepped together by the same arithmetic as
+// AttitudeDynamics::step in a loop the compiler can vectorise. Blocks of spacecraft are spread
+// over threads.
+class AttitudeFleet
+{
+    public:
+        AttitudeFleet() {}
+        ~AttitudeFleet() {}
+
+        // Returns the spacecraft's index
+        size_t add(const Quaternion<double>& attitude, const Vector3<double>& rate, const InertiaTensor& inertia);
+        size_t size() const { return _qw.size(); }
+
+        void setTorque(size_t i, const Vector3<double>& torque) { _tx[i] = torque.x; _ty[i] = torque.y; _tz[i] = torque.z; }
+        Quaternion<double> getAttitude(size_t i) const { return Quaternion<double>(_qw[i], _qx[i], _qy[i], _qz[i]); }
+        Vector3<double> getRate(size_t i) const { return Vector3<double>(_wx[i], _wy[i], _wz[i]); }
+
+        void step(double dt, unsigned int threads = 1);
+
+    protected:
+        // Spacecraft per block handed to a thread
+        static const size_t BLOCK_SIZE = 1024;
+
+        void stepRange(size_t begin, size_t end, double dt);
+
+        std::vector<double> _qw, _qx, _qy, _qz;
+        std::vector<double> _wx, _wy, _wz;
+        std::vector<double> _tx, _ty, _tz;
+
+        // Inertia and its inverse, the six independent components each
+        std::vector<double> _ixx, _iyy, _izz, _ixy, _ixz, _iyz;
+        std::vector<double> _jxx, _jyy, _jzz, _jxy, _jxz, _jyz;
+};
+
+#endif // ATTITUDE_H
@@ -0,0 +1,1894 @@
+#include "Benchmark.h"
+
+#include "Attitude.h"
+#include "ConjunctionScreener.h"
+#include "Database.h"
+#include "Ephemeris.h"
+#include "FleetPropagator.h"
+#include "ForcePipeline.h"
+#include "ForceModel.h"
+#include "FrameTree.h"
+#include "KeplerPropagator.h"
+#include "Lambert.h"
+#include "Matrix.h"
+#include "Parallel.h"
+#include "Planet.h"
+#include "PID.h"
+#include "PIDBank.h"
+#include "Pipeline.h"
+#include "Porkchop.h"
+#include "Propulsion.h"
+#include "ProximityDetector.h"
+#include "PositionController.h"
+#include "Scenario.h"
+#include "Spacecraft.h"
+#include "System.h"
+#include "random_gen.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+// Keeps the optimizer from discarding a result
+static volatile double benchmarkSink = 0.0;
+
+// A time step the optimizer cannot fold into the code being timed
+static volatile double benchmarkStep = 1.0;
+
+// Accuracy checks failed by the benchmarks run so far
+static int benchmarkFailures = 0;
+
+// Records a failed accuracy check, which makes runBenchmarks return an error
+static void failBenchmark(const std::string& message)
+{
+    std::cerr << "Error: " << message << std::endl;
+    benchmarkFailures++;
+}
+
+double measureSeconds(const std::function<void()>& fn, uint64_t repetitions, int trials)
+{
+    double best = 0.0;
+
+    for (int trial = 0; trial < trials; trial++)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        for (uint64_t i = 0; i < repetitions; i++)
+        {
+            fn();
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / repetitions;
+        best = trial == 0 ? seconds : std::min(best, seconds);
+    }
+
+    return best;
+}
+
+void printBenchmark(const std::string& name, double secondsPerItem, double baselineSecondsPerItem)
+{
+    std::cout << "   " << std::left << std::setw(36) << name << std::right << std::fixed
+        << std::setw(12) << std::setprecision(2) << secondsPerItem * 1e9 << " ns"
+        << std::setw(10) << std::setprecision(2) << baselineSecondsPerItem / secondsPerItem << "x" << std::defaultfloat << std::setprecision(6) << std::endl;
+}
+
+
+// The hand written per-axis update the three controller classes used before they shared PID<>
+struct LegacyController
+{
+    LegacyController() : kp(0.1), ki(0.01), kd(0.001) {}
+
+    void update(double dt, Vector3<double> target, Vector3<double> current)
+    {
+        auto error = target - current;
+
+        double px = error.x * kp;
+        double py = error.y * kp;
+        double pz = error.z * kp;
+
+        integral.x += error.x * dt;
+        integral.y += error.y * dt;
+        integral.z += error.z * dt;
+
+        double ix = integral.x * ki;
+        double iy = integral.y * ki;
+        double iz = integral.z * ki;
+
+        double dx = (error.x - previousError.x) / dt * kd;
+        double dy = (error.y - previousError.y) / dt * kd;
+        double dz = (error.z - previousError.z) / dt * kd;
+
+        output.x = px + ix + dx;
+        output.y = py + iy + dy;
+        output.z = pz + iz + dz;
+
+        previousError = error;
+    }
+
+    double kp, ki, kd;
+    Vector3<double> output, integral, previousError;
+};
+
+// One step of `count` three axis controllers: the legacy objects, PID<> objects with runtime
+// and compile time gains, and one PIDBank holding every axis as a channel
+static void benchmarkPID(size_t count)
+{
+    // A constant step would let the inlined per-object updates drop the division the bank has to do
+    const double dt = benchmarkStep;
+    const int steps = 20;
+
+    auto random = makeRandomStream("benchmark", "pid");
+
+    // A few steps of errors so the integral and derivative terms are exercised
+    std::vector<std::vector<Vector3<double> > > errors(steps, std::vector<Vector3<double> >(count));
+    std::vector<std::vector<double> > flatErrors(steps, std::vector<double>(3 * count));
+
+    for (int s = 0; s < steps; s++)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            errors[s][i] = Vector3<double>(random.uniform(-1e3, 1e3), random.uniform(-1e3, 1e3), random.uniform(-1e3, 1e3));
+            flatErrors[s][3 * i] = errors[s][i].x;
+            flatErrors[s][3 * i + 1] = errors[s][i].y;
+            flatErrors[s][3 * i + 2] = errors[s][i].z;
+        }
+    }
+
+    std::vector<LegacyController> legacy(count);
+    std::vector<PositionController> controllers(count);
+    std::vector<VectorPID<double, StandardPolicy, ConstantGains<DefaultGainValues> > > constant(count);
+
+    PIDBank bank;
+    for (size_t i = 0; i < 3 * count; i++)
+    {
+        bank.add(0.1, 0.01, 0.001);
+    }
+
+    Vector3<double> zero;
+    uint64_t repetitions = std::max<uint64_t>(1, 2000000 / (count * steps));
+
+    double legacyTime = measureSeconds([&]()
+    {
+        for (int s = 0; s < steps; s++)
+            for (size_t i = 0; i < count; i++)
+                legacy[i].update(dt, errors[s][i], zero);
+        benchmarkSink = legacy[count - 1].output.x;
+    }, repetitions) / (count * steps);
+
+    double runtimeTime = measureSeconds([&]()
+    {
+        for (int s = 0; s < steps; s++)
+            for (size_t i = 0; i < count; i++)
+                controllers[i].update(dt, errors[s][i], zero);
+        benchmarkSink = controllers[count - 1].getOutputValues()[0];
+    }, repetitions) / (count * steps);
+
+    double constantTime = measureSeconds([&]()
+    {
+        for (int s = 0; s < steps; s++)
+            for (size_t i = 0; i < count; i++)
+                constant[i].update(dt, errors[s][i], zero);
+        benchmarkSink = constant[count - 1].getOutputValues()[0];
+    }, repetitions) / (count * steps);
+
+    double bankTime = measureSeconds([&]()
+    {
+        for (int s = 0; s < steps; s++)
+            bank.update(dt, flatErrors[s].data());
+        benchmarkSink = bank.getOutput(0);
+    }, repetitions) / (count * steps);
+
+    // Every variant ran the same error sequence the same number of times, so outputs must agree
+    double maxDifference = 0.0;
+    for (size_t i = 0; i < count; i++)
+    {
+        auto reference = legacy[i].output;
+        auto output = controllers[i].getOutput();
+        auto constantOutput = constant[i].getOutput();
+
+        for (int k = 0; k < 3; k++)
+        {
+            double r = k == 0 ? reference.x : (k == 1 ? reference.y : reference.z);
+            double o = k == 0 ? output.x : (k == 1 ? output.y : output.z);
+            double c = k == 0 ? constantOutput.x : (k == 1 ? constantOutput.y : constantOutput.z);
+            double b = bank.getOutput(3 * i + k);
+
+            double scale = std::max(1.0, std::fabs(r));
+            maxDifference = std::max(maxDifference, std::max(std::fabs(o - r), std::max(std::fabs(c - r), std::fabs(b - r))) / scale);
+        }
+    }
+
+    std::cout << " - PID update, " << count << " three axis controllers (time per controller update):" << std::endl;
+    printBenchmark("hand written per object", legacyTime, legacyTime);
+    printBenchmark("PID<3, double> runtime gains", runtimeTime, legacyTime);
+    printBenchmark("PID<3, double> constexpr gains", constantTime, legacyTime);
+    printBenchmark("PIDBank SoA", bankTime, legacyTime);
+    std::cout << "   max relative difference from hand written: " << maxDifference << std::endl;
+}
+
+static void benchmarkPIDs(Scenario*)
+{
+    benchmarkPID(10);
+    benchmarkPID(1000);
+    benchmarkPID(100000);
+}
+
+
+// The gravity kernel with the magnitude computed twice, as Planet did, and once through
+// normalizeAndMagnitude
+static void benchmarkVector(Scenario*)
+{
+    const size_t count = 100000;
+    const double mu = 3.986e14;
+
+    auto random = makeRandomStream("benchmark", "vector");
+
+    std::vector<Vector3<double> > p(count), twice(count), once(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        p[i] = Vector3<double>(random.uniform(-7e6, 7e6), random.uniform(-7e6, 7e6), random.uniform(-7e6, 7e6));
+    }
+
+    double twiceTime = measureSeconds([&]()
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            double distance = p[i].magnitude();
+            twice[i] = distance == 0 ? Vector3<double>() : p[i].normalize() * (-mu / (distance * distance));
+        }
+        benchmarkSink = twice[count - 1].x;
+    }, 20) / count;
+
+    double onceTime = measureSeconds([&]()
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            double distance;
+            auto direction = p[i].normalizeAndMagnitude(distance);
+            once[i] = distance == 0 ? Vector3<double>() : direction * (-mu / (distance * distance));
+        }
+        benchmarkSink = once[count - 1].x;
+    }, 20) / count;
+
+    double gravityDifference = 0.0;
+    for (size_t i = 0; i < count; i++)
+    {
+        gravityDifference = std::max(gravityDifference, (twice[i] - once[i]).magnitude());
+    }
+
+    std::cout << " - Gravity acceleration, " << count << " positions (time per position):" << std::endl;
+    printBenchmark("magnitude() + normalize()", twiceTime, twiceTime);
+    printBenchmark("normalizeAndMagnitude()", onceTime, twiceTime);
+    std::cout << "   max difference: " << gravityDifference << std::endl;
+}
+
+
+// Ballistic fleets in the mission's home system propagated with float far field storage and all
+// in double, then the float run's position error against the double run
+static void benchmarkFleetSize(Scenario* scenario, size_t count, int steps)
+{
+    auto system = scenario->getSystems().at(scenario->getMission().homeSystem);
+
+    FleetSettings doubleSettings;
+    doubleSettings.mixedPrecision = false;
+
+    FleetPropagator mixed(system);
+    FleetPropagator reference(system, doubleSettings);
+
+    auto random = makeRandomStream("benchmark", "fleet");
+    auto origin = mixed.getOrigin();
+
+    for (size_t i = 0; i < count; i++)
+    {
+        Vector3<double> offset(random.uniform(-1e6, 1e6), random.uniform(-1e6, 1e6), random.uniform(-1e6, 1e6));
+        Vector3<double> velocity(random.uniform(-500, 500), random.uniform(-500, 500), random.uniform(-500, 500));
+
+        mixed.add(origin + offset, velocity);
+        reference.add(origin + offset, velocity);
+    }
+
+    uint64_t mixedEvents = 0;
+    uint64_t referenceEvents = 0;
+    mixed.getEventDetector().registerCallback([&mixedEvents](const SimulationEvent&) { mixedEvents++; });
+    reference.getEventDetector().registerCallback([&referenceEvents](const SimulationEvent&) { referenceEvents++; });
+
+    double mixedTime = measureSeconds([&]() { mixed.step(1.0); }, steps, 1) / count;
+    double referenceTime = measureSeconds([&]() { reference.step(1.0); }, steps, 1) / count;
+
+    auto accuracy = mixed.compare(reference);
+
+    std::cout << " - Fleet of " << count << " for " << steps << " steps (time per spacecraft step):" << std::endl;
+    printBenchmark("all double", referenceTime, referenceTime);
+    printBenchmark("float far field, double near planets", mixedTime, referenceTime);
+    std::cout << "   in float at the end: " << mixed.getFloatCount() << " of " << count
+        << ", promotions " << accuracy.promotions << ", demotions " << accuracy.demotions << std::endl;
+    std::cout << "   position error vs all double: max " << accuracy.maxError << " m, mean " << accuracy.meanError
+        << " m, max relative " << accuracy.maxRelativeError << std::endl;
+    std::cout << "   surface contacts: " << mixedEvents << " mixed, " << referenceEvents << " all double" << std::endl;
+}
+
+static void benchmarkFleet(Scenario* scenario)
+{
+    benchmarkFleetSize(scenario, 1000, 1000);
+    benchmarkFleetSize(scenario, 100000, 100);
+}
+
+
+// Analytic ISA model against the home planet's atmosphere tables: time per altitude, then the
+// table error over the whole troposphere at a few resolutions
+static void benchmarkAtmosphere(Scenario* scenario)
+{
+    const size_t count = 100000;
+    const size_t checks = 1000000;
+    const double ceiling = Planet::getAtmosphereCeiling();
+
+    Planet planet = *scenario->findPlanet(scenario->getMission().homePlanet);
+    if (!planet.getAtmosphereTable().isBuilt())
+    {
+        planet.buildAtmosphereTable(100.0);
+    }
+    const auto& table = planet.getAtmosphereTable();
+
+    auto random = makeRandomStream("benchmark", "atmosphere");
+
+    std::vector<double> altitudes(count), densities(count), temperatures(count), pressures(count);
+    for (auto& altitude : altitudes)
+    {
+        altitude = random.uniform(0, ceiling);
+    }
+
+    double analyticTime = measureSeconds([&]()
+    {
+        for (size_t i = 0; i < count; i++)
+            densities[i] = planet.calcAirDensity(altitudes[i]);
+        benchmarkSink = densities[count - 1];
+    }, 20) / count;
+
+    double scalarTime = measureSeconds([&]()
+    {
+        for (size_t i = 0; i < count; i++)
+            densities[i] = table.getDensity(altitudes[i]);
+        benchmarkSink = densities[count - 1];
+    }, 20) / count;
+
+    double batchTime = measureSeconds([&]()
+    {
+        table.getDensities(altitudes.data(), densities.data(), count);
+        benchmarkSink = densities[count - 1];
+    }, 20) / count;
+
+    double analyticSampleTime = measureSeconds([&]()
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            densities[i] = planet.calcAirDensity(altitudes[i]);
+            temperatures[i] = planet.calcAirTemperature(altitudes[i]);
+            pressures[i] = planet.calcAirPressure(altitudes[i]);
+        }
+        benchmarkSink = densities[count - 1] + temperatures[count - 1] + pressures[count - 1];
+    }, 20) / count;
+
+    double batchSampleTime = measureSeconds([&]()
+    {
+        table.sample(altitudes.data(), densities.data(), temperatures.data(), pressures.data(), count);
+        benchmarkSink = densities[count - 1] + temperatures[count - 1] + pressures[count - 1];
+    }, 20) / count;
+
+    std::cout << " - Air density, " << count << " altitudes, " << table.getStep() << " m table (time per altitude):" << std::endl;
+    printBenchmark("calcAirDensity", analyticTime, analyticTime);
+    printBenchmark("table getDensity", scalarTime, analyticTime);
+    printBenchmark("table getDensities batch", batchTime, analyticTime);
+    std::cout << " - Density, temperature and pressure (time per altitude):" << std::endl;
+    printBenchmark("analytic", analyticSampleTime, analyticSampleTime);
+    printBenchmark("table sample batch", batchSampleTime, analyticSampleTime);
+
+    // Error against the analytic model. Relative errors are taken where the density is above
+    // 1e-6 of sea level; above that the density goes to zero and only the absolute error means much.
+    const double seaLevelDensity = planet.calcAirDensity(0.0);
+
+    std::cout << " - Table error over " << checks << " altitudes from 0 to " << static_cast<int>(ceiling) << " m:" << std::endl;
+
+    for (double resolution : { 1000.0, 100.0, 10.0 })
+    {
+        Planet tabulated = planet;
+        tabulated.buildAtmosphereTable(resolution);
+        const auto& check = tabulated.getAtmosphereTable();
+
+        double densityError = 0.0, densityRelative = 0.0, pressureRelative = 0.0, temperatureError = 0.0;
+
+        for (size_t i = 0; i < checks; i++)
+        {
+            double altitude = ceiling * i / (checks - 1);
+            auto sample = check.sample(altitude);
+
+            double density = planet.calcAirDensity(altitude);
+            double pressure = planet.calcAirPressure(altitude);
+
+            densityError = std::max(densityError, std::fabs(sample.density - density));
+            temperatureError = std::max(temperatureError, std::fabs(sample.temperature - planet.calcAirTemperature(altitude)));
+
+            if (density > 1e-6 * seaLevelDensity)
+            {
+                densityRelative = std::max(densityRelative, std::fabs(sample.density - density) / density);
+                pressureRelative = std::max(pressureRelative, std::fabs(sample.pressure - pressure) / pressure);
+            }
+        }
+
+        std::cout << "   " << std::setw(6) << static_cast<int>(resolution) << " m: density max " << densityError << " kg/m^3, relative " << densityRelative
+            << "; pressure relative " << pressureRelative << "; temperature max " << temperatureError << " K";
+
+        // The bound documented in AtmosphereTable.h
+        bool within = resolution != 100.0 || (densityError < 1e-10 && densityRelative < 1e-5 && pressureRelative < 1e-5);
+
+        if (resolution == 100.0)
+        {
+            std::cout << (within ? " (within documented bound)" : " (EXCEEDS documented bound)");
+        }
+
+        std::cout << std::endl;
+
+        if (!within)
+        {
+            failBenchmark("The 100 m atmosphere table exceeds the error bound documented in AtmosphereTable.h.");
+        }
+    }
+}
+
+
+// Gravity, limited drag and thrust for spacecraft spread through the home planet's atmosphere,
+// one at a time through the Planet methods and batched
+static void benchmarkForces(Scenario* scenario)
+{
+    auto planet = scenario->findPlanet(scenario->getMission().homePlanet);
+    const auto& nominal = scenario->getSpacecraftInitData().front();
+    const auto center = planet->getCenterPosition();
+
+    ForceModel model(planet);
+
+    std::cout << " - Gravity + drag + thrust at " << planet->getName() << " (time per spacecraft):" << std::endl;
+
+    for (size_t count : { 1000, 10000, 100000, 1000000 })
+    {
+        auto random = makeRandomStream("benchmark", "forces");
+
+        ForceBatch batch;
+        for (size_t i = 0; i < count; i++)
+        {
+            auto direction = Vector3<double>(random.uniform(-1, 1), random.uniform(-1, 1), random.uniform(-1, 1)).normalize();
+            double altitude = random.uniform(0, 1.2 * Planet::getAtmosphereCeiling());
+
+            batch.push(center + direction * (planet->getRadius() + altitude),
+                Vector3<double>(random.uniform(-2000, 2000), random.uniform(-2000, 2000), random.uniform(-2000, 2000)),
+                Vector3<double>(random.uniform(-1e4, 1e4), random.uniform(-1e4, 1e4), random.uniform(-1e4, 1e4)),
+                nominal.area * random.uniform(0.5, 1.5), nominal.mass * random.uniform(0.5, 1.5), nominal.maxVelocity);
+        }
+
+        uint64_t repetitions = std::max<uint64_t>(1, 1000000 / count);
+
+        double scalarTime = measureSeconds([&]() { model.evaluateScalar(batch); benchmarkSink = batch.ax[count - 1]; }, repetitions, 3) / count;
+        auto expected = batch;
+
+        double batchTime = measureSeconds([&]() { model.evaluate(batch); benchmarkSink = batch.ax[count - 1]; }, repetitions, 3) / count;
+
+        double difference = 0.0;
+        for (size_t i = 0; i < count; i++)
+        {
+            double magnitude = std::max(expected.acceleration(i).magnitude(), 1e-300);
+            difference = std::max(difference, (batch.acceleration(i) - expected.acceleration(i)).magnitude() / magnitude);
+        }
+
+        std::cout << "   " << count << " spacecraft, max relative difference " << difference << std::endl;
+        printBenchmark("Planet methods per spacecraft", scalarTime, scalarTime);
+        printBenchmark("ForceModel batch", batchTime, scalarTime);
+    }
+}
+
+
+// Every pair tested, what the grid has to match
+static std::vector<ProximityDetector::Pair> bruteForcePairs(size_t count, double threshold,
+    const std::vector<double>& x0, const std::vector<double>& y0, const std::vector<double>& z0,
+    const std::vector<double>& x1, const std::vector<double>& y1, const std::vector<double>& z1)
+{
+    std::vector<ProximityDetector::Pair> pairs;
+
+    for (uint32_t a = 0; a < count; a++)
+    {
+        Vector3<double> a0(x0[a], y0[a], z0[a]), a1(x1[a], y1[a], z1[a]);
+
+        for (uint32_t b = a + 1; b < count; b++)
+        {
+            double fraction;
+            if (ProximityDetector::closestApproach(a0, a1, Vector3<double>(x0[b], y0[b], z0[b]), Vector3<double>(x1[b], y1[b], z1[b]), fraction) <= threshold)
+            {
+                pairs.push_back(ProximityDetector::Pair(a, b));
+            }
+        }
+    }
+
+    return pairs;
+}
+
+// Fleets drifting in a box at one spacecraft per 10 km cube, stepped with the proximity detector.
+// The last step is checked against testing every pair. The events of the smallest fleet are
+// logged to proximity_events.
+static void benchmarkProximity(Scenario* scenario)
+{
+    const int steps = 20;
+    const double dt = 10.0;
+    const double speed = 100.0;
+
+    ProximitySettings settings;
+    std::cout << " - Close approaches within " << settings.threshold << " m, collisions within " << settings.collisionDistance
+        << " m, " << steps << " steps of " << dt << " s (time per spacecraft per step):" << std::endl;
+
+    for (size_t count : { 1000, 10000, 100000 })
+    {
+        auto random = makeRandomStream("benchmark", "proximity");
+        const double side = 10000.0 * std::cbrt(static_cast<double>(count));
+
+        std::vector<double> x0(count), y0(count), z0(count), x1(count), y1(count), z1(count), vx(count), vy(count), vz(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            x0[i] = random.uniform(0, side);
+            y0[i] = random.uniform(0, side);
+            z0[i] = random.uniform(0, side);
+            vx[i] = random.uniform(-speed, speed);
+            vy[i] = random.uniform(-speed, speed);
+            vz[i] = random.uniform(-speed, speed);
+        }
+
+        ProximityDetector detector(settings);
+        uint64_t events[3] = { 0, 0, 0 };
+        uint64_t candidates = 0;
+        double seconds = 0.0;
+        bool logged = count == 1000 && scenario->getDatabase();
+
+        for (int step = 0; step < steps; step++)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                x1[i] = x0[i] + vx[i] * dt;
+                y1[i] = y0[i] + vy[i] * dt;
+                z1[i] = z0[i] + vz[i] * dt;
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            const auto& stepEvents = detector.update(step * dt, dt, count, x0.data(), y0.data(), z0.data(), x1.data(), y1.data(), z1.data());
+            seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            candidates += detector.getCandidateCount();
+            for (const auto& event : stepEvents)
+            {
+                events[static_cast<int>(event.type)]++;
+
+                if (logged)
+                {
+                    scenario->getDatabase()->logProximityEvent(event, "fleet " + std::to_string(event.a), "fleet " + std::to_string(event.b));
+                }
+            }
+
+            if (step + 1 < steps)
+            {
+                x0.swap(x1);
+                y0.swap(y1);
+                z0.swap(z1);
+            }
+        }
+
+        double gridTime = seconds / (steps * count);
+
+        std::cout << "   " << count << " spacecraft: " << detector.getCellCount() << " cells, "
+            << static_cast<double>(candidates) / steps << " candidates per step, "
+            << events[0] << " close approaches, " << events[1] << " collisions, " << events[2] << " separations" << std::endl;
+
+        if (count > 10000)
+        {
+            printBenchmark("hash grid", gridTime, gridTime);
+            continue;
+        }
+
+        std::vector<ProximityDetector::Pair> expected;
+        double bruteTime = measureSeconds([&]() { expected = bruteForcePairs(count, settings.threshold, x0, y0, z0, x1, y1, z1); }, 1, 1) / count;
+
+        std::cout << "   last step pairs " << detector.getActivePairs().size() << ", every pair tested " << expected.size()
+            << (expected == detector.getActivePairs() ? ", identical" : ", DIFFERENT") << std::endl;
+        printBenchmark("every pair", bruteTime, bruteTime);
+        printBenchmark("hash grid", gridTime, bruteTime);
+    }
+}
+
+
+// A random orbit around a planet with radius between lowest and highest, as a state at a random anomaly
+static ScreeningObject randomOrbit(RandomStream& random, uint32_t id, double mu, double lowest, double highest, double maxEccentricity)
+{
+    const double TWO_PI = 2.0 * 3.14159265358979323846;
+
+    double eccentricity = random.uniform(0, maxEccentricity);
+    double periapsis = random.uniform(lowest, highest * (1.0 - eccentricity) / (1.0 + eccentricity));
+    double p = periapsis * (1.0 + eccentricity);
+    double anomaly = random.uniform(0, TWO_PI);
+
+    auto normal = Vector3<double>(random.uniform(-1, 1), random.uniform(-1, 1), random.uniform(-1, 1)).normalize();
+    auto toward = normal.cross(Vector3<double>(random.uniform(-1, 1), random.uniform(-1, 1), random.uniform(-1, 1))).normalize();
+    auto lateral = normal.cross(toward);
+
+    double r = p / (1.0 + eccentricity * std::cos(anomaly));
+    double speed = std::sqrt(mu / p);
+
+    return ScreeningObject(id, (toward * std::cos(anomaly) + lateral * std::sin(anomaly)) * r,
+        (toward * -std::sin(anomaly) + lateral * (eccentricity + std::cos(anomaly))) * speed);
+}
+
+// One spacecraft screened against debris catalogs in a band around the home planet, over one
+// orbit. A few objects are planted to pass the spacecraft at known times. The 10k catalog is
+// checked against searching every pair without the filters.
+static void benchmarkConjunctions(Scenario* scenario)
+{
+    const int planted = 5;
+
+    auto planet = scenario->findPlanet(scenario->getMission().homePlanet);
+    const double mu = planet->getGravititationParameter();
+    const double radius = planet->getRadius();
+
+    auto random = makeRandomStream("benchmark", "conjunctions");
+
+    // Circular at 1.4 radii, 50 degrees inclined
+    const double orbit = 1.4 * radius;
+    const double inclination = 50.0 * 3.14159265358979323846 / 180.0;
+    const double period = 2.0 * 3.14159265358979323846 * std::sqrt(orbit * orbit * orbit / mu);
+
+    ScreeningObject spacecraft(0, Vector3<double>(orbit, 0, 0), Vector3<double>(0, std::cos(inclination), std::sin(inclination)) * std::sqrt(mu / orbit));
+
+    ConjunctionSettings settings;
+    settings.threshold = 1e-3 * radius;
+    settings.padding = 2e-3 * radius;
+    settings.timePadding = 0.005 * period;
+    settings.duration = period;
+    settings.step = period / 300;
+
+    ConjunctionScreener screener(planet, settings);
+
+    // Planted objects: the spacecraft's state at the encounter, offset and turned 60 degrees about
+    // the radius, integrated back to the start
+    std::vector<ScreeningObject> plants;
+    for (int i = 0; i < planted; i++)
+    {
+        double encounter = (i + 0.5) * settings.duration / planted;
+        auto position = spacecraft.position, velocity = spacecraft.velocity;
+        size_t steps = static_cast<size_t>(encounter / settings.step);
+
+        for (size_t k = 0; k < steps; k++)
+            screener.propagate(position, velocity, settings.step);
+        screener.propagate(position, velocity, encounter - steps * settings.step);
+
+        auto up = position.normalize();
+        auto along = velocity.normalize();
+        auto across = up.cross(along);
+        double speed = velocity.magnitude();
+
+        position = position + across * (0.2 * (i + 1) * settings.threshold / planted);
+        velocity = (along * 0.5 + across * std::sqrt(0.75)) * speed;
+
+        for (size_t k = 0; k < steps; k++)
+            screener.propagate(position, velocity, -settings.step);
+        screener.propagate(position, velocity, -(encounter - steps * settings.step));
+
+        plants.push_back(ScreeningObject(1 + i, position, velocity));
+    }
+
+    std::cout << " - One spacecraft at " << orbit / radius << " radii over one orbit, debris between 1.2 and 1.6 radii, miss distance below "
+        << settings.threshold << " m" << std::endl;
+
+    for (size_t count : { 10000, 100000, 1000000 })
+    {
+        std::vector<ScreeningObject> catalog = plants;
+        for (size_t i = catalog.size(); i < count; i++)
+            catalog.push_back(randomOrbit(random, static_cast<uint32_t>(i + 1), mu, 1.2 * radius, 1.6 * radius, 0.02));
+
+        std::vector<Conjunction> conjunctions;
+        double seconds = measureSeconds([&]() { conjunctions = screener.screen({ spacecraft }, catalog); }, 1, 1);
+        const auto statistics = screener.getStatistics();
+
+        int found = 0;
+        for (const auto& conjunction : conjunctions)
+            found += conjunction.secondary <= planted;
+
+        std::cout << "   " << count << " objects: " << statistics.afterApsides << " after apsides, " << statistics.afterPath << " after path, "
+            << statistics.afterTime << " after time, " << statistics.conjunctions << " conjunctions, " << found << " of " << planted << " planted found" << std::endl;
+
+        if (!conjunctions.empty())
+        {
+            const auto& closest = conjunctions.front();
+            std::cout << "   closest: object " << closest.secondary << " at t = " << closest.time << " s, miss " << closest.missDistance
+                << " m, relative speed " << closest.relativeSpeed << " m/s" << std::endl;
+        }
+
+        if (count > 10000)
+        {
+            printBenchmark("cascade per object", seconds / count, seconds / count);
+            continue;
+        }
+
+        ConjunctionSettings everyPair = settings;
+        everyPair.filters = false;
+        ConjunctionScreener reference(planet, everyPair);
+
+        std::vector<Conjunction> expected;
+        double referenceSeconds = measureSeconds([&]() { expected = reference.screen({ spacecraft }, catalog); }, 1, 1);
+
+        bool identical = expected.size() == conjunctions.size();
+        for (size_t i = 0; identical && i < expected.size(); i++)
+            identical = expected[i].secondary == conjunctions[i].secondary && expected[i].missDistance == conjunctions[i].missDistance;
+
+        std::cout << "   every pair searched: " << expected.size() << " conjunctions, " << (identical ? "identical" : "DIFFERENT") << std::endl;
+        printBenchmark("every pair per object", referenceSeconds / count, referenceSeconds / count);
+        printBenchmark("cascade per object", seconds / count, referenceSeconds / count);
+    }
+}
+
+
+// Coast arcs around the home planet. The conic is checked against small step RK4 on an
+// elliptic and a hyperbolic orbit, then a spacecraft on the point mass force pipeline coasts
+// outside the atmosphere with the numerical integrator and with the analytic propagator.
+static void benchmarkKepler(Scenario* scenario)
+{
+    auto planet = scenario->findPlanet(scenario->getMission().homePlanet);
+    const double mu = planet->getGravititationParameter();
+    const double radius = planet->getRadius();
+
+    auto rk4 = [planet](Vector3<double>& r, Vector3<double>& v, double h)
+    {
+        auto k1v = planet->getGravitationalAcceleration(r), k1r = v;
+        auto k2v = planet->getGravitationalAcceleration(r + k1r * (0.5 * h)), k2r = v + k1v * (0.5 * h);
+        auto k3v = planet->getGravitationalAcceleration(r + k2r * (0.5 * h)), k3r = v + k2v * (0.5 * h);
+        auto k4v = planet->getGravitationalAcceleration(r + k3r * h), k4r = v + k3v * h;
+        r = r + (k1r + k2r * 2.0 + k3r * 2.0 + k4r) * (h / 6.0);
+        v = v + (k1v + k2v * 2.0 + k3v * 2.0 + k4v) * (h / 6.0);
+    };
+
+    // Periapsis at 2 radii, starting 1 radian past it
+    for (double eccentricity : { 0.3, 1.5 })
+    {
+        double periapsis = 2.0 * radius;
+        double p = periapsis * (1.0 + eccentricity);
+        double anomaly = 1.0;
+        double r = p / (1.0 + eccentricity * std::cos(anomaly));
+
+        Vector3<double> position(r * std::cos(anomaly), r * std::sin(anomaly) * 0.6, r * std::sin(anomaly) * 0.8);
+        Vector3<double> velocity = Vector3<double>(-std::sin(anomaly), (eccentricity + std::cos(anomaly)) * 0.6, (eccentricity + std::cos(anomaly)) * 0.8) * std::sqrt(mu / p);
+
+        KeplerPropagator kepler;
+        kepler.initialize(position, velocity, mu);
+
+        // Five orbits, or the time to 20 radii out
+        double a = std::fabs(kepler.getElements().semiMajorAxis);
+        double duration = eccentricity < 1 ? 5.0 * kepler.getElements().getPeriod() : 3.0 * std::sqrt(a * a * a / mu) * 20.0 * radius / a;
+        const int samples = 100, substeps = 2000;
+
+        double worst = 0.0;
+        auto reference = position, referenceVelocity = velocity;
+        for (int i = 1; i <= samples; i++)
+        {
+            for (int k = 0; k < substeps; k++)
+                rk4(reference, referenceVelocity, duration / (samples * substeps));
+
+            Vector3<double> r, v;
+            kepler.getState(i * duration / samples, r, v);
+            worst = std::max(worst, (r - reference).magnitude() / reference.magnitude());
+        }
+
+        std::cout << " - e = " << eccentricity << " over " << duration << " s: max position difference from RK4 " << worst << " of the radius" << std::endl;
+    }
+
+    // A spacecraft on a circular orbit above the atmosphere. Out there the harmonics are about 1e-5
+    // of the central pull, so both pipelines coast with a tolerance of 1e-4.
+    const int steps = 100000;
+    const double dt = scenario->getMission().timeStep;
+    const auto& nominal = scenario->getSpacecraftInitData().front();
+    const double orbit = 1.5 * planet->getAtmosphereRadius();
+
+    KeplerPropagator exact;
+    Vector3<double> expected, expectedVelocity;
+    exact.initialize(Vector3<double>(orbit, 0, 0), Vector3<double>(0, std::sqrt(mu / orbit), 0), mu);
+    exact.getState(steps * dt, expected, expectedVelocity);
+
+    std::cout << " - Spacecraft on a circular orbit at " << orbit / radius << " radii, " << steps << " steps of " << dt
+        << " s (time per step, position error against the conic):" << std::endl;
+
+    for (const char* forces : { "point-mass", "harmonic" })
+    {
+        double numericalTime = 0.0;
+
+        for (double tolerance : { 0.0, 1e-4 })
+        {
+            std::unique_ptr<Spacecraft> spacecraft(scenario->createSpacecraft(nominal));
+            spacecraft->setVerbose(false);
+            scenario->setupMission(spacecraft.get());
+            spacecraft->setForces(findForcePipeline(forces).acceleration, ForceContext(planet, nullptr));
+            spacecraft->setCoastTolerance(tolerance);
+            spacecraft->setThrust(Vector3<double>(0, 0, 0));
+            spacecraft->setPosition(planet->getCenterPosition() + Vector3<double>(orbit, 0, 0));
+            spacecraft->setVelocity(Vector3<double>(0, std::sqrt(mu / orbit), 0));
+
+            auto start = std::chrono::steady_clock::now();
+            for (int s = 0; s < steps; s++)
+                spacecraft->integrate(dt);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / steps;
+
+            numericalTime = tolerance == 0 ? seconds : numericalTime;
+            double error = (spacecraft->getPosition() - planet->getCenterPosition() - expected).magnitude();
+
+            std::string name = std::string(forces) + (tolerance == 0 ? ", numerical" : spacecraft->isCoasting() ? ", coasting" : ", coast not taken");
+            printBenchmark(name, seconds, numericalTime);
+            std::cout << "   position error " << error << " m" << std::endl;
+        }
+    }
+
+    // The propagator alone, one step at a time
+    KeplerPropagator kepler;
+    kepler.initialize(Vector3<double>(orbit, 0, 0), Vector3<double>(0, std::sqrt(mu / orbit) * 1.1, 0), mu);
+    Vector3<double> r, v;
+    double keplerTime = measureSeconds([&]() { for (int s = 0; s < 1000; s++) kepler.getState(s * dt, r, v); benchmarkSink = r.x; }, 100) / 1000;
+
+    auto position = Vector3<double>(orbit, 0, 0), velocity = Vector3<double>(0, std::sqrt(mu / orbit) * 1.1, 0);
+    double rk4Time = measureSeconds([&]() { for (int s = 0; s < 1000; s++) rk4(position, velocity, dt); benchmarkSink = position.x; }, 100) / 1000;
+
+    printBenchmark("RK4 step", rk4Time, rk4Time);
+    printBenchmark("KeplerPropagator::getState", keplerTime, rk4Time);
+}
+
+
+// Spheres of influence: the scenario's planets and their radii, then the index against testing
+// every planet on synthetic systems. Half of the lookups start inside a random planet's sphere.
+static void benchmarkSphereOfInfluence(Scenario* scenario)
+{
+    for (const auto& kv : scenario->getSystems())
+    {
+        auto system = kv.second;
+        std::cout << " - System " << system->getName() << ", primary " << (system->getPrimary() ? system->getPrimary()->getName() : "none") << std::endl;
+
+        for (const auto& pkv : system->getPlanets())
+        {
+            std::cout << "   " << pkv.first << ": sphere of influence " << pkv.second->getSphereOfInfluence()
+                << ", atmosphere radius " << pkv.second->getAtmosphereRadius() << std::endl;
+        }
+    }
+
+    auto random = makeRandomStream("benchmark", "soi");
+    const int lookups = 10000;
+
+    for (size_t count : { 1000, 10000, 100000 })
+    {
+        // Planets spread through a cube whose volume grows with the count, around a heavy primary
+        const double side = 1e6 * std::cbrt(static_cast<double>(count));
+        System system("benchmark");
+
+        Planet* primary = new Planet("benchmark", "primary", 1000, 1e6, Vector3<double>(0, 0, 0));
+        primary->setGravitationalParameter(1.0);
+        primary->setAtmosphereRadius(2000);
+        system.addPlanet(primary);
+
+        std::vector<Planet*> planets;
+        for (size_t i = 0; i < count; i++)
+        {
+            double mass = random.uniform(1, 100);
+            Planet* planet = new Planet("benchmark", "planet" + std::to_string(i), 100, mass,
+                Vector3<double>(random.uniform(-side, side), random.uniform(-side, side), random.uniform(-side, side)));
+            planet->setGravitationalParameter(mass * 1e-6);
+            planet->setAtmosphereRadius(200);
+            system.addPlanet(planet);
+            planets.push_back(planet);
+        }
+
+        system.buildSpheresOfInfluence();
+
+        std::vector<Vector3<double>> positions;
+        for (int i = 0; i < lookups; i++)
+        {
+            if (i % 2)
+            {
+                positions.push_back(Vector3<double>(random.uniform(-side, side), random.uniform(-side, side), random.uniform(-side, side)));
+                continue;
+            }
+
+            auto planet = planets[random() % planets.size()];
+            double reach = planet->getSphereOfInfluence();
+            positions.push_back(planet->getCenterPosition() + Vector3<double>(random.uniform(-1, 1), random.uniform(-1, 1), random.uniform(-1, 1)) * reach);
+        }
+
+        // Every planet tested, the same rule as the index
+        auto linear = [&](const Vector3<double>& position)
+        {
+            Planet* best = primary;
+            double strongest = -1.0;
+
+            for (auto planet : planets)
+            {
+                double distanceSquared = (position - planet->getCenterPosition()).magnitudeSquared();
+                double radius = planet->getSphereOfInfluence();
+
+                if (distanceSquared <= radius * radius)
+                {
+                    double pull = planet->getGravititationParameter() / std::max(distanceSquared, 1e-300);
+                    if (pull > strongest)
+                    {
+                        best = planet;
+                        strongest = pull;
+                    }
+                }
+            }
+
+            return best;
+        };
+
+        int mismatches = 0, inside = 0;
+        for (const auto& position : positions)
+        {
+            auto found = system.findDominantBody(position);
+            mismatches += found != linear(position);
+            inside += found != primary;
+        }
+
+        double linearTime = measureSeconds([&]() { for (const auto& p : positions) benchmarkSink = linear(p)->getMass(); }, 1, 1) / lookups;
+        double indexTime = measureSeconds([&]() { for (const auto& p : positions) benchmarkSink = system.findDominantBody(p)->getMass(); }, 10) / lookups;
+
+        std::cout << " - " << count << " planets, " << inside << " of " << lookups << " lookups inside a sphere, "
+            << (mismatches == 0 ? "identical to testing every planet" : std::to_string(mismatches) + " DIFFERENT") << std::endl;
+        printBenchmark("every planet", linearTime, linearTime);
+        printBenchmark("SphereOfInfluenceIndex", indexTime, linearTime);
+    }
+}
+
+
+// Lambert: random transfers flown with the Kepler propagator must land on their targets. Then a
+// porkchop grid between two inclined circular orbits, the table generator against solving every
+// cell from scratch.
+static void benchmarkLambert(Scenario*)
+{
+    auto random = makeRandomStream("benchmark", "lambert");
+    const double mu = 1.0;
+    const int problems = 10000;
+
+    int solved = 0, hyperbolic = 0;
+    double worstPosition = 0.0, worstVelocity = 0.0;
+
+    for (int i = 0; i < problems; i++)
+    {
+        auto r1 = Vector3<double>(random.uniform(-1, 1), random.uniform(-1, 1), random.uniform(-1, 1)).normalize() * random.uniform(1, 3);
+        auto r2 = Vector3<double>(random.uniform(-1, 1), random.uniform(-1, 1), random.uniform(-1, 1)).normalize() * random.uniform(1, 3);
+        double timeOfFlight = std::exp(random.uniform(std::log(0.05), std::log(30.0)));
+
+        Vector3<double> v1, v2, r, v;
+        KeplerPropagator kepler;
+
+        if (!LambertSolver::solve(r1, r2, timeOfFlight, mu, v1, v2) || !kepler.initialize(r1, v1, mu))
+        {
+            continue;
+        }
+
+        kepler.getState(timeOfFlight, r, v);
+        worstPosition = std::max(worstPosition, (r - r2).magnitude() / r2.magnitude());
+        worstVelocity = std::max(worstVelocity, (v - v2).magnitude() / v2.magnitude());
+        hyperbolic += kepler.isHyperbolic();
+        solved++;
+    }
+
+    std::cout << " - " << solved << " of " << problems << " random transfers solved (" << hyperbolic << " hyperbolic), flown with KeplerPropagator: max miss "
+        << worstPosition << " of the radius, max arrival velocity difference " << worstVelocity << std::endl;
+
+    // Circular orbits of radius 1 and 1.52, 5 degrees apart, over a synodic period of departures
+    auto circular = [mu](double radius, double inclination, double phase)
+    {
+        return [mu, radius, inclination, phase](double time, Vector3<double>& position, Vector3<double>& velocity)
+        {
+            double rate = std::sqrt(mu / (radius * radius * radius));
+            double angle = phase + rate * time;
+            position = Vector3<double>(std::cos(angle), std::sin(angle) * std::cos(inclination), std::sin(angle) * std::sin(inclination)) * radius;
+            velocity = Vector3<double>(-std::sin(angle), std::cos(angle) * std::cos(inclination), std::cos(angle) * std::sin(inclination)) * (radius * rate);
+        };
+    };
+
+    BodyEphemeris inner = circular(1.0, 0.0, 0.0), outer = circular(1.52, 5.0 * 3.14159265358979323846 / 180.0, 1.0);
+    const double synodic = 2.0 * 3.14159265358979323846 / (1.0 - std::pow(1.52, -1.5));
+
+    for (uint32_t size : { 64, 256 })
+    {
+        TimeAxis departures(0.0, synodic, size), arrivals(1.0, synodic + 8.0, size);
+        PorkchopTable table;
+
+        double tableTime = measureSeconds([&]() { table.generate("inner", inner, "outer", outer, mu, 0, departures, arrivals, 1); }, 1, 3) / (size * size);
+
+        // Every cell on its own, from z = 0
+        double worst = 0.0;
+        int mismatches = 0;
+        auto cold = [&](bool check)
+        {
+            for (uint32_t i = 0; i < size; i++)
+            {
+                Vector3<double> r1, p1, r2, p2, v1, v2;
+                inner(departures.at(i), r1, p1);
+
+                for (uint32_t j = 0; j < size; j++)
+                {
+                    outer(arrivals.at(j), r2, p2);
+                    bool ok = LambertSolver::solve(r1, r2, arrivals.at(j) - departures.at(i), mu, v1, v2);
+                    benchmarkSink = v1.x;
+
+                    if (check)
+                    {
+                        double expected = table.getDepartureDeltaV(i, j);
+                        if (ok != !std::isnan(expected))
+                        {
+                            mismatches++;
+                        }
+                        else if (ok)
+                        {
+                            worst = std::max(worst, std::fabs((v1 - p1).magnitude() - expected) / expected);
+                        }
+                    }
+                }
+            }
+        };
+
+        double coldTime = measureSeconds([&]() { cold(false); }, 1, 3) / (size * size);
+        cold(true);
+
+        uint32_t departure = 0, arrival = 0;
+        table.findBest(departure, arrival);
+
+        std::cout << " - " << size << " x " << size << " grid: cheapest transfer departs at " << departures.at(departure) << ", flies "
+            << arrivals.at(arrival) - departures.at(departure) << ", delta-v " << table.getDepartureDeltaV(departure, arrival) + table.getArrivalDeltaV(departure, arrival)
+            << "; against solving every cell alone " << mismatches << " cells differ in existence, max relative delta-v difference " << worst << std::endl;
+        printBenchmark("every cell alone", coldTime, coldTime);
+        printBenchmark("PorkchopTable::generate", tableTime, coldTime);
+    }
+}
+
+
+// Ephemeris: the fitted orbits of the scenario's planets over two orbits of the home planet,
+// checked against solving Kepler's equation at random times, then the cost of a query
+static void benchmarkEphemeris(Scenario* scenario)
+{
+    const std::string path = "benchmark.ephemeris";
+    auto& systems = scenario->getSystems();
+    auto system = systems.at(scenario->getMission().homeSystem);
+    auto primary = system->getPrimary();
+    auto home = scenario->findPlanet(scenario->getMission().homePlanet);
+
+    const double mu = primary->getGravititationParameter();
+    auto start = home->getCenterPosition() - primary->getCenterPosition();
+    const double span = 2.0 * 2.0 * 3.14159265358979323846 * std::sqrt(std::pow(start.magnitude(), 3) / mu);
+
+    auto generateStart = std::chrono::steady_clock::now();
+    Ephemeris::generate(systems, span, path);
+    double generateTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - generateStart).count();
+
+    Ephemeris ephemeris;
+    double openTime = measureSeconds([&]() { ephemeris.open(path); }, 100);
+    int body = ephemeris.findBody(home->getName());
+
+    // The same circular orbit, solved directly
+    auto normal = std::fabs(start.normalize().z) < 0.999 ? Vector3<double>(0, 0, 1) : Vector3<double>(1, 0, 0);
+    KeplerPropagator kepler;
+    kepler.initialize(start, normal.cross(start).normalize() * std::sqrt(mu / start.magnitude()), mu);
+
+    auto random = makeRandomStream("benchmark", "ephemeris");
+    std::vector<double> times(10000);
+    for (auto& time : times)
+    {
+        time = random.uniform(0, span);
+    }
+
+    double worstPosition = 0.0, worstVelocity = 0.0;
+    for (double time : times)
+    {
+        Vector3<double> p, v, r, w;
+        ephemeris.getState(body, time, p, v);
+        kepler.getState(time, r, w);
+
+        worstPosition = std::max(worstPosition, (p - primary->getCenterPosition() - r).magnitude() / r.magnitude());
+        worstVelocity = std::max(worstVelocity, (v - w).magnitude() / w.magnitude());
+    }
+
+    std::cout << " - " << home->getName() << " over " << span << " s (two orbits about " << primary->getName() << "): generated in " << generateTime * 1e3
+        << " ms, opened in " << openTime * 1e6 << " us; max position error " << worstPosition << " of the radius, max velocity error " << worstVelocity << std::endl;
+
+    Vector3<double> p, v;
+    double keplerTime = measureSeconds([&]() { for (double time : times) { kepler.getState(time, p, v); benchmarkSink = p.x; } }, 10) / times.size();
+    double ephemerisTime = measureSeconds([&]() { for (double time : times) { ephemeris.getState(body, time, p, v); benchmarkSink = p.x; } }, 10) / times.size();
+
+    printBenchmark("KeplerPropagator::getState", keplerTime, keplerTime);
+    printBenchmark("Ephemeris::getState", ephemerisTime, keplerTime);
+
+    ephemeris.close();
+    std::remove(path.c_str());
+}
+
+
+// Frames: a spacecraft near a moon of a planet far from the origin, converted through the tree
+// and through global coordinates; then lazy updates and batched conversions
+static void benchmarkFrames(Scenario*)
+{
+    auto fixed = [](Vector3<double> offset, Vector3<double> rate)
+    {
+        return [offset, rate](double time, Vector3<double>& position, Vector3<double>& velocity)
+        {
+            position = offset + rate * time;
+            velocity = rate;
+        };
+    };
+
+    FrameTree tree;
+    int system = tree.addFrame("system", FrameTree::ROOT, fixed(Vector3<double>(1e12, 2e12, -1e12), Vector3<double>(3e3, 1e3, 0)));
+    int planet = tree.addFrame("planet", system, fixed(Vector3<double>(3e11, -1e11, 2e10), Vector3<double>(2e4, 3e4, 1e3)));
+    int moon = tree.addFrame("moon", planet, fixed(Vector3<double>(4e5, 1e5, -2e5), Vector3<double>(500, -300, 20)));
+    int spacecraft = tree.addFrame("spacecraft", moon, fixed(Vector3<double>(12.345678, -0.001234, 7.654321), Vector3<double>(0.01, 0.02, -0.03)));
+
+    tree.setTime(1234.5);
+    Vector3<double> expected = Vector3<double>(12.345678, -0.001234, 7.654321) + Vector3<double>(0.01, 0.02, -0.03) * 1234.5;
+
+    Vector3<double> local, velocity, globalSpacecraft, globalMoon;
+    tree.getOffset(spacecraft, moon, local, velocity);
+    tree.getOffset(spacecraft, FrameTree::ROOT, globalSpacecraft, velocity);
+    tree.getOffset(moon, FrameTree::ROOT, globalMoon, velocity);
+
+    std::cout << std::setprecision(3) << " - Spacecraft 14 m from a moon 2e12 m from the origin: error through the tree " << (local - expected).magnitude()
+        << " m, through global coordinates " << (globalSpacecraft - globalMoon - expected).magnitude() << " m" << std::setprecision(6) << std::endl;
+
+    // 1000 planets under one barycentre, of which a step looks at 10
+    FrameTree wide;
+    int barycentre = wide.addFrame("barycentre", FrameTree::ROOT, fixed(Vector3<double>(0, 0, 0), Vector3<double>(1, 0, 0)));
+    std::vector<int> planets;
+    for (int i = 0; i < 1000; i++)
+    {
+        planets.push_back(wide.addFrame("planet" + std::to_string(i), barycentre, fixed(Vector3<double>(i * 1e6, 0, 0), Vector3<double>(0, i, 0))));
+    }
+
+    int step = 0;
+    auto evaluations = wide.getEvaluations();
+    double lazyTime = measureSeconds([&]()
+    {
+        wide.setTime(++step);
+        for (int i = 0; i < 10; i++)
+        {
+            benchmarkSink = wide.transformPosition(Vector3<double>(1, 2, 3), planets[i * 97], planets[i * 97 + 1]).x;
+        }
+    }, 10000);
+    double perStep = static_cast<double>(wide.getEvaluations() - evaluations) / step;
+
+    double eagerTime = measureSeconds([&]()
+    {
+        wide.setTime(++step);
+        for (int i = 0; i < 1000; i++)
+        {
+            Vector3<double> p, v;
+            wide.getOffset(planets[i], FrameTree::ROOT, p, v);
+            benchmarkSink = p.x;
+        }
+    }, 1000);
+
+    std::cout << " - 1000 planet frames, 10 conversions a step: " << perStep << " motions evaluated a step" << std::endl;
+    printBenchmark("every frame, per step", eagerTime, eagerTime);
+    printBenchmark("lazy, per step", lazyTime, eagerTime);
+
+    // A fleet of states from moon frame to system frame
+    const size_t count = 100000;
+    auto random = makeRandomStream("benchmark", "frames");
+    std::vector<Vector3<double>> positions(count), velocities(count), outPositions(count), outVelocities(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        positions[i] = Vector3<double>(random.uniform(-1e5, 1e5), random.uniform(-1e5, 1e5), random.uniform(-1e5, 1e5));
+        velocities[i] = Vector3<double>(random.uniform(-10, 10), random.uniform(-10, 10), random.uniform(-10, 10));
+    }
+
+    double singleTime = measureSeconds([&]()
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            outPositions[i] = positions[i];
+            outVelocities[i] = velocities[i];
+            tree.transform(moon, system, outPositions[i], outVelocities[i]);
+        }
+        benchmarkSink = outPositions[count - 1].x;
+    }, 10) / count;
+
+    double batchTime = measureSeconds([&]()
+    {
+        tree.transform(moon, system, positions.data(), velocities.data(), outPositions.data(), outVelocities.data(), count);
+        benchmarkSink = outPositions[count - 1].x;
+    }, 10) / count;
+
+    printBenchmark("one state at a time", singleTime, singleTime);
+    printBenchmark("FrameTree::transform batch", batchTime, singleTime);
+}
+
+
+// Attitude: a torque-free asymmetric top, whose energy and angular momentum must hold, at a few
+// step sizes; then a fleet stepped one spacecraft at a time against the batched kernel
+static void benchmarkAttitude(Scenario*)
+{
+    const InertiaTensor top(1200.0, 2100.0, 2900.0, 40.0, -25.0, 60.0);
+    const InertiaTensor topInverse = top.inverse();
+    const Vector3<double> spin(0.31, -0.07, 0.18);
+    const double span = 600.0;
+
+    const double energy = AttitudeDynamics::getEnergy(spin, top);
+    const Vector3<double> momentum = AttitudeDynamics::getMomentum(Quaternion<double>(), spin, top);
+
+    for (double dt : { 1.0, 0.5, 0.25 })
+    {
+        Quaternion<double> attitude;
+        Vector3<double> rate = spin;
+        double worstEnergy = 0.0, worstMomentum = 0.0, worstNorm = 0.0;
+
+        for (int i = 0; i < static_cast<int>(span / dt); i++)
+        {
+            AttitudeDynamics::step(attitude, rate, top, topInverse, Vector3<double>(0, 0, 0), dt);
+
+            worstEnergy = std::max(worstEnergy, std::fabs(AttitudeDynamics::getEnergy(rate, top) - energy) / energy);
+            worstMomentum = std::max(worstMomentum, (AttitudeDynamics::getMomentum(attitude, rate, top) - momentum).magnitude() / momentum.magnitude());
+            worstNorm = std::max(worstNorm, std::fabs(attitude.norm() - 1.0));
+        }
+
+        std::cout << " - Torque-free top over " << span << " s at dt " << dt << ": max relative energy drift " << worstEnergy
+            << ", momentum drift " << worstMomentum << ", |q| - 1 " << worstNorm << std::endl;
+    }
+
+    // A fleet of random bodies under random constant torques
+    const size_t count = 100000;
+    const int steps = 10;
+    const double dt = 0.5;
+    auto random = makeRandomStream("benchmark", "attitude");
+
+    struct Body
+    {
+        Quaternion<double> attitude;
+        Vector3<double> rate;
+        Vector3<double> torque;
+        InertiaTensor inertia;
+        InertiaTensor inverse;
+    };
+
+    std::vector<Body> bodies(count);
+    AttitudeFleet fleet;
+
+    for (auto& body : bodies)
+    {
+        body.attitude = Quaternion<double>(random.uniform(-1, 1), random.uniform(-1, 1), random.uniform(-1, 1), random.uniform(-1, 1)).normalize();
+        body.rate = Vector3<double>(random.uniform(-0.5, 0.5), random.uniform(-0.5, 0.5), random.uniform(-0.5, 0.5));
+        body.torque = Vector3<double>(random.uniform(-10, 10), random.uniform(-10, 10), random.uniform(-10, 10));
+        body.inertia = InertiaTensor(random.uniform(500, 1500), random.uniform(500, 1500), random.uniform(500, 1500),
+            random.uniform(-50, 50), random.uniform(-50, 50), random.uniform(-50, 50));
+        body.inverse = body.inertia.inverse();
+
+        fleet.setTorque(fleet.add(body.attitude, body.rate, body.inertia), body.torque);
+    }
+
+    // Both sides take the same steps, so they can be compared afterwards
+    double scalarTime = measureSeconds([&]()
+    {
+        for (auto& body : bodies)
+        {
+            AttitudeDynamics::step(body.attitude, body.rate, body.inertia, body.inverse, body.torque, dt);
+        }
+        benchmarkSink = bodies[count - 1].attitude.w;
+    }, steps, 1) / count;
+
+    // One thread, so the kernel is compared with the scalar loop and not with more cores
+    double fleetTime = measureSeconds([&]() { fleet.step(dt, 1); benchmarkSink = fleet.getAttitude(count - 1).w; }, steps, 1) / count;
+
+    // Bit for bit unless the compiler fuses multiply-adds differently in the vector loop
+    size_t mismatches = 0;
+    double worst = 0.0;
+    for (size_t i = 0; i < count; i++)
+    {
+        auto q = fleet.getAttitude(i);
+        auto w = fleet.getRate(i);
+        const auto& body = bodies[i];
+
+        if (q.w != body.attitude.w || q.x != body.attitude.x || q.y != body.attitude.y || q.z != body.attitude.z
+            || w.x != body.rate.x || w.y != body.rate.y || w.z != body.rate.z)
+        {
+            mismatches++;
+            worst = std::max(worst, (q * body.attitude.conjugate()).toRotationVector().magnitude());
+        }
+    }
+
+    std::cout << " - " << count << " bodies, " << steps << " steps of " << dt << " s: " << mismatches << " differ between the batched and scalar steps, by at most "
+        << worst << " rad" << std::endl;
+    printBenchmark("AttitudeDynamics::step", scalarTime, scalarTime);
+    printBenchmark("AttitudeFleet::step", fleetTime, scalarTime);
+}
+
+
+// The constexpr paths of Matrix, checked by the compiler
+static constexpr Matrix<double, 3, 3> CONSTEXPR_MATRIX = { 4, 1, 2, 1, 5, 3, 2, 3, 6 };
+static_assert(Matrix<double, 3, 3>(CONSTEXPR_MATRIX * 2.0 - Matrix<double, 3, 3>::identity())(0, 0) == 7.0, "Matrix expressions are not constexpr");
+static_assert(multiply(CONSTEXPR_MATRIX, CONSTEXPR_MATRIX.inverse())(1, 1) > 0.999999, "Matrix::inverse is not constexpr");
+static_assert(Matrix<double, 6, 6>::identity().determinant() == 1.0, "Matrix::determinant is not constexpr");
+
+// Matrix: products of random 3x3 and 6x6 matrices by the definition and through the kernels,
+// inverses and Cholesky factors of random symmetric positive definite matrices with their
+// residuals, and a fused expression against one evaluated a step at a time
+template<int N>
+static void benchmarkMatrixSize(RandomStream& random)
+{
+    typedef Matrix<double, N, N> Square;
+    const size_t count = 200;
+
+    std::vector<Square> a(count), b(count), c(count), d(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        for (int j = 0; j < Square::SIZE; j++)
+        {
+            a[i][j] = random.uniform(-1, 1);
+            b[i][j] = random.uniform(-1, 1);
+        }
+    }
+
+    double definitionTime = measureSeconds([&]() { for (size_t i = 0; i < count; i++) c[i] = multiply(a[i], b[i]); benchmarkSink = c[count - 1][0]; }, 500) / count;
+    double kernelTime = measureSeconds([&]() { for (size_t i = 0; i < count; i++) d[i] = a[i] * b[i]; benchmarkSink = d[count - 1][0]; }, 500) / count;
+
+    double worstProduct = 0.0;
+    for (size_t i = 0; i < count; i++)
+    {
+        for (int j = 0; j < Square::SIZE; j++)
+        {
+            worstProduct = std::max(worstProduct, std::fabs(c[i][j] - d[i][j]));
+        }
+    }
+
+    // Symmetric positive definite, like a covariance
+    std::vector<Square> spd(count);
+    std::vector<VectorN<double, N> > rhs(count), x(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        spd[i] = multiply(a[i], a[i].transpose()) + Square::identity() * 0.1;
+        for (int j = 0; j < N; j++)
+        {
+            rhs[i][j] = random.uniform(-1, 1);
+        }
+    }
+
+    double inverseTime = measureSeconds([&]() { for (size_t i = 0; i < count; i++) c[i] = spd[i].inverse(); benchmarkSink = c[count - 1][0]; }, 500) / count;
+    double choleskyTime = measureSeconds([&]() { for (size_t i = 0; i < count; i++) d[i] = spd[i].cholesky(); benchmarkSink = d[count - 1][0]; }, 500) / count;
+    double inverseSolveTime = measureSeconds([&]() { for (size_t i = 0; i < count; i++) x[i] = multiply(spd[i].inverse(), rhs[i]); benchmarkSink = x[count - 1][0]; }, 500) / count;
+    double choleskySolveTime = measureSeconds([&]() { for (size_t i = 0; i < count; i++) x[i] = spd[i].cholesky().solveCholesky(rhs[i]); benchmarkSink = x[count - 1][0]; }, 500) / count;
+
+    double worstInverse = 0.0, worstFactor = 0.0, worstSolve = 0.0;
+    for (size_t i = 0; i < count; i++)
+    {
+        Square inverseResidual = multiply(spd[i], c[i]) - Square::identity();
+        Square factorResidual = multiply(d[i], d[i].transpose()) - spd[i];
+        VectorN<double, N> solveResidual = multiply(spd[i], x[i]) - rhs[i];
+
+        for (int j = 0; j < Square::SIZE; j++)
+        {
+            worstInverse = std::max(worstInverse, std::fabs(inverseResidual[j]));
+            worstFactor = std::max(worstFactor, std::fabs(factorResidual[j]));
+        }
+        worstSolve = std::max(worstSolve, std::sqrt(solveResidual.normSquared()));
+    }
+
+    // a + 2 b - spd, once fused and once through temporaries
+    double stepTime = measureSeconds([&]()
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            Square scaled = b[i] * 2.0;
+            Square sum = a[i] + scaled;
+            c[i] = sum - spd[i];
+        }
+        benchmarkSink = c[count - 1][0];
+    }, 500) / count;
+    double fusedTime = measureSeconds([&]() { for (size_t i = 0; i < count; i++) d[i] = a[i] + b[i] * 2.0 - spd[i]; benchmarkSink = d[count - 1][0]; }, 500) / count;
+
+    std::cout << " - " << N << "x" << N << ": max product difference between the kernel and the definition " << worstProduct << "; max residuals: A inverse(A) - I "
+        << worstInverse << ", L L^T - A " << worstFactor << ", A x - b " << worstSolve << std::endl;
+    printBenchmark("multiply() by the definition", definitionTime, definitionTime);
+    printBenchmark("operator*", kernelTime, definitionTime);
+    printBenchmark("inverse()", inverseTime, inverseTime);
+    printBenchmark("cholesky()", choleskyTime, inverseTime);
+    printBenchmark("solve by inverse()", inverseSolveTime, inverseSolveTime);
+    printBenchmark("solve by cholesky()", choleskySolveTime, inverseSolveTime);
+    printBenchmark("a + 2 b - c a step at a time", stepTime, stepTime);
+    printBenchmark("a + 2 b - c fused", fusedTime, stepTime);
+}
+
+static void benchmarkMatrix(Scenario*)
+{
+#ifdef __AVX__
+    std::cout << " - AVX kernels for double 3x3 and 6x6 products are compiled in" << std::endl;
+#else
+    std::cout << " - No AVX: every product is by the definition" << std::endl;
+#endif
+
+    auto random = makeRandomStream("benchmark", "matrix");
+    benchmarkMatrixSize<3>(random);
+    benchmarkMatrixSize<6>(random);
+}
+
+
+// The curve of an engine straight from its samples: a search for the segment and a division by the Isp
+static void evaluateSamples(const std::vector<ThrustSample>& samples, double time, double& thrust, double& massFlow)
+{
+    if (!(time < samples.back().time))
+    {
+        thrust = massFlow = 0.0;
+        return;
+    }
+
+    auto upper = std::upper_bound(samples.begin(), samples.end(), time, [](double t, const ThrustSample& s) { return t < s.time; });
+    const ThrustSample& a = *(upper - 1);
+    const ThrustSample& b = *upper;
+    double f = (time - a.time) / (b.time - a.time);
+
+    thrust = a.thrust + (b.thrust - a.thrust) * f;
+    massFlow = thrust / ((a.isp + (b.isp - a.isp) * f) * STANDARD_GRAVITY);
+}
+
+// Propulsion: each engine's table against its samples, the impulse of a whole burn against the
+// integral of the curve, and the cost of a burn over a fleet run until some vehicles are dry
+static void benchmarkPropulsion(Scenario* scenario)
+{
+    std::vector<const Engine*> engines;
+    for (const auto& entry : scenario->getEngines())
+    {
+        engines.push_back(&entry.second);
+    }
+
+    // A curve of its own when the scenario has no engines, sampled off the grid's step
+    Engine fallback;
+    if (engines.empty())
+    {
+        fallback.build("Benchmark", { ThrustSample(0, 0, 250), ThrustSample(0.7, 5e4, 280), ThrustSample(40, 4.5e4, 290), ThrustSample(41.3, 0, 290) });
+        engines.push_back(&fallback);
+    }
+
+    const size_t checks = 1000000;
+    auto random = makeRandomStream("benchmark", "propulsion");
+
+    for (const Engine* engine : engines)
+    {
+        const auto& samples = engine->getSamples();
+        double peakThrust = 0.0, peakFlow = 0.0;
+        for (const auto& sample : samples)
+        {
+            peakThrust = std::max(peakThrust, sample.thrust);
+            peakFlow = std::max(peakFlow, sample.thrust / (sample.isp * STANDARD_GRAVITY));
+        }
+
+        double worstThrust = 0.0, worstFlow = 0.0;
+        for (size_t i = 0; i < 10000; i++)
+        {
+            double time = random.uniform(0, engine->getBurnTime() * 1.05);
+            double thrust, massFlow;
+            evaluateSamples(samples, time, thrust, massFlow);
+
+            worstThrust = std::max(worstThrust, std::fabs(engine->getThrust(time) - thrust));
+            worstFlow = std::max(worstFlow, std::fabs(engine->getMassFlow(time) - massFlow));
+        }
+
+        // A full burn with fuel to spare, against the curve integrated exactly segment by segment
+        double impulse = 0.0;
+        for (size_t k = 1; k < samples.size(); k++)
+        {
+            impulse += 0.5 * (samples[k - 1].thrust + samples[k].thrust) * (samples[k].time - samples[k - 1].time);
+        }
+
+        double burnTime = 0.0, fuel = 1e12, burned = 0.0;
+        const double dt = 0.1;
+        for (int i = 0; i <= static_cast<int>(engine->getBurnTime() / dt); i++)
+        {
+            burned += engine->burn(1.0, dt, burnTime, fuel) * dt;
+        }
+        double effectiveIsp = burned / ((1e12 - fuel) * STANDARD_GRAVITY);
+
+        std::cout << " - " << engine->getName() << ": " << samples.size() << " samples, " << engine->getIntervalCount() << " segments of "
+            << engine->getStep() << " s; table error relative to peak, thrust " << worstThrust / peakThrust << ", mass flow " << worstFlow / peakFlow
+            << "; impulse at dt " << dt << " off by " << std::fabs(burned - impulse) / impulse << ", effective Isp " << effectiveIsp << " s" << std::endl;
+    }
+
+    // Lookups at random burn times, the table against the search
+    const Engine& engine = *engines.front();
+    std::vector<double> times(checks), values(checks);
+    for (auto& time : times)
+    {
+        time = random.uniform(0, engine.getBurnTime());
+    }
+
+    double searchTime = measureSeconds([&]()
+    {
+        double thrust, massFlow;
+        for (size_t i = 0; i < checks; i++)
+        {
+            evaluateSamples(engine.getSamples(), times[i], thrust, massFlow);
+            values[i] = thrust + massFlow;
+        }
+        benchmarkSink = values[checks - 1];
+    }, 5) / checks;
+
+    double tableTime = measureSeconds([&]()
+    {
+        for (size_t i = 0; i < checks; i++)
+            values[i] = engine.getThrust(times[i]) + engine.getMassFlow(times[i]);
+        benchmarkSink = values[checks - 1];
+    }, 5) / checks;
+
+    printBenchmark("Thrust curve by search", searchTime, searchTime);
+    printBenchmark("Engine table", tableTime, searchTime);
+
+    // A fleet on random engines, fuel loads and throttles, burned past the point where some run dry
+    const size_t count = 100000;
+    const int steps = 20;
+    const double dt = 1.0;
+
+    struct Vehicle
+    {
+        const Engine* engine;
+        double dryMass;
+        double fuelMass;
+        double burnTime;
+        double throttle;
+        double thrust;
+    };
+
+    std::vector<Vehicle> vehicles(count);
+    double fuelLoaded = 0.0;
+
+    for (auto& vehicle : vehicles)
+    {
+        vehicle.engine = engines[static_cast<size_t>(random.uniform(0, static_cast<double>(engines.size()))) % engines.size()];
+        vehicle.dryMass = random.uniform(1e3, 1e5);
+        vehicle.fuelMass = random.uniform(0, 20 * vehicle.engine->getMassFlow(0.5 * vehicle.engine->getBurnTime()));
+        vehicle.burnTime = 0.0;
+        vehicle.throttle = random.uniform(0, 1);
+        vehicle.thrust = 0.0;
+        fuelLoaded += vehicle.fuelMass;
+    }
+
+    double vehicleTime = measureSeconds([&]()
+    {
+        for (auto& vehicle : vehicles)
+        {
+            vehicle.thrust = vehicle.engine->burn(vehicle.throttle, dt, vehicle.burnTime, vehicle.fuelMass);
+        }
+        benchmarkSink = vehicles[count - 1].thrust;
+    }, steps, 1) / count;
+
+    size_t dry = 0, negative = 0;
+    double fuelLeft = 0.0;
+    for (const auto& vehicle : vehicles)
+    {
+        dry += vehicle.fuelMass == 0.0 && vehicle.throttle > 0.0;
+        negative += vehicle.fuelMass < 0.0;
+        fuelLeft += vehicle.fuelMass;
+    }
+
+    if (negative > 0)
+    {
+        failBenchmark("Engine::burn took " + std::to_string(negative) + " vehicles below zero fuel.");
+    }
+
+    std::cout << " - " << count << " vehicles, " << steps << " burns of " << dt << " s: " << dry << " ran dry; "
+        << (fuelLoaded - fuelLeft) / 1000.0 << " t of fuel used" << std::endl;
+    printBenchmark("Engine::burn", vehicleTime, vehicleTime);
+}
+
+
+// Spherical harmonics: the recursion checked against the closed form J2 acceleration, then the
+// cost of a degree 20 field at several distances with the full degree and the adaptive cutoff
+static void benchmarkHarmonics(Scenario* scenario)
+{
+    const size_t count = 1000;
+    const int degree = 20;
+    const double j2 = 1.08263e-3;
+
+    auto planet = scenario->findPlanet(scenario->getMission().homePlanet);
+    const double mu = planet->getGravititationParameter();
+    const double radius = planet->getRadius();
+
+    auto random = makeRandomStream("benchmark", "harmonics");
+
+    auto randomPositions = [&random, count](double distance)
+    {
+        std::vector<Vector3<double> > positions(count);
+        for (auto& position : positions)
+            position = Vector3<double>(random.uniform(-1, 1), random.uniform(-1, 1), random.uniform(-1, 1)).normalize() * distance;
+        return positions;
+    };
+
+    // C(2, 0) alone is J2
+    GravityField zonal;
+    zonal.setCoefficient(2, 0, -j2 / std::sqrt(5.0), 0.0);
+
+    ForceContext context(planet, nullptr);
+    context.j2 = j2;
+
+    double j2Difference = 0.0;
+    GravityWorkspace workspace;
+    for (const auto& position : randomPositions(1.5 * radius))
+    {
+        auto expected = J2Gravity::acceleration(context, ForceState(planet->getCenterPosition() + position, Vector3<double>(), Vector3<double>(), 0.0, 1.0, 0.0));
+        auto actual = zonal.getAcceleration(position, mu, radius, 2, workspace);
+        j2Difference = std::max(j2Difference, (actual - expected).magnitude() / expected.magnitude());
+    }
+
+    std::cout << " - C(2, 0) against the closed form J2 acceleration: max relative difference " << j2Difference << std::endl;
+
+    // Coefficients falling off as 1e-5 / n^2, like a terrestrial field
+    GravityField field;
+    for (int n = 2; n <= degree; n++)
+        for (int m = 0; m <= n; m++)
+            field.setCoefficient(n, m, random.uniform(-1e-5, 1e-5) / (n * n), m == 0 ? 0.0 : random.uniform(-1e-5, 1e-5) / (n * n));
+
+    std::cout << " - Degree " << degree << " field, " << count << " positions per distance (time per evaluation):" << std::endl;
+
+    for (double distance : { 1.1, 2.0, 10.0, 100.0 })
+    {
+        auto positions = randomPositions(distance * radius);
+        std::vector<Vector3<double> > full(count), adaptive(count);
+
+        double fullTime = measureSeconds([&]()
+        {
+            for (size_t i = 0; i < count; i++)
+                full[i] = field.getAcceleration(positions[i], mu, radius, degree, workspace);
+            benchmarkSink = full[count - 1].x;
+        }, 20) / count;
+
+        double adaptiveTime = measureSeconds([&]()
+        {
+            for (size_t i = 0; i < count; i++)
+                adaptive[i] = field.getAcceleration(positions[i], mu, radius);
+            benchmarkSink = adaptive[count - 1].x;
+        }, 20) / count;
+
+        // Dropped terms relative to the point mass acceleration
+        double dropped = 0.0;
+        for (size_t i = 0; i < count; i++)
+            dropped = std::max(dropped, (full[i] - adaptive[i]).magnitude() / (mu / (distance * radius * distance * radius)));
+
+        std::cout << "   " << distance << " radii: adaptive degree " << field.getDegreeForDistance(distance * radius, radius)
+            << ", dropped terms " << dropped << " of the point mass" << std::endl;
+        printBenchmark("full degree", fullTime, fullTime);
+        printBenchmark("adaptive degree", adaptiveTime, fullTime);
+    }
+}
+
+
+// One force model behind a virtual call, how a hand built composition would dispatch
+struct VirtualForce
+{
+    virtual ~VirtualForce() {}
+    virtual Vector3<double> acceleration(const ForceContext& context, const ForceState& state) const = 0;
+};
+
+template<typename Model>
+struct VirtualForceModel : public VirtualForce
+{
+    Vector3<double> acceleration(const ForceContext& context, const ForceState& state) const override { return Model::acceleration(context, state); }
+};
+
+// Every force model of the "full" pipeline summed for spacecraft around the home planet: one
+// virtual call per force, the compile-time pipeline, and the same pipeline picked by name once
+// before the loop, as attachForces does. Also checks that "oblate" picks up the planet's J2.
+static void benchmarkForcePipeline(Scenario* scenario)
+{
+    typedef ForcePipeline<PointMassGravity, HarmonicGravity, LimitedDrag, SolarRadiationPressure, ThirdBodyGravity, ThrustAcceleration> FullPipeline;
+
+    const size_t count = 10000;
+    const auto& nominal = scenario->getSpacecraftInitData().front();
+    auto planet = scenario->findPlanet(scenario->getMission().homePlanet);
+
+    ForceContext context(planet, scenario->getSystems().at(scenario->getMission().homeSystem));
+
+    auto random = makeRandomStream("benchmark", "force-pipeline");
+
+    std::vector<ForceState> states(count);
+    for (auto& state : states)
+    {
+        auto direction = Vector3<double>(random.uniform(-1, 1), random.uniform(-1, 1), random.uniform(-1, 1)).normalize();
+        state = ForceState(planet->getCenterPosition() + direction * (planet->getRadius() + random.uniform(0, 5e4)),
+            Vector3<double>(random.uniform(-2000, 2000), random.uniform(-2000, 2000), random.uniform(-2000, 2000)),
+            Vector3<double>(random.uniform(-1e4, 1e4), random.uniform(-1e4, 1e4), random.uniform(-1e4, 1e4)),
+            nominal.area, nominal.mass, nominal.maxVelocity);
+    }
+
+    std::vector<std::unique_ptr<VirtualForce> > forces;
+    forces.emplace_back(new VirtualForceModel<PointMassGravity>());
+    forces.emplace_back(new VirtualForceModel<HarmonicGravity>());
+    forces.emplace_back(new VirtualForceModel<LimitedDrag>());
+    forces.emplace_back(new VirtualForceModel<SolarRadiationPressure>());
+    forces.emplace_back(new VirtualForceModel<ThirdBodyGravity>());
+    forces.emplace_back(new VirtualForceModel<ThrustAcceleration>());
+
+    std::vector<Vector3<double> > virtualResult(count), staticResult(count), runtimeResult(count);
+    const ForceFunction runtime = findForcePipeline("full").acceleration;
+
+    double virtualTime = measureSeconds([&]()
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            Vector3<double> total(0, 0, 0);
+            for (const auto& force : forces)
+                total += force->acceleration(context, states[i]);
+            virtualResult[i] = total;
+        }
+        benchmarkSink = virtualResult[count - 1].x;
+    }, 20) / count;
+
+    double staticTime = measureSeconds([&]()
+    {
+        for (size_t i = 0; i < count; i++)
+            staticResult[i] = FullPipeline::acceleration(context, states[i]);
+        benchmarkSink = staticResult[count - 1].x;
+    }, 20) / count;
+
+    double runtimeTime = measureSeconds([&]()
+    {
+        for (size_t i = 0; i < count; i++)
+            runtimeResult[i] = runtime(context, states[i]);
+        benchmarkSink = runtimeResult[count - 1].x;
+    }, 20) / count;
+
+    double difference = 0.0;
+    for (size_t i = 0; i < count; i++)
+    {
+        difference = std::max(difference, (staticResult[i] - virtualResult[i]).magnitude());
+        difference = std::max(difference, (runtimeResult[i] - virtualResult[i]).magnitude());
+    }
+
+    std::cout << " - Six force models at " << planet->getName() << ", " << count << " spacecraft (time per spacecraft):" << std::endl;
+    printBenchmark("virtual call per force", virtualTime, virtualTime);
+    printBenchmark("ForcePipeline<...>::acceleration", staticTime, virtualTime);
+    printBenchmark("findForcePipeline(\"full\")", runtimeTime, virtualTime);
+    std::cout << "   max difference: " << difference << std::endl;
+
+    // The oblate pipeline with the context attachForces builds has to feel the planet's J2
+    const ForceFunction pointMass = findForcePipeline("point-mass").acceleration, oblate = findForcePipeline("oblate").acceleration;
+    double oblateDifference = 0.0;
+    for (const auto& state : states)
+    {
+        oblateDifference = std::max(oblateDifference, (oblate(context, state) - pointMass(context, state)).magnitude() / pointMass(context, state).magnitude());
+    }
+
+    std::cout << " - J2 of " << planet->getName() << " " << context.j2 << ", oblate against point-mass: max relative difference " << oblateDifference << std::endl;
+
+    if (planet->getJ2() != 0 && !(oblateDifference > 0))
+    {
+        failBenchmark("The oblate force pipeline flies like point-mass at " + planet->getName() + ", whose J2 is not 0.");
+    }
+}
+
+
+// How update() was reached before the pipeline: a virtual call on the control system
+struct VirtualStep
+{
+    virtual ~VirtualStep() {}
+    virtual void step(Spacecraft& spacecraft, double dt) = 0;
+};
+
+struct VirtualUpdate : public VirtualStep
+{
+    void step(Spacecraft& spacecraft, double dt) override { spacecraft.update(dt); }
+};
+
+// Steps a fleet of `count` fresh spacecraft through the scenario mission with each way of
+// calling the step pipeline. The pipelines are for composing steps; they are not expected to be
+// faster than update(), only no slower.
+static void benchmarkPipeline(Scenario* scenario)
+{
+    const size_t count = 1000;
+    const auto& mission = scenario->getMission();
+
+    // Short of the landing, after which a step does nothing
+    const int steps = std::min(mission.maxSteps, 20);
+    const auto& nominal = scenario->getSpacecraftInitData().front();
+
+    auto makeFleet = [scenario, &nominal](std::vector<std::unique_ptr<Spacecraft> >& fleet)
+    {
+        fleet.clear();
+        for (size_t i = 0; i < count; i++)
+        {
+            fleet.emplace_back(scenario->createSpacecraft(nominal));
+            fleet.back()->setVerbose(false);
+            scenario->setupMission(fleet.back().get());
+        }
+    };
+
+    std::vector<std::unique_ptr<Spacecraft> > fleet;
+    std::unique_ptr<VirtualStep> virtualStep(new VirtualUpdate());
+    const auto& runtime = findPipeline("standard");
+
+    // Best of five passes, each over a fresh fleet, since a landed fleet has nothing left to step
+    auto timeFleet = [&](auto step)
+    {
+        double best = 0.0;
+        for (int trial = 0; trial < 5; trial++)
+        {
+            makeFleet(fleet);
+            double seconds = measureSeconds([&]()
+            {
+                for (int s = 0; s < steps; s++)
+                    for (auto& spacecraft : fleet)
+                        step(*spacecraft);
+            }, 1, 1);
+            best = trial == 0 ? seconds : std::min(best, seconds);
+        }
+        return best / (count * steps);
+    };
+
+    double virtualTime = timeFleet([&](Spacecraft& spacecraft) { virtualStep->step(spacecraft, mission.timeStep); });
+    double staticTime = timeFleet([&](Spacecraft& spacecraft) { StandardPipeline::step(spacecraft, mission.timeStep); });
+    double runtimeTime = timeFleet([&](Spacecraft& spacecraft) { runtime.step(spacecraft, mission.timeStep); });
+
+    std::cout << " - Spacecraft step, " << count << " spacecraft for " << steps << " steps (time per spacecraft step):" << std::endl;
+    printBenchmark("virtual update()", virtualTime, virtualTime);
+    printBenchmark("StandardPipeline::step", staticTime, virtualTime);
+    printBenchmark("findPipeline(\"standard\").step", runtimeTime, virtualTime);
+}
+
+
+struct BenchmarkEntry
+{
+    const char* name;
+    void (*run)(Scenario* scenario);
+};
+
+static const BenchmarkEntry BENCHMARKS[] = {
+    { "pid", benchmarkPIDs },
+    { "pipeline", benchmarkPipeline },
+    { "vector", benchmarkVector },
+    { "fleet", benchmarkFleet },
+    { "atmosphere", benchmarkAtmosphere },
+    { "forces", benchmarkForces },
+    { "force-pipeline", benchmarkForcePipeline },
+    { "harmonics", benchmarkHarmonics },
+    { "proximity", benchmarkProximity },
+    { "conjunctions", benchmarkConjunctions },
+    { "kepler", benchmarkKepler },
+    { "soi", benchmarkSphereOfInfluence },
+    { "lambert", benchmarkLambert },
+    { "ephemeris", benchmarkEphemeris },
+    { "frames", benchmarkFrames },
+    { "attitude", benchmarkAttitude },
+    { "matrix", benchmarkMatrix },
+    { "propulsion", benchmarkPropulsion },
+};
+
+int runBenchmarks(Scenario* scenario, const std::string& filter)
+{
+    int count = 0;
+    benchmarkFailures = 0;
+
+    for (const auto& benchmark : BENCHMARKS)
+    {
+        if (std::string(benchmark.name).find(filter) == std::string::npos)
+        {
+            continue;
+        }
+
+        std::cout << "Benchmark " << benchmark.name << std::endl;
+        benchmark.run(scenario);
+        count++;
+    }
+
+    if (count == 0)
+    {
+        std::cerr << "No benchmark matches " << filter << std::endl;
+        return 1;
+    }
+
+    if (benchmarkFailures > 0)
+    {
+        std::cerr << benchmarkFailures << " benchmark accuracy check(s) failed." << std::endl;
+        return 2;
+    }
+
+    return 0;
+}
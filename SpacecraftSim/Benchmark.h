@@ -0,0 +1,23 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+class Scenario;
+
+// Times fn over `repetitions` calls and returns the best of `trials` runs in seconds per call
+double measureSeconds(const std::function<void()>& fn, uint64_t repetitions, int trials = 5);
+
+// Prints one benchmark line: name, time per item and speedup against a baseline time per item
+void printBenchmark(const std::string& name, double secondsPerItem, double baselineSecondsPerItem);
+
+// Runs the benchmarks whose name contains `filter`; an empty filter runs all of them.
+// Benchmarks that fly spacecraft use the compiled scenario.
+// return code not 0 means error
+// 1 : No benchmark matches the filter.
+// 2 : A benchmark's accuracy check failed.
+int runBenchmarks(Scenario* scenario, const std::string& filter);
+
+#endif // BENCHMARK_H
@@ -50,6 +50,12 @@ std::vector<std::string> CSVParser::peek()
 
 
 void CSVParser::verifyHeaders(std::vector<std::string>& headers)
+{
+    verifyHeaders(headers, headers.size());
+}
+
+
+size_t CSVParser::verifyHeaders(std::vector<std::string>& headers, size_t required)
 {
     std::streampos currentPos = _file.tellg();
     std::string headerLineStr;
@@ -62,11 +68,12 @@ void CSVParser::verifyHeaders(std::vector<std::string>& headers)
     headerLineStr = headerLineStream.str();
     std::vector<std::string> headerLine = split(headerLineStr, ',');
 
-    if (headerLine.size() != headers.size())
+    if (headerLine.size() < required || headerLine.size() > headers.size())
     {
-        throw std::runtime_error("Error: Incorrect number of headers. Expected " + std::to_string(headers.size()) + " but got " + std::to_string(headerLine.size()));
+        std::string expected = required == headers.size() ? std::to_string(headers.size()) : std::to_string(required) + " to " + std::to_string(headers.size());
+        throw std::runtime_error("Error: Incorrect number of headers. Expected " + expected + " but got " + std::to_string(headerLine.size()));
     }
-    for (int i = 0; i < (int)headers.size(); i++)
+    for (int i = 0; i < (int)headerLine.size(); i++)
     {
         if (headerLine[i] != headers[i])
         {
@@ -74,6 +81,7 @@ void CSVParser::verifyHeaders(std::vector<std::string>& headers)
         }
     }
     _file.seekg(currentPos);
+    return headerLine.size();
 }
 
 
@@ -15,6 +15,8 @@ class CSVParser
         std::vector<std::string> next();
         std::vector<std::string> peek();
         void verifyHeaders(std::vector<std::string>& headers);
+        // The headers after the first `required` may be left off the end of the line; returns how many are there
+        size_t verifyHeaders(std::vector<std::string>& headers, size_t required);
         void verifyFile(const std::string& filename);
         bool isValid();
         std::vector<std::string> getRow() const { return _currentLine; }
@@ -0,0 +1,91 @@
+#include "Checkpoint.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+bool CheckpointWriter::writeAsync(std::vector<char>&& buffer, const std::string& filepath)
+{
+    if (_busy)
+    {
+        return false;
+    }
+
+    if (_thread.joinable())
+    {
+        _thread.join();
+    }
+
+    _busy = true;
+
+    _thread = std::thread([this, filepath](std::vector<char> data)
+    {
+        if (!writeCheckpointFile(data, filepath))
+        {
+            std::cerr << "Could not write checkpoint file " << filepath << std::endl;
+        }
+
+        _busy = false;
+    }, std::move(buffer));
+
+    return true;
+}
+
+void CheckpointWriter::wait()
+{
+    if (_thread.joinable())
+    {
+        _thread.join();
+    }
+}
+
+bool writeCheckpointFile(const std::vector<char>& buffer, const std::string& filepath)
+{
+    std::string tempPath = filepath + ".tmp";
+
+    {
+        std::ofstream file(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+
+        if (!file.is_open())
+        {
+            return false;
+        }
+
+        file.write(buffer.data(), buffer.size());
+
+        if (!file.good())
+        {
+            return false;
+        }
+    }
+
+    // Replace the previous file in one step; it is never removed first, so there is always a
+    // whole checkpoint on disk. std::rename fails on Windows when the target exists.
+#ifdef _WIN32
+    return MoveFileExA(tempPath.c_str(), filepath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return std::rename(tempPath.c_str(), filepath.c_str()) == 0;
+#endif
+}
+
+std::vector<char> readCheckpointFile(const std::string& filepath)
+{
+    std::ifstream file(filepath, std::ios::in | std::ios::binary);
+
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Error: Could not open checkpoint file " + filepath);
+    }
+
+    return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
@@ -0,0 +1,118 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Identifies a checkpoint file and its layout. Bump the version whenever the layout changes.
+static const char CHECKPOINT_MAGIC[8] = { 'S', 'C', 'S', 'I', 'M', 'C', 'K', 'P' };
+static const uint32_t CHECKPOINT_VERSION = 10;
+
+// Appends raw values to a byte buffer. Doubles are stored bit for bit so a restored
+// run resumes bit-identically.
+class BinaryWriter
+{
+    public:
+        BinaryWriter() {}
+        ~BinaryWriter() {}
+
+        template<typename T>
+        void write(const T& value)
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "BinaryWriter can only write trivially copyable types");
+
+            const char* bytes = reinterpret_cast<const char*>(&value);
+            _buffer.insert(_buffer.end(), bytes, bytes + sizeof(T));
+        }
+
+        void writeString(const std::string& value)
+        {
+            write<uint32_t>(static_cast<uint32_t>(value.size()));
+            _buffer.insert(_buffer.end(), value.begin(), value.end());
+        }
+
+        std::vector<char>& getBuffer() { return _buffer; }
+
+    protected:
+        std::vector<char> _buffer;
+};
+
+// Reads values back in the order they were written. Throws if the buffer is truncated.
+class BinaryReader
+{
+    public:
+        BinaryReader(std::vector<char> buffer) : _buffer(std::move(buffer)), _offset(0) {}
+        ~BinaryReader() {}
+
+        template<typename T>
+        T read()
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "BinaryReader can only read trivially copyable types");
+
+            require(sizeof(T));
+
+            T value;
+            std::memcpy(&value, _buffer.data() + _offset, sizeof(T));
+            _offset += sizeof(T);
+            return value;
+        }
+
+        template<typename T>
+        void read(T& value) { value = read<T>(); }
+
+        std::string readString()
+        {
+            auto size = read<uint32_t>();
+            require(size);
+
+            std::string value(_buffer.data() + _offset, size);
+            _offset += size;
+            return value;
+        }
+
+        bool atEnd() const { return _offset == _buffer.size(); }
+
+    protected:
+        void require(size_t size) const
+        {
+            if (_offset + size > _buffer.size())
+            {
+                throw std::runtime_error("Error: Checkpoint is truncated at byte " + std::to_string(_offset));
+            }
+        }
+
+        std::vector<char> _buffer;
+        size_t _offset;
+};
+
+// Writes snapshots to disk on a background thread so the step loop never waits on I/O.
+// Files are written to a temporary path and renamed, so a crash mid-write keeps the previous checkpoint.
+class CheckpointWriter
+{
+    public:
+        CheckpointWriter() : _busy(false) {}
+        ~CheckpointWriter() { wait(); }
+
+        // Returns false if the previous checkpoint is still being written, in which case this one is dropped
+        bool writeAsync(std::vector<char>&& buffer, const std::string& filepath);
+
+        // Blocks until the write in flight (if any) has finished
+        void wait();
+
+        bool isBusy() const { return _busy; }
+
+    protected:
+        std::thread _thread;
+        std::atomic<bool> _busy;
+};
+
+bool writeCheckpointFile(const std::vector<char>& buffer, const std::string& filepath);
+std::vector<char> readCheckpointFile(const std::string& filepath);
+
+#endif // CHECKPOINT_H
@@ -0,0 +1,416 @@
+#include "ConjunctionScreener.h"
+
+#include "Parallel.h"
+#include "Planet.h"
+
+#include <algorithm>
+#include <cmath>
+
+static const double HALF_PI = 0.5 * 3.14159265358979323846;
+
+// Node windows wider than this no longer keep points near one node away from the other
+static const double MAX_NODE_WINDOW = HALF_PI / 3.0;
+
+ConjunctionSettings::ConjunctionSettings() : threshold(1000.0), padding(2000.0), timePadding(60.0), duration(86400.0), step(10.0),
+    filters(true), threads(defaultThreadCount())
+{
+}
+
+
+ConjunctionScreener::ConjunctionScreener(const Planet* planet, const ConjunctionSettings& settings) : _planet(planet), _settings(settings)
+{
+}
+
+Vector3<double> ConjunctionScreener::acceleration(const Vector3<double>& position) const
+{
+    return _planet->getGravitationalAcceleration(position) + _planet->getHarmonicAcceleration(position);
+}
+
+void ConjunctionScreener::propagate(Vector3<double>& position, Vector3<double>& velocity, double dt) const
+{
+    auto k1v = acceleration(position);
+    auto k1r = velocity;
+    auto k2v = acceleration(position + k1r * (0.5 * dt));
+    auto k2r = velocity + k1v * (0.5 * dt);
+    auto k3v = acceleration(position + k2r * (0.5 * dt));
+    auto k3r = velocity + k2v * (0.5 * dt);
+    auto k4v = acceleration(position + k3r * dt);
+    auto k4r = velocity + k3v * dt;
+
+    position = position + (k1r + k2r * 2.0 + k3r * 2.0 + k4r) * (dt / 6.0);
+    velocity = velocity + (k1v + k2v * 2.0 + k3v * 2.0 + k4v) * (dt / 6.0);
+}
+
+bool ConjunctionScreener::passesApsides(const Screened& a, const Screened& b) const
+{
+    double reach = _settings.threshold + _settings.padding;
+
+    return std::max(a.elements.getPeriapsis(), b.elements.getPeriapsis()) - reach <= std::min(a.elements.getApoapsis(), b.elements.getApoapsis());
+}
+
+double ConjunctionScreener::nodeWindow(const Screened& a, double sinRelativeInclination) const
+{
+    double reach = _settings.threshold + _settings.padding;
+    double ratio = reach / (a.elements.getPeriapsis() * sinRelativeInclination);
+
+    return ratio < std::sin(MAX_NODE_WINDOW) ? std::asin(ratio) : HALF_PI;
+}
+
+// Smallest and largest radius of an orbit for anomalies within halfWidth of center
+static std::pair<double, double> radiusRange(const OrbitalElements& elements, double center, double halfWidth)
+{
+    const double TWO_PI = 4.0 * HALF_PI;
+    double first = center - halfWidth;
+
+    auto contains = [&](double anomaly)
+    {
+        double offset = std::fmod(anomaly - first, TWO_PI);
+        return (offset < 0 ? offset + TWO_PI : offset) <= 2.0 * halfWidth;
+    };
+
+    double r0 = elements.getRadius(first), r1 = elements.getRadius(center + halfWidth);
+
+    return std::make_pair(contains(0.0) ? elements.getPeriapsis() : std::min(r0, r1),
+        contains(2.0 * HALF_PI) ? elements.getApoapsis() : std::max(r0, r1));
+}
+
+bool ConjunctionScreener::passesPath(const Screened& a, const Screened& b, bool nodes[2]) const
+{
+    nodes[0] = nodes[1] = true;
+
+    if (!a.elements.isClosed() || !b.elements.isClosed())
+    {
+        return true;
+    }
+
+    auto line = a.elements.normal.cross(b.elements.normal);
+    double sinRelativeInclination = line.magnitude();
+
+    double halfA = nodeWindow(a, sinRelativeInclination), halfB = nodeWindow(b, sinRelativeInclination);
+    if (halfA >= HALF_PI || halfB >= HALF_PI)
+    {
+        return true;
+    }
+
+    line = line / sinRelativeInclination;
+    double reach = _settings.threshold + _settings.padding;
+
+    for (int node = 0; node < 2; node++)
+    {
+        auto direction = node == 0 ? line : line * -1.0;
+        auto rangeA = radiusRange(a.elements, a.elements.getAnomalyOf(direction), halfA);
+        auto rangeB = radiusRange(b.elements, b.elements.getAnomalyOf(direction), halfB);
+
+        nodes[node] = rangeA.first - reach <= rangeB.second && rangeB.first - reach <= rangeA.second;
+    }
+
+    return nodes[0] || nodes[1];
+}
+
+void ConjunctionScreener::anomalyWindows(const Screened& a, double center, double halfWidth, std::vector<TimeWindow>& windows) const
+{
+    const auto& elements = a.elements;
+    const double TWO_PI = 4.0 * HALF_PI;
+    const double meanMotion = elements.getMeanMotion();
+    const double period = TWO_PI / meanMotion;
+
+    double entry = elements.getMeanAnomaly(center - halfWidth);
+    double exit = elements.getMeanAnomaly(center + halfWidth);
+    double now = elements.getMeanAnomaly(elements.trueAnomaly);
+
+    double width = std::fmod(exit - entry + TWO_PI, TWO_PI) / meanMotion;
+    double first = std::fmod(entry - now + TWO_PI, TWO_PI) / meanMotion;
+
+    // Already inside the window
+    if (first > period - width)
+    {
+        first -= period;
+    }
+
+    windows.clear();
+    for (double t = first; t - _settings.timePadding < _settings.duration; t += period)
+    {
+        windows.push_back(TimeWindow(std::max(0.0, t - _settings.timePadding), std::min(_settings.duration, t + width + _settings.timePadding)));
+    }
+}
+
+void ConjunctionScreener::findTimeWindows(const Screened& a, const Screened& b, const bool nodes[2], std::vector<TimeWindow>& windows) const
+{
+    windows.clear();
+
+    auto line = a.elements.normal.cross(b.elements.normal);
+    double sinRelativeInclination = line.magnitude();
+
+    double halfA = a.elements.isClosed() ? nodeWindow(a, sinRelativeInclination) : HALF_PI;
+    double halfB = b.elements.isClosed() ? nodeWindow(b, sinRelativeInclination) : HALF_PI;
+
+    // Nothing to narrow the search with
+    if (halfA >= HALF_PI || halfB >= HALF_PI)
+    {
+        windows.push_back(TimeWindow(0.0, _settings.duration));
+        return;
+    }
+
+    line = line / sinRelativeInclination;
+    std::vector<TimeWindow> windowsA, windowsB;
+
+    for (int node = 0; node < 2; node++)
+    {
+        if (!nodes[node])
+        {
+            continue;
+        }
+
+        auto direction = node == 0 ? line : line * -1.0;
+        anomalyWindows(a, a.elements.getAnomalyOf(direction), halfA, windowsA);
+        anomalyWindows(b, b.elements.getAnomalyOf(direction), halfB, windowsB);
+
+        // Both inside at once
+        for (size_t i = 0, j = 0; i < windowsA.size() && j < windowsB.size();)
+        {
+            double start = std::max(windowsA[i].first, windowsB[j].first);
+            double end = std::min(windowsA[i].second, windowsB[j].second);
+
+            if (start < end)
+            {
+                windows.push_back(TimeWindow(start, end));
+            }
+
+            if (windowsA[i].second < windowsB[j].second)
+            {
+                i++;
+            }
+            else
+            {
+                j++;
+            }
+        }
+    }
+
+    // Sorted and merged, the two nodes interleave
+    std::sort(windows.begin(), windows.end());
+
+    size_t merged = 0;
+    for (size_t i = 0; i < windows.size(); i++)
+    {
+        if (merged > 0 && windows[i].first <= windows[merged - 1].second)
+        {
+            windows[merged - 1].second = std::max(windows[merged - 1].second, windows[i].second);
+        }
+        else
+        {
+            windows[merged++] = windows[i];
+        }
+    }
+    windows.resize(merged);
+}
+
+void ConjunctionScreener::search(const Screened& primary, const Trajectory& trajectory, const Screened& secondary,
+    const std::vector<TimeWindow>& windows, std::vector<Conjunction>& conjunctions) const
+{
+    if (windows.empty())
+    {
+        return;
+    }
+
+    const double h = _settings.step;
+    const size_t steps = trajectory.position.size() - 1;
+
+    auto position = secondary.object.position;
+    auto velocity = secondary.object.velocity;
+    double rate = (position - trajectory.position[0]).dot(velocity - trajectory.velocity[0]);
+    size_t window = 0;
+
+    for (size_t k = 0; k < steps && k * h < windows.back().second; k++)
+    {
+        auto nextPosition = position, nextVelocity = velocity;
+        propagate(nextPosition, nextVelocity, h);
+
+        double nextRate = (nextPosition - trajectory.position[k + 1]).dot(nextVelocity - trajectory.velocity[k + 1]);
+
+        for (; window < windows.size() && windows[window].second < k * h; window++);
+
+        // Range rate turns from closing to opening inside a window
+        if (rate < 0 && nextRate >= 0 && window < windows.size() && windows[window].first <= (k + 1) * h)
+        {
+            Vector3<double> p, v, q, w;
+
+            auto stateAt = [&](double tau)
+            {
+                p = position; v = velocity;
+                q = trajectory.position[k]; w = trajectory.velocity[k];
+                propagate(p, v, tau);
+                propagate(q, w, tau);
+                return (p - q).dot(v - w);
+            };
+
+            // Illinois regula falsi over [0, h]
+            double a = 0.0, b = h, fa = rate, fb = nextRate;
+            int side = 0;
+
+            for (int i = 0; i < 100 && (b - a) > 1e-9 * h; i++)
+            {
+                double c = (a * fb - b * fa) / (fb - fa);
+                if (!(c > a && c < b))
+                {
+                    c = 0.5 * (a + b);
+                }
+
+                double fc = stateAt(c);
+                if (fc == 0.0)
+                {
+                    a = b = c;
+                    break;
+                }
+
+                if ((fc < 0) == (fb < 0))
+                {
+                    b = c;
+                    fb = fc;
+                    if (side == -1)
+                    {
+                        fa *= 0.5;
+                    }
+                    side = -1;
+                }
+                else
+                {
+                    a = c;
+                    fa = fc;
+                    if (side == 1)
+                    {
+                        fb *= 0.5;
+                    }
+                    side = 1;
+                }
+            }
+
+            double tau = 0.5 * (a + b);
+            stateAt(tau);
+            double distance = (p - q).magnitude();
+
+            if (distance <= _settings.threshold)
+            {
+                Conjunction conjunction;
+                conjunction.primary = primary.object.id;
+                conjunction.secondary = secondary.object.id;
+                conjunction.time = k * h + tau;
+                conjunction.missDistance = distance;
+                conjunction.relativeSpeed = (v - w).magnitude();
+                conjunction.primaryPosition = q;
+                conjunction.secondaryPosition = p;
+                conjunctions.push_back(conjunction);
+            }
+        }
+
+        position = nextPosition;
+        velocity = nextVelocity;
+        rate = nextRate;
+    }
+}
+
+std::vector<Conjunction> ConjunctionScreener::screen(const std::vector<ScreeningObject>& primaries, const std::vector<ScreeningObject>& catalog)
+{
+    const double mu = _planet->getGravititationParameter();
+    const unsigned int threads = std::max(1u, _settings.threads);
+    const size_t steps = static_cast<size_t>(std::ceil(_settings.duration / _settings.step));
+
+    _statistics = ScreeningStatistics();
+
+    std::vector<Screened> screened(catalog.size());
+    parallelFor(catalog.size(), threads, [&](uint64_t i, unsigned int)
+    {
+        screened[i].object = catalog[i];
+        screened[i].elements = OrbitalElements::fromState(catalog[i].position, catalog[i].velocity, mu);
+    });
+
+    std::vector<std::vector<Conjunction> > workerConjunctions(threads);
+    std::vector<std::vector<TimeWindow> > workerWindows(threads);
+    std::vector<ScreeningStatistics> workerStatistics(threads);
+
+    for (const auto& object : primaries)
+    {
+        Screened primary;
+        primary.object = object;
+        primary.elements = OrbitalElements::fromState(object.position, object.velocity, mu);
+
+        // Integrated once, every secondary is checked against it
+        Trajectory trajectory;
+        trajectory.position.resize(steps + 1);
+        trajectory.velocity.resize(steps + 1);
+        trajectory.position[0] = object.position;
+        trajectory.velocity[0] = object.velocity;
+
+        for (size_t k = 0; k < steps; k++)
+        {
+            trajectory.position[k + 1] = trajectory.position[k];
+            trajectory.velocity[k + 1] = trajectory.velocity[k];
+            propagate(trajectory.position[k + 1], trajectory.velocity[k + 1], _settings.step);
+        }
+
+        parallelFor(screened.size(), threads, [&](uint64_t i, unsigned int worker)
+        {
+            const auto& secondary = screened[i];
+            if (secondary.object.id == object.id)
+            {
+                return;
+            }
+
+            auto& statistics = workerStatistics[worker];
+            auto& windows = workerWindows[worker];
+            statistics.pairs++;
+
+            if (_settings.filters)
+            {
+                bool nodes[2];
+
+                if (!passesApsides(primary, secondary))
+                {
+                    return;
+                }
+                statistics.afterApsides++;
+
+                if (!passesPath(primary, secondary, nodes))
+                {
+                    return;
+                }
+                statistics.afterPath++;
+
+                findTimeWindows(primary, secondary, nodes, windows);
+                if (windows.empty())
+                {
+                    return;
+                }
+                statistics.afterTime++;
+            }
+            else
+            {
+                windows.assign(1, TimeWindow(0.0, _settings.duration));
+                statistics.afterApsides++;
+                statistics.afterPath++;
+                statistics.afterTime++;
+            }
+
+            search(primary, trajectory, secondary, windows, workerConjunctions[worker]);
+        });
+    }
+
+    std::vector<Conjunction> conjunctions;
+    for (unsigned int w = 0; w < threads; w++)
+    {
+        conjunctions.insert(conjunctions.end(), workerConjunctions[w].begin(), workerConjunctions[w].end());
+
+        _statistics.pairs += workerStatistics[w].pairs;
+        _statistics.afterApsides += workerStatistics[w].afterApsides;
+        _statistics.afterPath += workerStatistics[w].afterPath;
+        _statistics.afterTime += workerStatistics[w].afterTime;
+    }
+
+    std::sort(conjunctions.begin(), conjunctions.end(), [](const Conjunction& a, const Conjunction& b)
+    {
+        return a.missDistance < b.missDistance || (a.missDistance == b.missDistance && (a.primary < b.primary || (a.primary == b.primary && a.secondary < b.secondary)));
+    });
+
+    _statistics.conjunctions = conjunctions.size();
+    return conjunctions;
+}
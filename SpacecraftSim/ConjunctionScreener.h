@@ -0,0 +1,135 @@
+#ifndef CONJUNCTIONSCREENER_H
+#define CONJUNCTIONSCREENER_H
+
+#include "OrbitalElements.h"
+#include "Vector3.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+class Planet;
+
+// An object's state at the start of the screening window, relative to the planet's center
+struct ScreeningObject
+{
+    ScreeningObject() : id(0) {}
+    ScreeningObject(uint32_t _id, Vector3<double> _position, Vector3<double> _velocity) : id(_id), position(_position), velocity(_velocity) {}
+    ~ScreeningObject() {}
+
+    uint32_t id;
+    Vector3<double> position;
+    Vector3<double> velocity;
+};
+
+struct Conjunction
+{
+    Conjunction() : primary(0), secondary(0), time(0), missDistance(0), relativeSpeed(0) {}
+    ~Conjunction() {}
+
+    uint32_t primary, secondary;    // ids
+    double time;                    // of closest approach, from the start of the window
+    double missDistance;
+    double relativeSpeed;
+    Vector3<double> primaryPosition;
+    Vector3<double> secondaryPosition;
+};
+
+struct ConjunctionSettings
+{
+    ConjunctionSettings();
+    ~ConjunctionSettings() {}
+
+    double threshold;       // report approaches closer than this
+    double padding;         // added to the threshold in the filters, for the drift from two-body motion
+    double timePadding;     // added to both ends of each time window, for the same
+    double duration;        // of the screening window
+    double step;            // of the numerical propagation
+    bool filters;           // false skips the cascade and searches every pair; the reference for checks
+    unsigned int threads;
+};
+
+// Pairs left after each stage of the last screen
+struct ScreeningStatistics
+{
+    ScreeningStatistics() : pairs(0), afterApsides(0), afterPath(0), afterTime(0), conjunctions(0) {}
+    ~ScreeningStatistics() {}
+
+    uint64_t pairs;
+    uint64_t afterApsides;
+    uint64_t afterPath;
+    uint64_t afterTime;
+    uint64_t conjunctions;
+};
+
+
+// Screens primaries against a catalog for close approaches over a time window around one planet.
+//
+// Three filters on the osculating two-body orbits at the start of the window prune the pairs, the
+// classic cascade:
+//  - Apsides: the radius ranges [periapsis, apoapsis] of the two orbits must overlap.
+//  - Path: away from the line where the two orbit planes cross, a point of one orbit is out of the
+//    other plane by r * sin(relative inclination) * sin(angle from the line). So close points lie
+//    in an anomaly window around one of the two nodes on both orbits, and the radius ranges of the
+//    two orbits over those windows must overlap.
+//  - Time: both objects must be inside their window of the same node at the same time.
+// The distances in the filters carry the padding and the times the time padding, which absorb
+// what the planet's harmonics move the orbits over the window.
+//
+// The pairs left are propagated with RK4 under the planet's gravity, point mass and harmonics,
+// through the time windows. A closest approach is where the range rate turns from negative to
+// positive; it is bracketed on the step grid and found by Illinois regula falsi, re-integrating
+// from the step start. The primaries' trajectories are integrated once and shared.
+//
+// Filters and the search run in parallel over the catalog.
+class ConjunctionScreener
+{
+    public:
+        ConjunctionScreener(const Planet* planet, const ConjunctionSettings& settings = ConjunctionSettings());
+        ~ConjunctionScreener() {}
+
+        // Conjunctions closer than the threshold, ranked by miss distance
+        std::vector<Conjunction> screen(const std::vector<ScreeningObject>& primaries, const std::vector<ScreeningObject>& catalog);
+
+        const ScreeningStatistics& getStatistics() const { return _statistics; }
+        const ConjunctionSettings& getSettings() const { return _settings; }
+
+        // One RK4 step of the planet's gravity, relative to its center
+        void propagate(Vector3<double>& position, Vector3<double>& velocity, double dt) const;
+
+    protected:
+        typedef std::pair<double, double> TimeWindow;
+
+        struct Screened
+        {
+            ScreeningObject object;
+            OrbitalElements elements;
+        };
+
+        struct Trajectory
+        {
+            std::vector<Vector3<double> > position;
+            std::vector<Vector3<double> > velocity;
+        };
+
+        Vector3<double> acceleration(const Vector3<double>& position) const;
+
+        // Each filter returns false to reject; the time filter leaves the windows to search
+        bool passesApsides(const Screened& a, const Screened& b) const;
+        bool passesPath(const Screened& a, const Screened& b, bool nodes[2]) const;
+        void findTimeWindows(const Screened& a, const Screened& b, const bool nodes[2], std::vector<TimeWindow>& windows) const;
+
+        // Anomaly half width of the windows around the nodes, pi / 2 when the whole orbit is close enough
+        double nodeWindow(const Screened& a, double sinRelativeInclination) const;
+        // Times in [0, duration] when the anomaly is within halfWidth of center
+        void anomalyWindows(const Screened& a, double center, double halfWidth, std::vector<TimeWindow>& windows) const;
+
+        void search(const Screened& primary, const Trajectory& trajectory, const Screened& secondary,
+            const std::vector<TimeWindow>& windows, std::vector<Conjunction>& conjunctions) const;
+
+        const Planet* _planet;
+        ConjunctionSettings _settings;
+        ScreeningStatistics _statistics;
+};
+
+#endif // CONJUNCTIONSCREENER_H
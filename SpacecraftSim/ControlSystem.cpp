@@ -8,215 +8,303 @@
 #include "VelocityController.h"
 #include "AccelerationController.h"
 
+#include <algorithm>
+
+// Attitude controller: the commanded slew rate per radian of pointing error, and the rate at
+// which the body rate closes on it, both 1/s
+static const double POINTING_GAIN = 0.2;
+static const double RATE_GAIN = 0.5;
+
+static bool sameVector(const Vector3<double>& a, const Vector3<double>& b)
+{
+    return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
 ControlSystem::ControlSystem(Spacecraft* spacecraft) : _spacecraft(spacecraft), //_positionController(new PositionController()), _velocityController(new VelocityController()),  _accelerationController(new AccelerationController())
-   _position(0.0, 0.0, 0.0), _velocity(0.0, 0.0, 0.0), _acceleration(0.0, 0.0, 0.0), _accelerationController(), _positionController(), _velocityController()
+   _engine(nullptr), _fuelMass(0.0), _burnTime(0.0), _throttle(0.0),
+   _position(0.0, 0.0, 0.0), _velocity(0.0, 0.0, 0.0), _acceleration(0.0, 0.0, 0.0), _accelerationController(), _positionController(), _velocityController(),
+   _forces(nullptr), _coastTolerance(0.0), _coasting(false), _coastTime(0.0), _coastCountdown(0), _missionTime(0.0), _landed(false), _verbose(true)
 {
 }
 
 
 void ControlSystem::update(double elapsedTime)
 {
-    // Get current spacecraft information
-    auto currentPos = _spacecraft->getPosition();
-    auto currentVel = _spacecraft->getVelocity();
-    auto currentAccel = _spacecraft->getAcceleration();
-    auto currentOrient = _spacecraft->getOrientation();
-
     updateGNC();
+    updateControllers(elapsedTime);
+    integrate(elapsedTime);
+}
 
-    // Update the position, velocity, and acceleration controllers
-   // _accelerationController.update(elapsedTime, _targetAcceleration, _acceleration);
-    //setAcceleration(_accelerationController.getAcceleration());
-
-    //setVelocity(getVelocity() + getAcceleration() * elapsedTime);
-    //setPosition(getPosition() + getVelocity() * elapsedTime);
-    _positionController.update(elapsedTime, getTargetPosition(), _position);
-    _velocityController.update(elapsedTime, _positionController.getOutput(), _velocity);
-    //_accelerationController.update(elapsedTime, _velocityController.getOutput(), _acceleration);
-    auto acceleration = _velocityController.getOutput();
-    auto velocity = acceleration * elapsedTime;
-
-    _velocity.x = std::clamp(velocity.x, -_spacecraft->getMaxVelocity(), _spacecraft->getMaxVelocity());
-    _velocity.y = std::clamp(velocity.y, -_spacecraft->getMaxVelocity(), _spacecraft->getMaxVelocity());
-    _velocity.z = std::clamp(velocity.z, -_spacecraft->getMaxVelocity(), _spacecraft->getMaxVelocity());
-
-    setPosition(getPosition() + getVelocity() * elapsedTime);
-    // _spacecraft->applyThrust(_thrust);
-
-    // Update the velocity due to acceleration
-   // _spacecraft->setVelocity(currentVel + _spacecraft->getAcceleration() * elapsedTime);
-
-    // Update the position of the spacecraft based on its velocity
-   // _spacecraft->setPosition(currentPos + _spacecraft->getVelocity() * elapsedTime);
 
-#if 0
-    // Get planet information
-    auto planet = _spacecraft->getAssociatedPlanet();
+// Handles the boundary crossings of the step just integrated, then any change of central body
+void ControlSystem::handleStepEvents(const Vector3<double>& previousPosition, double elapsedTime)
+{
+    // Locate boundary crossings inside the step and respond to them in time order
+    auto events = _eventDetector.detect(_spacecraft->getName(), _missionTime, elapsedTime, previousPosition, getPosition());
 
-    if (planet)
+    for (const auto& event : events)
     {
-        // Get air density and cross-sectional area
-        double altitude = currentPos.magnitude() - planet->getRadius();
-        double airDensity = planet->calcAirDensity(altitude);
-        double crossSectionalArea = planet->calcCrossSectionalArea(_spacecraft->getArea());
+        handleEvent(event);
+        _eventDetector.fire(event);
 
-        // Calculate drag force
-        double velMag = currentVel.magnitude();
-        double dragCoef = planet->calcDragCoefficient(velMag);
-        Vector3<double> dragForce = -0.5 * airDensity * velMag  * velMag * crossSectionalArea * dragCoef * currentVel.normalize();
-
-        // Apply limits on drag force
-        double maxDragForce = planet->getMaxDragForce(_spacecraft->getArea(), _spacecraft->getMaxVelocity(), altitude);
-        if (dragForce.magnitude() > maxDragForce)
+        // Crossings later in the step happened after touchdown, so never
+        if (_landed)
         {
-            dragForce = dragForce.normalize() * maxDragForce;
+            break;
         }
+    }
 
-        // Update air resistance
-        Vector3<double> airResistanceVector = dragForce / planet->getMass();
+    // Numerical integration resumes after an event
+    if (!events.empty())
+    {
+        _coasting = false;
+    }
 
-        // Handle the case where airResistanceVector is infinity
-        if (std::isinf(airResistanceVector.x) || std::isinf(airResistanceVector.y) || std::isinf(airResistanceVector.z))
+    // Gravity is taken about the body whose sphere of influence the spacecraft is in
+    if (_forces && _forceContext.system && !_landed)
+    {
+        auto body = _forceContext.system->findDominantBody(getPosition());
+
+        if (body && body != _forceContext.planet)
         {
-            std::cout << "INFITITY AIR RESISTANCE!!!" << std::endl;
+            SimulationEvent event(EventType::SphereOfInfluenceEntry, _missionTime + elapsedTime, _spacecraft->getName(), body->getName(), getPosition());
+            handleEvent(event);
+            _eventDetector.fire(event);
         }
+    }
 
-        // Calculate the orientation-based thrust vector
-        Vector3<double> orientationThrust = currentOrient * getThrust();
-
-        // Update the acceleration due to gravity, air resistance, and orientation-based thrust
-        Vector3<double> gravitationalAcceleration = planet->getGravitationalAcceleration(currentPos);
+}
 
-        double distanceToCenter = currentPos.magnitude();
+// Advances the state along the conic while the spacecraft is ballistic
+bool ControlSystem::coast(double elapsedTime)
+{
+    if (!_forces || _coastTolerance <= 0 || _thrust.magnitudeSquared() != 0)
+    {
+        _coasting = false;
+        return false;
+    }
 
-        _spacecraft->setAcceleration((orientationThrust - airResistanceVector) / planet->getMass() - gravitationalAcceleration * (currentPos.normalize() / distanceToCenter));
+    // The controllers or a handled event moved the spacecraft since the last step
+    if (_coasting && (!sameVector(_position, _coastPosition) || !sameVector(_velocity, _coastVelocity)))
+    {
+        _coasting = false;
+        _coastCountdown = 0;
     }
-    else
+
+    if (!_coasting && (_coastCountdown-- > 0 || !startCoast()))
     {
-        // TODO: Should thrust still be going if we are in space?
-        _spacecraft->setAcceleration(getThrust());
+        return false;
     }
 
-    // Update the velocity due to acceleration
-    _spacecraft->setVelocity(currentVel + _spacecraft->getAcceleration() * elapsedTime);
+    auto planet = _forceContext.planet;
+    Vector3<double> position, velocity;
 
-    // Update the position of the spacecraft based on its velocity
-    _spacecraft->setPosition(currentPos + _spacecraft->getVelocity() * elapsedTime);
+    _coastTime += elapsedTime;
+    _coast.getState(_coastTime, position, velocity);
 
-    updateGNC();
-#endif
-}
+    _position = planet->getCenterPosition() + position;
+    _velocity = planet->getCenterVelocity() + velocity;
+    _acceleration = planet->getGravitationalAcceleration(position);
 
-// Adding the PID controller
-void ControlSystem::setPID(double kp, double ki, double kd) {
-    
-    /*_kp = kp;
-    _ki = ki;
-    _kd = kd;*/
-}
+    _coastPosition = _position;
+    _coastVelocity = _velocity;
 
-void ControlSystem::updatePID(double error) {
-    /*
-    // Calculate the proportional term
-    double p = error * _kp;
+    // Open orbits leave for where other bodies pull harder
+    if (--_coastCountdown <= 0)
+    {
+        _coasting = isBallistic(position);
+        _coastCountdown = COAST_CHECK_STEPS;
+    }
 
-    // Integrate the error over time
-    _integral += error * _dt;
+    return true;
+}
 
-    // Calculate the integral term
-    double i = _integral * _ki;
+// Converts the state to a conic if the whole arc is ballistic
+bool ControlSystem::startCoast()
+{
+    _coastCountdown = COAST_CHECK_STEPS;
 
-    // Calculate the derivative term
-    auto denominator = _dt * _kd;
-    double d = 0.0;
+    auto planet = _forceContext.planet;
+    auto position = _position - planet->getCenterPosition();
 
-    if (denominator != 0.0)
+    if (!_coast.initialize(position, _velocity - planet->getCenterVelocity(), planet->getGravititationParameter()))
     {
-        d = (error - _previousError) / _dt * _kd;
+        return false;
     }
 
-    // Set the thrust based on the PID output
-    setThrust(Vector3<double>(p + i + d, 0, 0));
+    // Clear of the air all the way round
+    const auto& elements = _coast.getElements();
+    if (elements.getPeriapsis() <= planet->getAtmosphereRadius())
+    {
+        return false;
+    }
 
-    // Store the error for the next iteration
-    _previousError = error;
+    if (!isBallistic(position) || !isBallistic(elements.periapsisDirection * elements.getPeriapsis())
+        || (elements.isClosed() && !isBallistic(elements.periapsisDirection * -elements.getApoapsis())))
+    {
+        return false;
+    }
 
-    */
+    _coasting = true;
+    _coastTime = 0.0;
+    return true;
 }
 
+// Forces other than the central point mass are below the tolerance at a position relative to the planet
+bool ControlSystem::isBallistic(const Vector3<double>& position) const
+{
+    auto planet = _forceContext.planet;
+    auto central = planet->getGravitationalAcceleration(position);
+    auto total = _forces(_forceContext, ForceState(planet->getCenterPosition() + position, _velocity, Vector3<double>(0, 0, 0),
+        _spacecraft->getArea(), _spacecraft->getMass(), _spacecraft->getMaxVelocity()));
+
+    return (total - central).magnitude() <= _coastTolerance * central.magnitude();
+}
 
-void ControlSystem::updateGNC() 
+// Rate command proportional to the pointing error, capped at the spacecraft's angular velocity,
+// and a torque that closes the body rate on it with the gyroscopic term cancelled
+Vector3<double> ControlSystem::getControlTorque() const
 {
-    // Calculate the error between the home position and the spacecraft position
-    if (_spacecraft->getAssociatedPlanet())
+    if (_orientation.magnitudeSquared() == 0)
     {
-        // TODO: Eventually use surface position
-        Vector3<double> homeError = _spacecraft->getPosition() - _spacecraft->getAssociatedPlanet()->getCenterPosition();
+        return Vector3<double>(0, 0, 0);
+    }
 
-        // Check if the spacecraft is leaving the planet's atmosphere
-        // If the distance is greater than the atmosphere radius, disassociate from the planet
-        if (homeError.magnitude() > _spacecraft->getAssociatedPlanet()->getAtmosphereRadius())
-        {
-            // Disassociate the spacecraft from the planet
-            _spacecraft->disassociateFromPlanet();
-        }
+    auto turn = Quaternion<double>::fromTwoVectors(getBoresight(), _orientation.normalize());
+    auto error = _attitude.conjugate().rotate(turn.toRotationVector());
+
+    auto rate = error * POINTING_GAIN;
+    double maxRate = _spacecraft->getAngularVelocity();
 
+    if (rate.magnitude() > maxRate)
+    {
+        rate = rate.normalize() * maxRate;
     }
+
+    return _inertia.apply((rate - _bodyRate) * RATE_GAIN) + _bodyRate.cross(_inertia.apply(_bodyRate));
+}
+
+// Adding the PID controller
+void ControlSystem::setPID(double kp, double ki, double kd) {
     
-    // Calculate the error between the current position and the target position
-    Vector3<double> targetError = _spacecraft->getPosition() - getTargetPosition();
+    _positionController.setGains(kp, ki, kd);
+    _velocityController.setGains(kp, ki, kd);
+    _accelerationController.setGains(kp, ki, kd);
+}
+
+void ControlSystem::armEventGuards()
+{
+    _eventDetector.clearGuards();
 
-    if (targetError.magnitude() == 0)
+    auto planet = _spacecraft->getAssociatedPlanet();
+
+    if (planet)
     {
-        std::cout << "targetError = 0. Spacecraft has landed." << std::endl;
-        setAcceleration(Vector3<double>(0, 0, 0));
-        setVelocity(Vector3<double>(0, 0, 0));
+        // Leaving the atmosphere of the associated planet
+        _eventDetector.addGuard(EventGuard(EventType::AtmosphereExit, planet->getName(), planet->getCenterPosition(), planet->getAtmosphereRadius(), EventDirection::Rising));
+
+        // Touching down on the associated planet
+        _eventDetector.addGuard(EventGuard(EventType::SurfaceContact, planet->getName(), planet->getCenterPosition(), planet->getRadius(), EventDirection::Falling));
     }
-    // Check if the spacecraft is close enough to the target position to start landing
-    else if (targetError.magnitude() < getTargetPlanet().atmosphereRadius)
+
+    if (!_targetPlanet.name.empty())
     {
-        // Start landing sequence
-        // _spacecraft->setLanding(true);
+        // Close enough to the target position to start landing
+        _eventDetector.addGuard(EventGuard(EventType::TargetApproach, _targetPlanet.name, _targetPlanet.targetPosition, _targetPlanet.atmosphereRadius, EventDirection::Falling));
 
-        // Disassociate from the current planet
-        _spacecraft->disassociateFromPlanet();
+        if (!planet || planet->getName() != _targetPlanet.name)
+        {
+            _eventDetector.addGuard(EventGuard(EventType::SurfaceContact, _targetPlanet.name, _targetPlanet.targetPosition, _targetPlanet.radius, EventDirection::Falling));
+        }
+    }
+}
 
-        // Associate with the new planet
-        Planet* newPlanet = nullptr;
 
-        for (const auto& kv : _spacecraft->getScenario()->getSystems())
+void ControlSystem::handleEvent(const SimulationEvent& event)
+{
+    switch (event.type)
+    {
+    case EventType::AtmosphereExit:
+    {
+        // Disassociate the spacecraft from the planet
+        _spacecraft->disassociateFromPlanet();
+        break;
+    }
+    case EventType::TargetApproach:
+    {
+        // Start landing sequence by associating with the target planet
+        Planet* newPlanet = _spacecraft->getScenario()->findPlanet(event.planetName);
+
+        if (!newPlanet)
         {
-            auto planets = kv.second->getPlanets();
+            std::cerr << "Couldn't find planet name when updating GNC to associate new planet to spacecraft." << std::endl;
+        }
 
-            auto i = planets.find(getTargetPlanet().name);
+        _spacecraft->setAssociatedPlanet(newPlanet);
+        break;
+    }
+    case EventType::SurfaceContact:
+    {
+        Planet* planet = _spacecraft->getScenario()->findPlanet(event.planetName);
 
-            if (i != planets.end())
-            {
-                newPlanet = i->second;
-                break;
-            }
-            else
+        if (planet && planet->isLanded((event.position - planet->getCenterPosition()).magnitude()) && event.planetName == _targetPlanet.name)
+        {
+            if (_verbose)
             {
-                std::cerr << "Couldn't find planet name when updating GNC to associate new planet to spacecraft." << std::endl;
+                std::cout << "Spacecraft has landed on " << event.planetName << " at time " << event.time << "." << std::endl;
             }
-        }
 
-        _spacecraft->setAssociatedPlanet(newPlanet);
+            setPosition(event.position);
+            setAcceleration(Vector3<double>(0, 0, 0));
+            setVelocity(Vector3<double>(0, 0, 0));
+            setThrust(Vector3<double>(0, 0, 0));
+            _throttle = 0.0;
+            _coasting = false;
+            _landed = true;
+        }
+        break;
     }
+    case EventType::SphereOfInfluenceEntry:
+    {
+        // Hand over to the new central body. The state is absolute, so only the body gravity is
+        // taken about changes; a coast restarts on a conic about its center as it is at the next step.
+        Planet* planet = _spacecraft->getScenario()->findPlanet(event.planetName);
 
-    // Pass the error to the PID controller
-    updatePID(targetError.magnitude());
+        if (planet)
+        {
+            _forceContext.setCentralBody(planet);
+            _coasting = false;
+            _coastCountdown = 0;
+        }
+        break;
+    }
+    }
 
-    // Calculate the desired orientation based on the error
-    _spacecraft->setOrientation(targetError.normalize());
+    armEventGuards();
 }
 
 
 void ControlSystem::setTargetPlanet(Planet* planet)
 {
     // TODO: For now we are using center position. Eventually use calcSurfacePosition()
-    auto targetPlanet = TargetPlanet(planet->getName(), planet->getCenterPosition(), 100000.0);
+    auto targetPlanet = TargetPlanet(planet->getName(), planet->getCenterPosition(), 100000.0, planet->getRadius());
     _targetPlanet = targetPlanet;
+
+    armEventGuards();
+}
+
+
+// Moves the target position and the event guards to where the planets are now
+void ControlSystem::followPlanets()
+{
+    Planet* target = _targetPlanet.name.empty() ? nullptr : _spacecraft->getScenario()->findPlanet(_targetPlanet.name);
+
+    if (target)
+    {
+        _targetPlanet.targetPosition = target->getCenterPosition();
+    }
+
+    armEventGuards();
 }
 
 
@@ -233,3 +321,90 @@ void ControlSystem::applyThrust(Vector3<double> thrust)
 };
 
 
+void ControlSystem::saveState(BinaryWriter& writer) const
+{
+    writer.write(_thrust);
+    writer.write(_fuelMass);
+    writer.write(_burnTime);
+    writer.write(_throttle);
+    writer.write(_thrustDirection);
+    writer.writeString(_targetPlanet.name);
+    writer.write(_targetPlanet.targetPosition);
+    writer.write(_targetPlanet.atmosphereRadius);
+    writer.write(_targetPlanet.radius);
+    writer.write(_targetVelocity);
+    writer.write(_targetAcceleration);
+    writer.write(_position);
+    writer.write(_velocity);
+    writer.write(_acceleration);
+    writer.write(_orientation);
+    writer.write(_attitude);
+    writer.write(_bodyRate);
+    writer.write(_torque);
+    writer.write(_inertia.xx); writer.write(_inertia.yy); writer.write(_inertia.zz);
+    writer.write(_inertia.xy); writer.write(_inertia.xz); writer.write(_inertia.yz);
+    writer.write(_missionTime);
+    writer.write(_landed);
+
+    // The forces themselves are set again on restore, about this body
+    writer.writeString(_forceContext.planet ? _forceContext.planet->getName() : std::string());
+
+    writer.write(_coasting);
+    writer.write(_coastTime);
+    writer.write(_coastPosition);
+    writer.write(_coastVelocity);
+    writer.write(_coastCountdown);
+    _coast.saveState(writer);
+
+    _positionController.saveState(writer);
+    _velocityController.saveState(writer);
+    _accelerationController.saveState(writer);
+}
+
+
+void ControlSystem::loadState(BinaryReader& reader)
+{
+    reader.read(_thrust);
+    reader.read(_fuelMass);
+    reader.read(_burnTime);
+    reader.read(_throttle);
+    reader.read(_thrustDirection);
+    _targetPlanet.name = reader.readString();
+    reader.read(_targetPlanet.targetPosition);
+    reader.read(_targetPlanet.atmosphereRadius);
+    reader.read(_targetPlanet.radius);
+    reader.read(_targetVelocity);
+    reader.read(_targetAcceleration);
+    reader.read(_position);
+    reader.read(_velocity);
+    reader.read(_acceleration);
+    reader.read(_orientation);
+    reader.read(_attitude);
+    reader.read(_bodyRate);
+    reader.read(_torque);
+    reader.read(_inertia.xx); reader.read(_inertia.yy); reader.read(_inertia.zz);
+    reader.read(_inertia.xy); reader.read(_inertia.xz); reader.read(_inertia.yz);
+    reader.read(_missionTime);
+    reader.read(_landed);
+
+    auto centralBody = reader.readString();
+    _forceContext.setCentralBody(centralBody.empty() ? nullptr : _spacecraft->getScenario()->findPlanet(centralBody));
+
+    if (!centralBody.empty() && !_forceContext.planet)
+    {
+        throw std::runtime_error("Error: Checkpoint central body " + centralBody + " is not in the scenario.");
+    }
+
+    reader.read(_coasting);
+    reader.read(_coastTime);
+    reader.read(_coastPosition);
+    reader.read(_coastVelocity);
+    reader.read(_coastCountdown);
+    _coast.loadState(reader);
+
+    _inverseInertia = _inertia.inverse();
+
+    _positionController.loadState(reader);
+    _velocityController.loadState(reader);
+    _accelerationController.loadState(reader);
+}
@@ -4,9 +4,17 @@
 #include "PositionController.h"
 #include "VelocityController.h"
 #include "AccelerationController.h"
-
+#include "Attitude.h"
+#include "Checkpoint.h"
+#include "EventDetector.h"
+#include "ForcePipeline.h"
+#include "KeplerPropagator.h"
+#include "Propulsion.h"
+
+#include "Quaternion.h"
 #include "Vector3.h"
 
+#include <string>
 #include <vector>
 
 class Spacecraft;
@@ -16,14 +24,15 @@ struct TargetPlanet
 {
     TargetPlanet() {}
 
-    TargetPlanet(std::string _name, Vector3<double> _targetPosition, double _atmosphereRadius) :
-        name(_name), targetPosition(_targetPosition), atmosphereRadius(_atmosphereRadius) {}
+    TargetPlanet(std::string _name, Vector3<double> _targetPosition, double _atmosphereRadius, double _radius) :
+        name(_name), targetPosition(_targetPosition), atmosphereRadius(_atmosphereRadius), radius(_radius) {}
 
     ~TargetPlanet() {}
 
     std::string name;
     Vector3<double> targetPosition;
     double atmosphereRadius;
+    double radius;
 };
 
 
@@ -34,16 +43,59 @@ class ControlSystem // : public PositionController, public VelocityController, p
         ControlSystem(Spacecraft* spacecraft);
         virtual ~ControlSystem() {}
 
-        virtual void update(double elapsedTime) = 0;
+        // One full step: updateGNC, updateControllers and integrate. Not virtual so the whole
+        // chain can inline; Pipeline.h composes the stages at compile time.
+        void update(double elapsedTime);
+
+        // The stages of update(). The multi-rate scheduler runs each at its own period. They
+        // need Spacecraft, so they are defined inline at the end of Spacecraft.h, where the
+        // pipelines can inline them without whole-program optimization.
+        inline void updateControllers(double elapsedTime);
+        inline void integrate(double elapsedTime);
 
         void setThrust(const Vector3<double>& t) { _thrust = t; }
         Vector3<double> getThrust() const { return _thrust; }
 
+        // Propulsion. With an engine the controllers no longer set the velocity: updateControllers()
+        // turns the velocity they command into a throttle and thrust direction, and integrate()
+        // burns the engine and applies the thrust it gives, using fuel. Without one, nullptr, the
+        // commanded velocity is taken as it is. The engine must outlive the spacecraft.
+        void setEngine(const Engine* engine, double fuelMass) { _engine = engine; _fuelMass = fuelMass; _burnTime = 0.0; _throttle = 0.0; }
+        const Engine* getEngine() const { return _engine; }
+        double getFuelMass() const { return _fuelMass; }
+        double getBurnTime() const { return _burnTime; }
+        double getThrottle() const { return _throttle; }
+
+        // setPID applies the same gains to every controller in the chain
         void setPID(double kp, double ki, double kd);
+        void setPositionPID(double kp, double ki, double kd) { _positionController.setGains(kp, ki, kd); }
+        void setVelocityPID(double kp, double ki, double kd) { _velocityController.setGains(kp, ki, kd); }
+        void setAccelerationPID(double kp, double ki, double kd) { _accelerationController.setGains(kp, ki, kd); }
+
+        const PositionController& getPositionController() const { return _positionController; }
+        const VelocityController& getVelocityController() const { return _velocityController; }
+        const AccelerationController& getAccelerationController() const { return _accelerationController; }
+
+
+        inline void updateGNC();
+
+        // Event detection
+        void armEventGuards();
+        void handleEvent(const SimulationEvent& event);
+        EventDetector& getEventDetector() { return _eventDetector; }
 
-        void updatePID(double error);
+        // Set by a landing on the target planet. A landed spacecraft stays where it touched down:
+        // the controllers and integration stop, and runs end.
+        bool isLanded() const { return _landed; }
 
-        void updateGNC();
+        double getMissionTime() const { return _missionTime; }
+
+        // Batch runs turn off the per-spacecraft console messages
+        void setVerbose(bool verbose) { _verbose = verbose; }
+
+        // Checkpoint methods
+        virtual void saveState(BinaryWriter& writer) const;
+        virtual void loadState(BinaryReader& reader);
 
         void setTargetPlanet(Planet* planet);
         TargetPlanet getTargetPlanet() { return _targetPlanet; }
@@ -58,19 +110,60 @@ class ControlSystem // : public PositionController, public VelocityController, p
 
         void applyThrust(Vector3<double> thrust);
 
+        // Environment forces applied to the velocity in integrate(); none when forces is null
+        // The central body follows the spheres of influence of the context's system, see System::findDominantBody.
+        void setForces(ForceFunction forces, const ForceContext& context) { _forces = forces; _forceContext = context; }
+        Planet* getCentralBody() const { return _forceContext.planet; }
+
+        // Call after the planets move
+        void followPlanets();
+
+        // State in the frame of the central body
+        Vector3<double> getCentralPosition() const { return _position - _forceContext.planet->getCenterPosition(); }
+
+        // Coast mode. With forces set, no thrust, no new velocity from the controllers and nothing
+        // else changing the state, an arc whose forces beyond the central point mass stay below
+        // tolerance times the central pull (here, at periapsis and at apoapsis) and that stays
+        // outside the atmosphere radius is propagated analytically instead. 0 never coasts.
+        // A coast step still costs a Kepler solve plus the attitude and event work of every step,
+        // so it only pays when the force pipeline is dearer than that, as with the harmonics.
+        void setCoastTolerance(double tolerance) { _coastTolerance = tolerance; }
+        bool isCoasting() const { return _coasting; }
+
         void setPosition(const Vector3<double> &position) { _position = position; }
         void setVelocity(const Vector3<double> &velocity) { _velocity = velocity; }
         void setAcceleration(const Vector3<double> &acceleration) { _acceleration = acceleration; }
         void setOrientation(const Vector3<double>& o) { _orientation = o; }
 
-        virtual Vector3<double> getPosition() const { return _position; }
-        virtual Vector3<double> getVelocity() const { return _velocity; }
-        virtual Vector3<double> getAcceleration() const { return _acceleration; }
+        Vector3<double> getPosition() const { return _position; }
+        Vector3<double> getVelocity() const { return _velocity; }
+        Vector3<double> getAcceleration() const { return _acceleration; }
         Vector3<double> getOrientation() const { return _orientation; }
 
+        // Attitude. integrate() turns the boresight, the body x axis, towards the orientation set by
+        // guidance, slewing no faster than the spacecraft's angular velocity. A torque set here is
+        // added to the one the attitude controller commands; both are in the body frame.
+        void setInertia(const InertiaTensor& inertia) { _inertia = inertia; _inverseInertia = inertia.inverse(); }
+        const InertiaTensor& getInertia() const { return _inertia; }
+
+        void setAttitude(const Quaternion<double>& attitude) { _attitude = attitude.normalize(); }
+        void setBodyRate(const Vector3<double>& rate) { _bodyRate = rate; }
+        void setTorque(const Vector3<double>& torque) { _torque = torque; }
+
+        Quaternion<double> getAttitude() const { return _attitude; }
+        Vector3<double> getBodyRate() const { return _bodyRate; }
+        Vector3<double> getTorque() const { return _torque; }
+        Vector3<double> getBoresight() const { return _attitude.rotate(Vector3<double>(1, 0, 0)); }
+
     protected:
         Spacecraft* _spacecraft;
         Vector3<double> _thrust;
+
+        const Engine* _engine;
+        double _fuelMass;
+        double _burnTime;                   // s the engine has fired
+        double _throttle;
+        Vector3<double> _thrustDirection;
         TargetPlanet _targetPlanet;
         Vector3<double> _targetVelocity;
         Vector3<double> _targetAcceleration;
@@ -87,9 +180,45 @@ class ControlSystem // : public PositionController, public VelocityController, p
         Vector3<double> _acceleration;
         Vector3<double> _orientation;
 
+        // Torque towards the commanded orientation, in the body frame
+        Vector3<double> getControlTorque() const;
+
+        Quaternion<double> _attitude;
+        Vector3<double> _bodyRate;
+        Vector3<double> _torque;
+        InertiaTensor _inertia;
+        InertiaTensor _inverseInertia;
+
         PositionController _positionController;
         VelocityController _velocityController;
         AccelerationController _accelerationController;
+
+        ForceFunction _forces;
+        ForceContext _forceContext;
+
+        // The end of integrate(): events crossed during the step and the sphere of influence
+        void handleStepEvents(const Vector3<double>& previousPosition, double elapsedTime);
+
+        // Both false to integrate numerically
+        bool coast(double elapsedTime);
+        bool startCoast();
+        bool isBallistic(const Vector3<double>& position) const;
+
+        // Steps between coast attempts after a failed one, and between perturbation checks while coasting
+        static const int COAST_CHECK_STEPS = 64;
+
+        KeplerPropagator _coast;
+        double _coastTolerance;
+        bool _coasting;
+        double _coastTime;                  // since the coast started
+        Vector3<double> _coastPosition;     // state the coast left, to notice anything else changing it
+        Vector3<double> _coastVelocity;
+        int _coastCountdown;                // steps to the next coast attempt or, coasting, to the next perturbation check
+
+        EventDetector _eventDetector;
+        double _missionTime;
+        bool _landed;
+        bool _verbose;
 };
 
 #endif // CONTROLSYSTEM_H
\ No newline at end of file
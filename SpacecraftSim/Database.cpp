@@ -1,6 +1,10 @@
 #include "Database.h"
 
+#include "EventDetector.h"
+#include "PIDTuner.h"
+#include "ProximityDetector.h"
 #include "Planet.h"
+#include "Statistics.h"
 #include "Vector3.h"
 
 #include <iostream>
@@ -9,6 +13,16 @@ const char* input_planet = "INSERT INTO InputPlanets(systemName, planetName, cen
 const char* input_systems = "INSERT INTO InputSystems(systemName) VALUES(?)";
 const char* input_spacecraft = "INSERT INTO InputSpacecraft(name, area, mass, angularVelocity, maxVelocity, targetVelocityX, targetVelocityY, targetVelocitZ, targetAccelerationX, targetAccelerationY, targetAccelerationZ) VALUES(?,?,?,?,?,?,?,?,?,?,?)";
 
+const char* simulation_events = "INSERT INTO simulation_events(time, spacecraftName, eventType, planetName, position_x, position_y, position_z) VALUES(?,?,?,?,?,?,?)";
+
+const char* proximity_events = "INSERT INTO proximity_events(time, spacecraftA, spacecraftB, eventType, distance, position_x, position_y, position_z) VALUES(?,?,?,?,?,?,?,?)";
+
+const char* run_metadata = "INSERT INTO run_metadata(key, value) VALUES(?,?)";
+
+const char* monte_carlo_summary = "INSERT INTO monte_carlo_summary(outcome, count, mean, stddev, min, max, p01, p05, p50, p95, p99) VALUES(?,?,?,?,?,?,?,?,?,?,?)";
+
+const char* pid_tuning = "INSERT INTO pid_tuning(rank, positionKp, positionKi, positionKd, velocityKp, velocityKi, velocityKd, reached, diverged, timeToTarget, overshoot, controlEffort, cost) VALUES(?,?,?,?,?,?,?,?,?,?,?,?,?)";
+
 const char* simulation_data = "INSERT INTO simulation_data(time, position_x, position_y, position_z, velocity_x, velocity_y, velocity_z, acceleration_x, acceleration_y, acceleration_z) VALUES(?,?,?,?,?,?,?,?,?,?)";
 
 Database::Database(const std::string & filename) : _filename(filename)
@@ -20,8 +34,6 @@ Database::Database(const std::string & filename) : _filename(filename)
         std::cerr << "Can't open database: " << sqlite3_errmsg(_database) << std::endl;
         sqlite3_close(_database);
     }
-
-    dropTables();
 }
 
 Database::~Database()
@@ -54,12 +66,22 @@ void Database::dropTables()
     std::string input_systems = "DROP TABLE IF EXISTS InputSystems;";
     std::string input_spacecraft = "DROP TABLE IF EXISTS InputSpacecraft;";
     std::string simulation_data = "DROP TABLE IF EXISTS simulation_data;";
+    std::string simulation_events = "DROP TABLE IF EXISTS simulation_events;";
+    std::string proximity_events = "DROP TABLE IF EXISTS proximity_events;";
+    std::string run_metadata = "DROP TABLE IF EXISTS run_metadata;";
+    std::string monte_carlo_summary = "DROP TABLE IF EXISTS monte_carlo_summary;";
+    std::string pid_tuning = "DROP TABLE IF EXISTS pid_tuning;";
     std::string errorString = "Error dropping table: ";
 
     runSQL(input_planets, errorString);
     runSQL(input_systems, errorString);
     runSQL(input_spacecraft, errorString);
     runSQL(simulation_data, errorString);
+    runSQL(simulation_events, errorString);
+    runSQL(proximity_events, errorString);
+    runSQL(run_metadata, errorString);
+    runSQL(monte_carlo_summary, errorString);
+    runSQL(pid_tuning, errorString);
 }
 
 void Database::createTables()
@@ -116,12 +138,92 @@ void Database::createTables()
         "PRIMARY KEY (time)"
         ");";
 
+    std::string simulation_events =
+        "CREATE TABLE IF NOT EXISTS simulation_events("
+        "time REAL NOT NULL,"
+        "spacecraftName TEXT NOT NULL,"
+        "eventType TEXT NOT NULL,"
+        "planetName TEXT NOT NULL,"
+        "position_x REAL NOT NULL,"
+        "position_y REAL NOT NULL,"
+        "position_z REAL NOT NULL"
+        ");";
+
+    std::string proximity_events =
+        "CREATE TABLE IF NOT EXISTS proximity_events("
+        "time REAL NOT NULL,"
+        "spacecraftA TEXT NOT NULL,"
+        "spacecraftB TEXT NOT NULL,"
+        "eventType TEXT NOT NULL,"
+        "distance REAL NOT NULL,"
+        "position_x REAL NOT NULL,"
+        "position_y REAL NOT NULL,"
+        "position_z REAL NOT NULL"
+        ");";
+
+    std::string run_metadata =
+        "CREATE TABLE IF NOT EXISTS run_metadata("
+        "key TEXT NOT NULL,"
+        "value TEXT NOT NULL,"
+        "PRIMARY KEY (key)"
+        ");";
+
+    std::string monte_carlo_summary =
+        "CREATE TABLE IF NOT EXISTS monte_carlo_summary("
+        "outcome TEXT NOT NULL,"
+        "count INT NOT NULL,"
+        "mean REAL NOT NULL,"
+        "stddev REAL NOT NULL,"
+        "min REAL NOT NULL,"
+        "max REAL NOT NULL,"
+        "p01 REAL NOT NULL,"
+        "p05 REAL NOT NULL,"
+        "p50 REAL NOT NULL,"
+        "p95 REAL NOT NULL,"
+        "p99 REAL NOT NULL,"
+        "PRIMARY KEY (outcome)"
+        ");";
+
+    std::string pid_tuning =
+        "CREATE TABLE IF NOT EXISTS pid_tuning("
+        "rank INT NOT NULL,"
+        "positionKp REAL NOT NULL,"
+        "positionKi REAL NOT NULL,"
+        "positionKd REAL NOT NULL,"
+        "velocityKp REAL NOT NULL,"
+        "velocityKi REAL NOT NULL,"
+        "velocityKd REAL NOT NULL,"
+        "reached INT NOT NULL,"
+        "diverged INT NOT NULL,"
+        "timeToTarget REAL NOT NULL,"
+        "overshoot REAL NOT NULL,"
+        "controlEffort REAL NOT NULL,"
+        "cost REAL NOT NULL,"
+        "PRIMARY KEY (rank)"
+        ");";
+
     std::string errorString = "Error creating table: ";
 
     runSQL(input_planets, errorString);
     runSQL(input_systems, errorString);
     runSQL(input_spacecraft, errorString);
     runSQL(simulation_data, errorString);
+    runSQL(simulation_events, errorString);
+    runSQL(proximity_events, errorString);
+    runSQL(run_metadata, errorString);
+    runSQL(monte_carlo_summary, errorString);
+    runSQL(pid_tuning, errorString);
+}
+
+// Removes rows logged after a checkpoint so a restored run can log them again
+void Database::deleteSimDataAfter(int step, double time)
+{
+    std::string simulation_data = "DELETE FROM simulation_data WHERE time >= " + std::to_string(step) + ";";
+    std::string simulation_events = "DELETE FROM simulation_events WHERE time > " + std::to_string(time) + ";";
+    std::string errorString = "Error deleting from table: ";
+
+    runSQL(simulation_data, errorString);
+    runSQL(simulation_events, errorString);
 }
 
 void Database::logSimData(double time, Vector3<double> position, Vector3<double> velocity, Vector3<double> acceleration)
@@ -207,3 +309,215 @@ void Database::logPlanetData(Planet* planet)
     }
 
 }
+
+
+void Database::logEvent(const SimulationEvent& event)
+{
+    std::string errorString = "Error inserting into table: ";
+
+    sqlite3_stmt *stmt;
+    int result = sqlite3_prepare_v2(_database, simulation_events, -1, &stmt, NULL);
+
+    if (result != SQLITE_OK)
+    {
+        std::cerr << errorString << sqlite3_errmsg(_database) << std::endl;
+        sqlite3_close(_database);
+    }
+
+    bindValue(stmt, 1, event.time);
+    bindValue(stmt, 2, event.spacecraftName);
+    bindValue(stmt, 3, eventTypeToString(event.type));
+    bindValue(stmt, 4, event.planetName);
+    bindValue(stmt, 5, event.position.x);
+    bindValue(stmt, 6, event.position.y);
+    bindValue(stmt, 7, event.position.z);
+
+    // Execute the statement
+    result = sqlite3_step(stmt);
+    if (result != SQLITE_DONE)
+    {
+        std::cerr << "Can't insert data: " << sqlite3_errmsg(_database) << std::endl;
+        sqlite3_close(_database);
+    }
+
+    // Finalize the statement
+    result = sqlite3_finalize(stmt);
+    if (result != SQLITE_OK)
+    {
+        std::cerr << "Can't finalize statement: " << sqlite3_errmsg(_database) << std::endl;
+        sqlite3_close(_database);
+    }
+}
+
+
+void Database::logProximityEvent(const ProximityEvent& event, const std::string& nameA, const std::string& nameB)
+{
+    std::string errorString = "Error inserting into table: ";
+
+    sqlite3_stmt *stmt;
+    int result = sqlite3_prepare_v2(_database, proximity_events, -1, &stmt, NULL);
+
+    if (result != SQLITE_OK)
+    {
+        std::cerr << errorString << sqlite3_errmsg(_database) << std::endl;
+        sqlite3_close(_database);
+    }
+
+    bindValue(stmt, 1, event.time);
+    bindValue(stmt, 2, nameA);
+    bindValue(stmt, 3, nameB);
+    bindValue(stmt, 4, proximityEventTypeToString(event.type));
+    bindValue(stmt, 5, event.distance);
+    bindValue(stmt, 6, event.position.x);
+    bindValue(stmt, 7, event.position.y);
+    bindValue(stmt, 8, event.position.z);
+
+    // Execute the statement
+    result = sqlite3_step(stmt);
+    if (result != SQLITE_DONE)
+    {
+        std::cerr << "Can't insert data: " << sqlite3_errmsg(_database) << std::endl;
+        sqlite3_close(_database);
+    }
+
+    // Finalize the statement
+    result = sqlite3_finalize(stmt);
+    if (result != SQLITE_OK)
+    {
+        std::cerr << "Can't finalize statement: " << sqlite3_errmsg(_database) << std::endl;
+        sqlite3_close(_database);
+    }
+}
+
+
+void Database::logRunMetadata(const std::string& key, const std::string& value)
+{
+    std::string errorString = "Error inserting into table: ";
+
+    sqlite3_stmt *stmt;
+    int result = sqlite3_prepare_v2(_database, run_metadata, -1, &stmt, NULL);
+
+    if (result != SQLITE_OK)
+    {
+        std::cerr << errorString << sqlite3_errmsg(_database) << std::endl;
+        sqlite3_close(_database);
+    }
+
+    bindValue(stmt, 1, key);
+    bindValue(stmt, 2, value);
+
+    // Execute the statement
+    result = sqlite3_step(stmt);
+    if (result != SQLITE_DONE)
+    {
+        std::cerr << "Can't insert data: " << sqlite3_errmsg(_database) << std::endl;
+        sqlite3_close(_database);
+    }
+
+    // Finalize the statement
+    result = sqlite3_finalize(stmt);
+    if (result != SQLITE_OK)
+    {
+        std::cerr << "Can't finalize statement: " << sqlite3_errmsg(_database) << std::endl;
+        sqlite3_close(_database);
+    }
+}
+
+
+void Database::logMonteCarloSummary(const std::string& outcome, const OutcomeStatistics& statistics)
+{
+    std::string errorString = "Error inserting into table: ";
+
+    // Outcomes that never happened (e.g. no sample landed) are not logged
+    if (statistics.getStatistics().getCount() == 0)
+    {
+        return;
+    }
+
+    sqlite3_stmt *stmt;
+    int result = sqlite3_prepare_v2(_database, monte_carlo_summary, -1, &stmt, NULL);
+
+    if (result != SQLITE_OK)
+    {
+        std::cerr << errorString << sqlite3_errmsg(_database) << std::endl;
+        sqlite3_close(_database);
+    }
+
+    const auto& moments = statistics.getStatistics();
+
+    bindValue(stmt, 1, outcome);
+    bindValue(stmt, 2, static_cast<int>(moments.getCount()));
+    bindValue(stmt, 3, moments.getMean());
+    bindValue(stmt, 4, moments.getStandardDeviation());
+    bindValue(stmt, 5, moments.getMin());
+    bindValue(stmt, 6, moments.getMax());
+    bindValue(stmt, 7, statistics.quantile(0.01));
+    bindValue(stmt, 8, statistics.quantile(0.05));
+    bindValue(stmt, 9, statistics.quantile(0.5));
+    bindValue(stmt, 10, statistics.quantile(0.95));
+    bindValue(stmt, 11, statistics.quantile(0.99));
+
+    // Execute the statement
+    result = sqlite3_step(stmt);
+    if (result != SQLITE_DONE)
+    {
+        std::cerr << "Can't insert data: " << sqlite3_errmsg(_database) << std::endl;
+        sqlite3_close(_database);
+    }
+
+    // Finalize the statement
+    result = sqlite3_finalize(stmt);
+    if (result != SQLITE_OK)
+    {
+        std::cerr << "Can't finalize statement: " << sqlite3_errmsg(_database) << std::endl;
+        sqlite3_close(_database);
+    }
+}
+
+
+void Database::logTuningResult(int rank, const TuningResult& tuningResult)
+{
+    std::string errorString = "Error inserting into table: ";
+
+    sqlite3_stmt *stmt;
+    int result = sqlite3_prepare_v2(_database, pid_tuning, -1, &stmt, NULL);
+
+    if (result != SQLITE_OK)
+    {
+        std::cerr << errorString << sqlite3_errmsg(_database) << std::endl;
+        sqlite3_close(_database);
+    }
+
+    const auto& candidate = tuningResult.candidate;
+    const auto& score = tuningResult.score;
+
+    bindValue(stmt, 1, rank);
+    bindValue(stmt, 2, candidate.position.kp);
+    bindValue(stmt, 3, candidate.position.ki);
+    bindValue(stmt, 4, candidate.position.kd);
+    bindValue(stmt, 5, candidate.velocity.kp);
+    bindValue(stmt, 6, candidate.velocity.ki);
+    bindValue(stmt, 7, candidate.velocity.kd);
+    bindValue(stmt, 8, score.reached ? 1 : 0);
+    bindValue(stmt, 9, score.diverged ? 1 : 0);
+    bindValue(stmt, 10, score.timeToTarget);
+    bindValue(stmt, 11, score.overshoot);
+    bindValue(stmt, 12, score.controlEffort);
+    bindValue(stmt, 13, score.cost);
+
+    // Execute the statement
+    result = sqlite3_step(stmt);
+    if (result != SQLITE_DONE)
+    {
+        std::cerr << "Can't insert data: " << sqlite3_errmsg(_database) << std::endl;
+        sqlite3_close(_database);
+    }
+
+    // Finalize the statement
+    result = sqlite3_finalize(stmt);
+    if (result != SQLITE_OK)
+    {
+        std::cerr << "Can't finalize statement: " << sqlite3_errmsg(_database) << std::endl;
+        sqlite3_close(_database);
+    }
+}
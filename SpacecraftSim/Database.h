@@ -5,7 +5,11 @@
 #include <string>
 #include <vector>
 
+class OutcomeStatistics;
 class Planet;
+struct ProximityEvent;
+struct SimulationEvent;
+struct TuningResult;
 
 class Database
 {
@@ -20,6 +24,12 @@ class Database
         void createTables();
         void logSimData(double time, Vector3<double> position, Vector3<double> velocity, Vector3<double> acceleration);
         void logPlanetData(Planet* planet);
+        void logEvent(const SimulationEvent& event);
+        void logProximityEvent(const ProximityEvent& event, const std::string& nameA, const std::string& nameB);
+        void logRunMetadata(const std::string& key, const std::string& value);
+        void logMonteCarloSummary(const std::string& outcome, const OutcomeStatistics& statistics);
+        void logTuningResult(int rank, const TuningResult& result);
+        void deleteSimDataAfter(int step, double time);
 
         template <typename T>
         int bindValue(sqlite3_stmt* stmt, int index, const T& value) 
@@ -0,0 +1,359 @@
+#include "Ephemeris.h"
+
+#include "Checkpoint.h"
+#include "KeplerPropagator.h"
+#include "Planet.h"
+#include "System.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Identifies an ephemeris file. Bump the version whenever the layout or the fit changes.
+static const char EPHEMERIS_MAGIC[8] = { 'S', 'C', 'S', 'I', 'M', 'E', 'P', 'H' };
+static const uint32_t EPHEMERIS_VERSION = 2;
+
+// Position x, y, z and velocity x, y, z: the series of each term of a segment
+static const uint32_t SERIES = 6;
+
+static const double PI = 3.14159265358979323846;
+
+// FNV-1a over raw bytes
+static void hashBytes(uint64_t& hash, const void* data, size_t size)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+}
+
+Ephemeris::Ephemeris() : _data(nullptr), _size(0), _header(nullptr), _bodies(nullptr), _coefficients(nullptr)
+{
+}
+
+uint64_t Ephemeris::fingerprint(const std::map<std::string, System*>& systems, double span)
+{
+    uint64_t hash = 14695981039346656037ull;
+    hashBytes(hash, &span, sizeof(span));
+
+    for (const auto& kv : systems)
+    {
+        for (const auto& pkv : kv.second->getPlanets())
+        {
+            auto planet = pkv.second;
+            auto center = planet->getCenterPosition();
+            double values[] = { planet->getMass(), planet->getGravititationParameter(), center.x, center.y, center.z };
+            bool primary = planet == kv.second->getPrimary();
+
+            hashBytes(hash, pkv.first.data(), pkv.first.size());
+            hashBytes(hash, values, sizeof(values));
+            hashBytes(hash, &primary, sizeof(primary));
+        }
+    }
+
+    return hash;
+}
+
+void Ephemeris::generate(const std::map<std::string, System*>& systems, double span, const std::string& path)
+{
+    if (!(span > 0))
+    {
+        throw std::runtime_error("Error: Ephemeris span must be positive.");
+    }
+
+    const uint32_t nodes = DEGREE + 1;
+    std::vector<EphemerisBody> bodies;
+    std::vector<double> coefficients;
+
+    for (const auto& kv : systems)
+    {
+        auto primary = kv.second->getPrimary();
+
+        for (const auto& pkv : kv.second->getPlanets())
+        {
+            auto planet = pkv.second;
+            auto center = planet->getCenterPosition();
+
+            if (pkv.first.size() >= sizeof(EphemerisBody::name))
+            {
+                throw std::runtime_error("Error: Planet name " + pkv.first + " is too long for the ephemeris.");
+            }
+
+            EphemerisBody body;
+            std::memset(&body, 0, sizeof(body));
+            std::memcpy(body.name, pkv.first.data(), pkv.first.size());
+            body.start = 0.0;
+            body.degree = DEGREE;
+            body.offset = coefficients.size();
+
+            // A circular orbit about the primary, in the plane through the primary's z axis where
+            // there is one
+            KeplerPropagator orbit;
+            Vector3<double> origin, position = center;
+            bool moving = false;
+
+            if (primary && planet != primary)
+            {
+                origin = primary->getCenterPosition();
+                position = center - origin;
+
+                const double mu = primary->getGravititationParameter();
+                auto normal = std::fabs(position.normalize().z) < 0.999 ? Vector3<double>(0, 0, 1) : Vector3<double>(1, 0, 0);
+                auto velocity = normal.cross(position).normalize() * std::sqrt(mu / position.magnitude());
+
+                moving = orbit.initialize(position, velocity, mu);
+            }
+
+            if (!moving)
+            {
+                body.segmentLength = span;
+                body.inverseLength = 1.0 / span;
+                body.segmentCount = 1;
+
+                double constant[SERIES] = { center.x, center.y, center.z, 0.0, 0.0, 0.0 };
+                coefficients.insert(coefficients.end(), constant, constant + SERIES);
+                coefficients.insert(coefficients.end(), SERIES * DEGREE, 0.0);
+
+                bodies.push_back(body);
+                continue;
+            }
+
+            // Whole segments, none longer than 1 / SEGMENTS_PER_ORBIT of the period
+            double period = orbit.getElements().getPeriod();
+            body.segmentCount = static_cast<uint32_t>(std::max(1.0, std::ceil(span * SEGMENTS_PER_ORBIT / period)));
+            body.segmentLength = span / body.segmentCount;
+            body.inverseLength = 1.0 / body.segmentLength;
+
+            std::vector<Vector3<double>> samples(nodes);
+            std::vector<double> series(SERIES * (nodes + 1));
+
+            for (uint32_t s = 0; s < body.segmentCount; s++)
+            {
+                for (uint32_t k = 0; k < nodes; k++)
+                {
+                    double node = std::cos(PI * (k + 0.5) / nodes);
+                    Vector3<double> p, v;
+
+                    orbit.getState((s + 0.5 * (node + 1.0)) * body.segmentLength, p, v);
+                    samples[k] = origin + p;
+                }
+
+                // Coefficients by the discrete orthogonality of the Chebyshev polynomials at their nodes
+                std::fill(series.begin(), series.end(), 0.0);
+
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    for (uint32_t j = 0; j < nodes; j++)
+                    {
+                        double sum = 0.0;
+                        for (uint32_t k = 0; k < nodes; k++)
+                        {
+                            const auto& sample = samples[k];
+                            sum += (axis == 0 ? sample.x : (axis == 1 ? sample.y : sample.z)) * std::cos(PI * j * (k + 0.5) / nodes);
+                        }
+
+                        series[SERIES * j + axis] = sum * (j == 0 ? 1.0 : 2.0) / nodes;
+                    }
+
+                    // The derivative series, from d(j-1) = d(j+1) + 2j c(j) down from the top term,
+                    // then scaled from the segment's [-1, 1] to seconds
+                    double* d = &series[axis + 3];
+                    for (uint32_t j = DEGREE; j > 0; j--)
+                    {
+                        d[SERIES * (j - 1)] = d[SERIES * (j + 1)] + 2.0 * j * series[SERIES * j + axis];
+                    }
+                    d[0] *= 0.5;
+
+                    for (uint32_t j = 0; j < nodes; j++)
+                    {
+                        d[SERIES * j] *= 2.0 * body.inverseLength;
+                    }
+                }
+
+                coefficients.insert(coefficients.end(), series.begin(), series.begin() + SERIES * nodes);
+            }
+
+            bodies.push_back(body);
+        }
+    }
+
+    EphemerisHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, EPHEMERIS_MAGIC, sizeof(EPHEMERIS_MAGIC));
+    header.version = EPHEMERIS_VERSION;
+    header.bodyCount = static_cast<uint32_t>(bodies.size());
+    header.fingerprint = fingerprint(systems, span);
+    header.span = span;
+
+    BinaryWriter writer;
+    writer.write(header);
+    for (const auto& body : bodies)
+    {
+        writer.write(body);
+    }
+
+    auto& buffer = writer.getBuffer();
+    const char* bytes = reinterpret_cast<const char*>(coefficients.data());
+    buffer.insert(buffer.end(), bytes, bytes + coefficients.size() * sizeof(double));
+
+    if (!writeCheckpointFile(buffer, path))
+    {
+        throw std::runtime_error("Error: Could not write ephemeris " + path);
+    }
+}
+
+bool Ephemeris::open(const std::string& path)
+{
+    if (!std::ifstream(path).good())
+    {
+        return false;
+    }
+
+    close();
+
+#ifdef _WIN32
+    _buffer = readCheckpointFile(path);
+    _data = _buffer.data();
+    _size = _buffer.size();
+#else
+    int file = ::open(path.c_str(), O_RDONLY);
+    struct stat status;
+
+    if (file < 0 || fstat(file, &status) != 0)
+    {
+        if (file >= 0)
+        {
+            ::close(file);
+        }
+        throw std::runtime_error("Error: Could not open ephemeris " + path);
+    }
+
+    _size = static_cast<size_t>(status.st_size);
+    void* mapping = _size > 0 ? mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED;
+    ::close(file);
+
+    if (mapping == MAP_FAILED)
+    {
+        _size = 0;
+        throw std::runtime_error("Error: Could not map ephemeris " + path);
+    }
+
+    _data = static_cast<const char*>(mapping);
+#endif
+
+    auto header = reinterpret_cast<const EphemerisHeader*>(_data);
+
+    if (_size < sizeof(EphemerisHeader) || std::memcmp(header->magic, EPHEMERIS_MAGIC, sizeof(EPHEMERIS_MAGIC)) != 0)
+    {
+        close();
+        throw std::runtime_error("Error: File is not an ephemeris: " + path);
+    }
+
+    // A cache from another version of the format is as good as none; the caller fits a new one
+    if (header->version != EPHEMERIS_VERSION)
+    {
+        close();
+        return false;
+    }
+
+    // Every body's segments must lie inside the file
+    size_t coefficientStart = sizeof(EphemerisHeader) + header->bodyCount * sizeof(EphemerisBody);
+    bool complete = _size >= coefficientStart;
+
+    for (uint32_t i = 0; complete && i < header->bodyCount; i++)
+    {
+        auto body = reinterpret_cast<const EphemerisBody*>(_data + sizeof(EphemerisHeader)) + i;
+        size_t end = body->offset + static_cast<size_t>(body->segmentCount) * SERIES * (body->degree + 1);
+
+        complete = body->segmentCount > 0 && coefficientStart + end * sizeof(double) <= _size;
+    }
+
+    if (!complete)
+    {
+        close();
+        throw std::runtime_error("Error: Ephemeris " + path + " is truncated.");
+    }
+
+    _header = header;
+    _bodies = reinterpret_cast<const EphemerisBody*>(_data + sizeof(EphemerisHeader));
+    _coefficients = reinterpret_cast<const double*>(_data + coefficientStart);
+    return true;
+}
+
+void Ephemeris::close()
+{
+#ifndef _WIN32
+    if (_data && _buffer.empty())
+    {
+        munmap(const_cast<char*>(_data), _size);
+    }
+#endif
+
+    _buffer.clear();
+    _data = nullptr;
+    _size = 0;
+    _header = nullptr;
+    _bodies = nullptr;
+    _coefficients = nullptr;
+}
+
+int Ephemeris::findBody(const std::string& name) const
+{
+    for (uint32_t i = 0; _header && i < _header->bodyCount; i++)
+    {
+        if (name == _bodies[i].name)
+        {
+            return static_cast<int>(i);
+        }
+    }
+
+    return -1;
+}
+
+void Ephemeris::getState(int index, double time, Vector3<double>& position, Vector3<double>& velocity) const
+{
+    const EphemerisBody& body = _bodies[index];
+    const double local = time - body.start;
+    const double length = body.segmentLength;
+
+    if (!(local >= 0) || local > length * body.segmentCount * (1.0 + 1e-12))
+    {
+        throw std::runtime_error("Error: Time " + std::to_string(time) + " is outside the ephemeris of " + body.name);
+    }
+
+    // Segment and its time scaled to [-1, 1]
+    const double u = local * body.inverseLength;
+    const uint32_t segment = std::min(static_cast<uint32_t>(u), body.segmentCount - 1);
+    const double x = 2.0 * (u - segment) - 1.0;
+    const double* c = _coefficients + body.offset + static_cast<size_t>(segment) * SERIES * (body.degree + 1);
+
+    // Clenshaw: b(k) = c(k) + 2x b(k+1) - b(k+2) down to k = 1, and the sum is c(0) + x b(1) - b(2).
+    // The six series are independent, so their recurrences overlap; each step is grouped so that
+    // only one multiply and one add wait on the step before.
+    const double x2 = 2.0 * x;
+    Vector3<double> p1, p2, v1, v2;
+
+    for (uint32_t k = body.degree; k > 0; k--)
+    {
+        const double* term = c + SERIES * k;
+
+        Vector3<double> p = p1 * x2 + (Vector3<double>(term[0], term[1], term[2]) - p2);
+        Vector3<double> v = v1 * x2 + (Vector3<double>(term[3], term[4], term[5]) - v2);
+        p2 = p1; p1 = p;
+        v2 = v1; v1 = v;
+    }
+
+    position = Vector3<double>(c[0], c[1], c[2]) + p1 * x - p2;
+    velocity = Vector3<double>(c[3], c[4], c[5]) + v1 * x - v2;
+}
@@ -0,0 +1,89 @@
+#ifndef EPHEMERIS_H
+#define EPHEMERIS_H
+
+#include "Vector3.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+class System;
+
+// Layout of an ephemeris file: a header, one record per body, then every body's coefficients.
+// Plain structs so they are read in place from the mapped file.
+struct EphemerisHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t bodyCount;
+    uint64_t fingerprint;       // of the planets and span the file was generated from
+    double span;                // seconds of mission time from 0
+};
+
+struct EphemerisBody
+{
+    char name[32];
+    double start;
+    double segmentLength;
+    double inverseLength;       // 1 / segmentLength, so finding a segment takes no division
+    uint32_t segmentCount;
+    uint32_t degree;
+    uint64_t offset;            // of the first segment, in doubles from the start of the coefficients
+};
+
+// Planet positions over time as piecewise Chebyshev polynomials. Each segment holds degree + 1
+// coefficients per axis for the position and as many for the velocity, the derivative series
+// already in seconds, interleaved term by term across the six series. A query finds its segment
+// with one multiply and runs one Clenshaw recurrence per axis for both.
+//
+// generate() propagates every planet once: the primary of each system holds still and the others
+// follow circular orbits about it, starting where Planets.csv puts them. The file is mapped rather
+// than read, so a cached ephemeris costs nothing to open however long its span.
+class Ephemeris
+{
+    public:
+        Ephemeris();
+        ~Ephemeris() { close(); }
+
+        Ephemeris(const Ephemeris&) = delete;
+        Ephemeris& operator=(const Ephemeris&) = delete;
+
+        // Identifies the planets of the systems, as they are now, and the span
+        static uint64_t fingerprint(const std::map<std::string, System*>& systems, double span);
+
+        // Fits the planets' orbits over [0, span] and writes the file
+        static void generate(const std::map<std::string, System*>& systems, double span, const std::string& path);
+
+        // False when there is no file at path or it is from another version of the format; throws
+        // if the file is not an ephemeris or is truncated
+        bool open(const std::string& path);
+        void close();
+        bool isOpen() const { return _header != nullptr; }
+
+        uint64_t getFingerprint() const { return _header->fingerprint; }
+        double getSpan() const { return _header->span; }
+
+        // Index of a body, -1 if the file does not have it
+        int findBody(const std::string& name) const;
+
+        // Position and velocity of a body at a time in [0, span]
+        void getState(int body, double time, Vector3<double>& position, Vector3<double>& velocity) const;
+
+    protected:
+        // Chebyshev nodes per segment less one, and segments per orbit. At a sixteenth of an orbit
+        // a segment of degree 8 is fitted to about 1e-14 of the radius, and a query is eight steps
+        // of the recurrence.
+        static const uint32_t DEGREE = 8;
+        static const uint32_t SEGMENTS_PER_ORBIT = 16;
+
+        const char* _data;
+        size_t _size;
+        std::vector<char> _buffer;      // the file contents where it cannot be mapped
+
+        const EphemerisHeader* _header;
+        const EphemerisBody* _bodies;
+        const double* _coefficients;
+};
+
+#endif // EPHEMERIS_H
@@ -0,0 +1,140 @@
+#include "EventDetector.h"
+
+#include <algorithm>
+#include <cmath>
+
+std::string eventTypeToString(EventType type)
+{
+    switch (type)
+    {
+    case EventType::AtmosphereExit:
+        return "AtmosphereExit";
+    case EventType::TargetApproach:
+        return "TargetApproach";
+    case EventType::SurfaceContact:
+        return "SurfaceContact";
+    case EventType::SphereOfInfluenceEntry:
+        return "SphereOfInfluenceEntry";
+    }
+
+    return "Unknown";
+}
+
+EventDetector::EventDetector() : _tolerance(1e-9)
+{
+}
+
+void EventDetector::registerCallback(EventType type, EventCallback callback)
+{
+    _typedCallbacks.push_back(std::make_pair(type, callback));
+}
+
+void EventDetector::registerCallback(EventCallback callback)
+{
+    _callbacks.push_back(callback);
+}
+
+std::vector<SimulationEvent> EventDetector::detect(const std::string& spacecraftName, double startTime, double dt,
+    const Vector3<double>& startPosition, const Vector3<double>& endPosition) const
+{
+    std::vector<SimulationEvent> events;
+
+    for (const auto& guard : _guards)
+    {
+        double g0 = guard.evaluate(startPosition);
+        double g1 = guard.evaluate(endPosition);
+
+        bool rising = g0 < 0 && g1 >= 0;
+        bool falling = g0 > 0 && g1 <= 0;
+
+        if ((guard.direction == EventDirection::Rising && !rising)
+            || (guard.direction == EventDirection::Falling && !falling)
+            || (guard.direction == EventDirection::Either && !rising && !falling))
+        {
+            continue;
+        }
+
+        double fraction = locateRoot(guard, startPosition, endPosition, g0, g1);
+        Vector3<double> position = startPosition + (endPosition - startPosition) * fraction;
+
+        events.push_back(SimulationEvent(guard.type, startTime + fraction * dt, spacecraftName, guard.planetName, position));
+    }
+
+    std::stable_sort(events.begin(), events.end(), [](const SimulationEvent& a, const SimulationEvent& b) { return a.time < b.time; });
+
+    return events;
+}
+
+void EventDetector::fire(const SimulationEvent& event) const
+{
+    for (const auto& kv : _typedCallbacks)
+    {
+        if (kv.first == event.type)
+        {
+            kv.second(event);
+        }
+    }
+
+    for (const auto& callback : _callbacks)
+    {
+        callback(event);
+    }
+}
+
+// Illinois variant of regula falsi over the step fraction [0, 1].
+// Positions are integrated with a constant velocity over a step, so the state between
+// the two end points is a linear interpolation of them.
+// The returned fraction always lies on the far side of the crossing, so the state at the
+// event already satisfies the new condition (e.g. Planet::isLanded is true at a contact).
+double EventDetector::locateRoot(const EventGuard& guard, const Vector3<double>& startPosition, const Vector3<double>& endPosition,
+    double g0, double g1) const
+{
+    double a = 0.0;
+    double b = 1.0;
+    double ga = g0;
+    double gb = g1;
+    int side = 0;
+
+    for (int i = 0; i < 100 && (b - a) > _tolerance; i++)
+    {
+        double c = (a * gb - b * ga) / (gb - ga);
+
+        // Fall back to bisection if the secant leaves the bracket
+        if (!(c > a && c < b))
+        {
+            c = 0.5 * (a + b);
+        }
+
+        double gc = guard.evaluate(startPosition + (endPosition - startPosition) * c);
+
+        if (gc == 0.0)
+        {
+            return c;
+        }
+
+        if ((gc < 0) == (gb < 0))
+        {
+            b = c;
+            gb = gc;
+
+            if (side == -1)
+            {
+                ga *= 0.5;
+            }
+            side = -1;
+        }
+        else
+        {
+            a = c;
+            ga = gc;
+
+            if (side == 1)
+            {
+                gb *= 0.5;
+            }
+            side = 1;
+        }
+    }
+
+    return b;
+}
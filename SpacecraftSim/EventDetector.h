@@ -0,0 +1,103 @@
+#ifndef EVENTDETECTOR_H
+#define EVENTDETECTOR_H
+
+#include "Vector3.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+enum class EventType
+{
+    AtmosphereExit,
+    TargetApproach,
+    SurfaceContact,
+    SphereOfInfluenceEntry      // the dominant body changed; planetName is the new one
+};
+
+// Which sign change of the guard function counts as the event
+enum class EventDirection
+{
+    Rising,     // guard goes from negative to positive (leaving a sphere)
+    Falling,    // guard goes from positive to negative (entering a sphere)
+    Either
+};
+
+std::string eventTypeToString(EventType type);
+
+struct SimulationEvent
+{
+    SimulationEvent() {}
+
+    SimulationEvent(EventType _type, double _time, std::string _spacecraftName, std::string _planetName, Vector3<double> _position) :
+        type(_type), time(_time), spacecraftName(_spacecraftName), planetName(_planetName), position(_position) {}
+
+    ~SimulationEvent() {}
+
+    EventType type;
+    double time;
+    std::string spacecraftName;
+    std::string planetName;
+    Vector3<double> position;
+};
+
+// A guard is a spherical boundary. Its value is the signed distance of a position from the
+// sphere's surface: g(p) = |p - center| - radius
+struct EventGuard
+{
+    EventGuard() {}
+
+    EventGuard(EventType _type, std::string _planetName, Vector3<double> _center, double _radius, EventDirection _direction) :
+        type(_type), planetName(_planetName), center(_center), radius(_radius), direction(_direction) {}
+
+    ~EventGuard() {}
+
+    double evaluate(const Vector3<double>& position) const { return (position - center).magnitude() - radius; }
+
+    EventType type;
+    std::string planetName;
+    Vector3<double> center;
+    double radius;
+    EventDirection direction;
+};
+
+
+class EventDetector
+{
+    public:
+        typedef std::function<void(const SimulationEvent&)> EventCallback;
+
+        EventDetector();
+        ~EventDetector() {}
+
+        void addGuard(const EventGuard& guard) { _guards.push_back(guard); }
+        void clearGuards() { _guards.clear(); }
+        const std::vector<EventGuard>& getGuards() const { return _guards; }
+
+        // Callbacks registered for a single event type, or for every event type
+        void registerCallback(EventType type, EventCallback callback);
+        void registerCallback(EventCallback callback);
+
+        // Brackets every guard over one step and root-finds the crossings.
+        // Returns the events in time order. Callbacks are not fired here.
+        std::vector<SimulationEvent> detect(const std::string& spacecraftName, double startTime, double dt,
+            const Vector3<double>& startPosition, const Vector3<double>& endPosition) const;
+
+        void fire(const SimulationEvent& event) const;
+
+        void setTolerance(double tolerance) { _tolerance = tolerance; }
+        double getTolerance() const { return _tolerance; }
+
+    protected:
+        double locateRoot(const EventGuard& guard, const Vector3<double>& startPosition, const Vector3<double>& endPosition,
+            double g0, double g1) const;
+
+        std::vector<EventGuard> _guards;
+        std::vector<std::pair<EventType, EventCallback>> _typedCallbacks;
+        std::vector<EventCallback> _callbacks;
+
+        // Root-finding tolerance as a fraction of the step
+        double _tolerance;
+};
+
+#endif // EVENTDETECTOR_H
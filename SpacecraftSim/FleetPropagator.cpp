@@ -0,0 +1,266 @@
+#include "FleetPropagator.h"
+
+#include "Planet.h"
+#include "System.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+// One step of every spacecraft in a store. Gravity is summed planet by planet over the whole
+// store so the inner loop runs over contiguous arrays and vectorizes; in float it handles twice
+// as many spacecraft per instruction as in double. flags[i] is set when spacecraft i is within
+// `radiusSquared` of any planet at the start of the step.
+template<typename T>
+static void propagate(FleetArrays<T>& fleet, size_t planetCount, const T* __restrict px, const T* __restrict py, const T* __restrict pz,
+    const T* __restrict mu, const T* __restrict radiusSquared, T dt, T* __restrict ax, T* __restrict ay, T* __restrict az, uint8_t* __restrict flags)
+{
+    const size_t count = fleet.size();
+
+    T* __restrict x = fleet.x.data();
+    T* __restrict y = fleet.y.data();
+    T* __restrict z = fleet.z.data();
+    T* __restrict vx = fleet.vx.data();
+    T* __restrict vy = fleet.vy.data();
+    T* __restrict vz = fleet.vz.data();
+
+    for (size_t i = 0; i < count; i++)
+    {
+        ax[i] = 0;
+        ay[i] = 0;
+        az[i] = 0;
+        flags[i] = 0;
+    }
+
+    for (size_t p = 0; p < planetCount; p++)
+    {
+        const T cx = px[p], cy = py[p], cz = pz[p];
+        const T m = mu[p];
+        const T limit = radiusSquared[p];
+
+        for (size_t i = 0; i < count; i++)
+        {
+            T dx = x[i] - cx;
+            T dy = y[i] - cy;
+            T dz = z[i] - cz;
+
+            T r2 = dx * dx + dy * dy + dz * dz;
+            T r = std::sqrt(r2);
+            T scale = r2 > 0 ? -m / (r2 * r) : T(0);
+
+            ax[i] += dx * scale;
+            ay[i] += dy * scale;
+            az[i] += dz * scale;
+            flags[i] |= static_cast<uint8_t>(r2 < limit);
+        }
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        vx[i] += ax[i] * dt;
+        vy[i] += ay[i] * dt;
+        vz[i] += az[i] * dt;
+
+        x[i] += vx[i] * dt;
+        y[i] += vy[i] * dt;
+        z[i] += vz[i] * dt;
+    }
+}
+
+
+FleetPropagator::FleetPropagator(System* system, const FleetSettings& settings) : _settings(settings), _time(0.0), _promotions(0), _demotions(0)
+{
+    if (system->getPlanets().empty())
+    {
+        throw std::runtime_error("Error: Fleet propagation needs a system with at least one planet. system = " + system->getName());
+    }
+
+    for (const auto& kv : system->getPlanets())
+    {
+        _origin += kv.second->getCenterPosition();
+    }
+    _origin = _origin / static_cast<double>(system->getPlanets().size());
+
+    for (const auto& kv : system->getPlanets())
+    {
+        auto planet = kv.second;
+        auto center = planet->getCenterPosition() - _origin;
+        double boundary = std::max(planet->getAtmosphereRadius(), planet->getRadius());
+
+        _planets.name.push_back(planet->getName());
+        _planets.x.push_back(center.x);
+        _planets.y.push_back(center.y);
+        _planets.z.push_back(center.z);
+        _planets.mu.push_back(planet->getGravititationParameter());
+        _planets.promotionRadiusSquared.push_back(pow(_settings.promotionFactor * boundary, 2));
+        _planets.demotionRadiusSquared.push_back(pow(_settings.demotionFactor * boundary, 2));
+
+        _planets.fx.push_back(static_cast<float>(center.x));
+        _planets.fy.push_back(static_cast<float>(center.y));
+        _planets.fz.push_back(static_cast<float>(center.z));
+        _planets.fmu.push_back(static_cast<float>(planet->getGravititationParameter()));
+        _planets.fpromotionRadiusSquared.push_back(static_cast<float>(_planets.promotionRadiusSquared.back()));
+
+        _eventDetector.addGuard(EventGuard(EventType::SurfaceContact, planet->getName(), planet->getCenterPosition(), planet->getRadius(), EventDirection::Falling));
+    }
+}
+
+uint32_t FleetPropagator::add(const Vector3<double>& position, const Vector3<double>& velocity)
+{
+    auto id = static_cast<uint32_t>(_location.size());
+    auto relative = position - _origin;
+
+    // Start in double when already near a planet
+    bool nearField = !_settings.mixedPrecision;
+    for (size_t p = 0; p < _planets.name.size() && !nearField; p++)
+    {
+        auto d = relative - Vector3<double>(_planets.x[p], _planets.y[p], _planets.z[p]);
+        nearField = d.magnitudeSquared() < _planets.promotionRadiusSquared[p];
+    }
+
+    if (nearField)
+    {
+        _location.push_back({ true, static_cast<uint32_t>(_near.size()) });
+        _near.push(id, relative, velocity);
+    }
+    else
+    {
+        _location.push_back({ false, static_cast<uint32_t>(_far.size()) });
+        _far.push(id, relative, velocity);
+    }
+
+    return id;
+}
+
+void FleetPropagator::promote(size_t index)
+{
+    uint32_t id = _far.id[index];
+
+    _location[id] = { true, static_cast<uint32_t>(_near.size()) };
+    _near.push(id, _far.position(index), _far.velocity(index));
+
+    uint32_t moved = _far.remove(index);
+    if (moved != id)
+    {
+        _location[moved].index = static_cast<uint32_t>(index);
+    }
+
+    _promotions++;
+}
+
+void FleetPropagator::demote(size_t index)
+{
+    uint32_t id = _near.id[index];
+
+    _location[id] = { false, static_cast<uint32_t>(_far.size()) };
+    _far.push(id, _near.position(index), _near.velocity(index));
+
+    uint32_t moved = _near.remove(index);
+    if (moved != id)
+    {
+        _location[moved].index = static_cast<uint32_t>(index);
+    }
+
+    _demotions++;
+}
+
+void FleetPropagator::step(double dt)
+{
+    const size_t planetCount = _planets.name.size();
+    const size_t farCount = _far.size();
+    const size_t nearCount = _near.size();
+
+    // Near field positions before the step bracket the event search
+    std::vector<Vector3<double> > previous(nearCount);
+    for (size_t i = 0; i < nearCount; i++)
+    {
+        previous[i] = _near.position(i) + _origin;
+    }
+
+    _floatScratch.resize(3 * farCount);
+    _doubleScratch.resize(3 * nearCount);
+    _farFlags.resize(farCount);
+    _nearFlags.resize(nearCount);
+
+    propagate<float>(_far, planetCount, _planets.fx.data(), _planets.fy.data(), _planets.fz.data(), _planets.fmu.data(), _planets.fpromotionRadiusSquared.data(),
+        static_cast<float>(dt), _floatScratch.data(), _floatScratch.data() + farCount, _floatScratch.data() + 2 * farCount, _farFlags.data());
+
+    propagate<double>(_near, planetCount, _planets.x.data(), _planets.y.data(), _planets.z.data(), _planets.mu.data(), _planets.demotionRadiusSquared.data(),
+        dt, _doubleScratch.data(), _doubleScratch.data() + nearCount, _doubleScratch.data() + 2 * nearCount, _nearFlags.data());
+
+    // Event detection in double for the spacecraft near a planet. Everything inside a promotion
+    // radius is in double, and the promotion radius is at least the atmosphere radius.
+    for (size_t i = 0; i < nearCount; i++)
+    {
+        if (!_nearFlags[i])
+        {
+            continue;
+        }
+
+        auto events = _eventDetector.detect("fleet " + std::to_string(_near.id[i]), _time, dt, previous[i], _near.position(i) + _origin);
+
+        for (const auto& event : events)
+        {
+            _eventDetector.fire(event);
+        }
+    }
+
+    // Change stores using where each spacecraft was at the start of the step. The promotion
+    // radius leaves a margin, so a spacecraft moving less than (promotionFactor - 1) atmosphere
+    // radii per step cannot reach an atmosphere before it is in double. Walking backwards keeps
+    // the indices still to visit valid while entries are swapped out.
+    if (_settings.mixedPrecision)
+    {
+        for (size_t i = nearCount; i-- > 0;)
+        {
+            if (!_nearFlags[i])
+            {
+                demote(i);
+            }
+        }
+    }
+
+    for (size_t i = farCount; i-- > 0;)
+    {
+        if (_farFlags[i])
+        {
+            promote(i);
+        }
+    }
+
+    _time += dt;
+}
+
+Vector3<double> FleetPropagator::getPosition(uint32_t id) const
+{
+    const auto& location = _location.at(id);
+    return (location.nearField ? _near.position(location.index) : _far.position(location.index)) + _origin;
+}
+
+Vector3<double> FleetPropagator::getVelocity(uint32_t id) const
+{
+    const auto& location = _location.at(id);
+    return location.nearField ? _near.velocity(location.index) : _far.velocity(location.index);
+}
+
+FleetAccuracy FleetPropagator::compare(const FleetPropagator& reference) const
+{
+    FleetAccuracy accuracy;
+    accuracy.promotions = _promotions;
+    accuracy.demotions = _demotions;
+
+    size_t count = std::min(size(), reference.size());
+
+    for (uint32_t id = 0; id < count; id++)
+    {
+        auto position = getPosition(id);
+        double error = (position - reference.getPosition(id)).magnitude();
+        double distance = std::max((position - _origin).magnitude(), 1.0);
+
+        accuracy.maxError = std::max(accuracy.maxError, error);
+        accuracy.maxRelativeError = std::max(accuracy.maxRelativeError, error / distance);
+        accuracy.meanError += error / count;
+    }
+
+    return accuracy;
+}
@@ -0,0 +1,162 @@
+#ifndef FLEETPROPAGATOR_H
+#define FLEETPROPAGATOR_H
+
+#include "EventDetector.h"
+#include "Vector3.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class System;
+
+// Positions and velocities of a fleet as structure of arrays, relative to the system origin
+template<typename T>
+struct FleetArrays
+{
+    size_t size() const { return x.size(); }
+
+    void push(uint32_t _id, const Vector3<double>& position, const Vector3<double>& velocity)
+    {
+        id.push_back(_id);
+        x.push_back(T(position.x));
+        y.push_back(T(position.y));
+        z.push_back(T(position.z));
+        vx.push_back(T(velocity.x));
+        vy.push_back(T(velocity.y));
+        vz.push_back(T(velocity.z));
+    }
+
+    // Swaps the last entry into index i. Returns the id that moved, or i's own id if it was last.
+    uint32_t remove(size_t i)
+    {
+        size_t last = size() - 1;
+
+        id[i] = id[last];
+        x[i] = x[last];
+        y[i] = y[last];
+        z[i] = z[last];
+        vx[i] = vx[last];
+        vy[i] = vy[last];
+        vz[i] = vz[last];
+
+        uint32_t moved = id[i];
+
+        id.pop_back();
+        x.pop_back();
+        y.pop_back();
+        z.pop_back();
+        vx.pop_back();
+        vy.pop_back();
+        vz.pop_back();
+
+        return moved;
+    }
+
+    Vector3<double> position(size_t i) const { return Vector3<double>(x[i], y[i], z[i]); }
+    Vector3<double> velocity(size_t i) const { return Vector3<double>(vx[i], vy[i], vz[i]); }
+
+    std::vector<uint32_t> id;
+    std::vector<T> x, y, z;
+    std::vector<T> vx, vy, vz;
+};
+
+struct FleetSettings
+{
+    FleetSettings() : mixedPrecision(true), promotionFactor(2.0), demotionFactor(2.5) {}
+    ~FleetSettings() {}
+
+    bool mixedPrecision;        // false keeps every spacecraft in double; the reference for accuracy checks
+    double promotionFactor;     // promote to double inside promotionFactor * atmosphere radius of any planet
+    double demotionFactor;      // demote back to float outside demotionFactor * atmosphere radius of every planet
+};
+
+struct FleetAccuracy
+{
+    FleetAccuracy() : maxError(0.0), meanError(0.0), maxRelativeError(0.0), promotions(0), demotions(0) {}
+    ~FleetAccuracy() {}
+
+    double maxError;            // metres from the all-double position
+    double meanError;
+    double maxRelativeError;    // error over distance from the system origin
+    uint64_t promotions;
+    uint64_t demotions;
+};
+
+
+// Propagates many ballistic spacecraft under the gravity of one system's planets.
+// Spacecraft far from every planet are stored and integrated in float relative to the system
+// origin (the mean of the planet centers), which halves the memory traffic and doubles the SIMD
+// width of the kernel. Spacecraft that come within the promotion radius of a planet move to the
+// double store, so everything near a planet, including event detection against the surface, runs
+// in double. The promotion radius is at least the atmosphere radius so no guard is crossed in float.
+class FleetPropagator
+{
+    public:
+        FleetPropagator(System* system, const FleetSettings& settings = FleetSettings());
+        ~FleetPropagator() {}
+
+        // Absolute position and velocity. Returns the id of the new spacecraft.
+        uint32_t add(const Vector3<double>& position, const Vector3<double>& velocity);
+
+        // Semi-implicit Euler step of every spacecraft, then promotion, demotion and event detection
+        void step(double dt);
+
+        Vector3<double> getPosition(uint32_t id) const;
+        Vector3<double> getVelocity(uint32_t id) const;
+
+        size_t size() const { return _location.size(); }
+        size_t getFloatCount() const { return _far.size(); }
+        size_t getDoubleCount() const { return _near.size(); }
+        uint64_t getPromotions() const { return _promotions; }
+        uint64_t getDemotions() const { return _demotions; }
+
+        const Vector3<double>& getOrigin() const { return _origin; }
+        double getTime() const { return _time; }
+
+        // Surface contact guards for every planet, checked for spacecraft in the double store
+        EventDetector& getEventDetector() { return _eventDetector; }
+
+        // Position error of this fleet against a reference fleet holding the same spacecraft
+        FleetAccuracy compare(const FleetPropagator& reference) const;
+
+    protected:
+        struct Location
+        {
+            bool nearField;
+            uint32_t index;
+        };
+
+        struct PlanetArrays
+        {
+            std::vector<std::string> name;
+            std::vector<double> x, y, z, mu;
+            std::vector<double> promotionRadiusSquared, demotionRadiusSquared;
+            std::vector<float> fx, fy, fz, fmu, fpromotionRadiusSquared;
+        };
+
+        void promote(size_t index);
+        void demote(size_t index);
+
+        FleetSettings _settings;
+        Vector3<double> _origin;
+        PlanetArrays _planets;
+
+        FleetArrays<float> _far;
+        FleetArrays<double> _near;
+        std::vector<Location> _location;
+
+        // Scratch for the kernels
+        std::vector<float> _floatScratch;
+        std::vector<double> _doubleScratch;
+        std::vector<uint8_t> _farFlags;
+        std::vector<uint8_t> _nearFlags;
+
+        EventDetector _eventDetector;
+        double _time;
+        uint64_t _promotions;
+        uint64_t _demotions;
+};
+
+#endif // FLEETPROPAGATOR_H
@@ -0,0 +1,127 @@
+#include "ForceModel.h"
+
+#include "Planet.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Spacecraft per block; the block's altitudes and densities stay in L1 between the passes
+static const size_t FORCE_BLOCK = 256;
+
+
+ForceModel::ForceModel(Planet* planet) : _planet(planet)
+{
+}
+
+void ForceModel::evaluate(ForceBatch& batch) const
+{
+    const size_t count = batch.size();
+
+    batch.ax.resize(count);
+    batch.ay.resize(count);
+    batch.az.resize(count);
+
+    const auto center = _planet->getCenterPosition();
+    const double cx = center.x, cy = center.y, cz = center.z;
+    const double mu = _planet->getGravititationParameter();
+    const double radius = _planet->getRadius();
+    const double dragParameter = _planet->getDragCoefficientParameter();
+    const auto& table = _planet->getAtmosphereTable();
+
+    const double* __restrict x = batch.x.data();
+    const double* __restrict y = batch.y.data();
+    const double* __restrict z = batch.z.data();
+    const double* __restrict vx = batch.vx.data();
+    const double* __restrict vy = batch.vy.data();
+    const double* __restrict vz = batch.vz.data();
+    const double* __restrict thrustX = batch.thrustX.data();
+    const double* __restrict thrustY = batch.thrustY.data();
+    const double* __restrict thrustZ = batch.thrustZ.data();
+    const double* __restrict area = batch.area.data();
+    const double* __restrict mass = batch.mass.data();
+    const double* __restrict maxVelocity = batch.maxVelocity.data();
+    double* __restrict ax = batch.ax.data();
+    double* __restrict ay = batch.ay.data();
+    double* __restrict az = batch.az.data();
+
+    double altitude[FORCE_BLOCK];
+    double density[FORCE_BLOCK];
+
+    for (size_t begin = 0; begin < count; begin += FORCE_BLOCK)
+    {
+        const size_t n = std::min(FORCE_BLOCK, count - begin);
+
+        for (size_t k = 0; k < n; k++)
+        {
+            size_t i = begin + k;
+            double rx = x[i] - cx, ry = y[i] - cy, rz = z[i] - cz;
+            altitude[k] = std::sqrt(rx * rx + ry * ry + rz * rz) - radius;
+        }
+
+        if (table.isBuilt())
+        {
+            table.getDensities(altitude, density, n);
+        }
+        else
+        {
+            for (size_t k = 0; k < n; k++)
+            {
+                density[k] = _planet->calcAirDensity(altitude[k]);
+            }
+        }
+
+        for (size_t k = 0; k < n; k++)
+        {
+            size_t i = begin + k;
+
+            // Gravity: -mu / r^2 along the radius
+            double rx = x[i] - cx, ry = y[i] - cy, rz = z[i] - cz;
+            double r2 = rx * rx + ry * ry + rz * rz;
+            double r = std::sqrt(r2);
+            double gravity = r > 0 ? -mu / (r2 * r) : 0.0;
+
+            // Drag: 0.5 * rho * v^2 * Cd * A with Cd = 0.5 * v^2 (calcDragCoefficient) and
+            // A = PI * area^2 (calcCrossSectionalArea), limited to the force at maxVelocity
+            double v2 = vx[i] * vx[i] + vy[i] * vy[i] + vz[i] * vz[i];
+            double v = std::sqrt(v2);
+            double cross = PI_SHORT * area[i] * area[i];
+            double drag = 0.5 * density[k] * v2 * (0.5 * v2) * cross;
+            double maxDrag = 0.5 * density[k] * dragParameter * cross * maxVelocity[i] * maxVelocity[i];
+            double inverseMass = 1.0 / mass[i];
+            double dragScale = v > 0 ? -std::min(drag, maxDrag) / v * inverseMass : 0.0;
+
+            ax[i] = rx * gravity + vx[i] * dragScale + thrustX[i] * inverseMass;
+            ay[i] = ry * gravity + vy[i] * dragScale + thrustY[i] * inverseMass;
+            az[i] = rz * gravity + vz[i] * dragScale + thrustZ[i] * inverseMass;
+        }
+    }
+}
+
+void ForceModel::evaluateScalar(ForceBatch& batch) const
+{
+    const size_t count = batch.size();
+
+    batch.ax.resize(count);
+    batch.ay.resize(count);
+    batch.az.resize(count);
+
+    const auto center = _planet->getCenterPosition();
+
+    for (size_t i = 0; i < count; i++)
+    {
+        Vector3<double> relative = Vector3<double>(batch.x[i], batch.y[i], batch.z[i]) - center;
+        Vector3<double> velocity(batch.vx[i], batch.vy[i], batch.vz[i]);
+        Vector3<double> thrust(batch.thrustX[i], batch.thrustY[i], batch.thrustZ[i]);
+
+        double altitude = relative.magnitude() - _planet->getRadius();
+        double maxDrag = _planet->getMaxDragForce(batch.area[i], batch.maxVelocity[i], altitude);
+
+        auto acceleration = _planet->getGravitationalAcceleration(relative)
+            + _planet->getLimitedAirResistance(velocity, altitude, batch.area[i], maxDrag) / batch.mass[i]
+            + thrust / batch.mass[i];
+
+        batch.ax[i] = acceleration.x;
+        batch.ay[i] = acceleration.y;
+        batch.az[i] = acceleration.z;
+    }
+}
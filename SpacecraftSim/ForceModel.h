@@ -0,0 +1,69 @@
+#ifndef FORCEMODEL_H
+#define FORCEMODEL_H
+
+#include "Vector3.h"
+
+#include <cstddef>
+#include <vector>
+
+class Planet;
+
+// State of the spacecraft near one planet as structure of arrays, and the accelerations the
+// force model writes back
+struct ForceBatch
+{
+    size_t size() const { return x.size(); }
+
+    void push(const Vector3<double>& position, const Vector3<double>& velocity, const Vector3<double>& thrust, double _area, double _mass, double _maxVelocity)
+    {
+        x.push_back(position.x);
+        y.push_back(position.y);
+        z.push_back(position.z);
+        vx.push_back(velocity.x);
+        vy.push_back(velocity.y);
+        vz.push_back(velocity.z);
+        thrustX.push_back(thrust.x);
+        thrustY.push_back(thrust.y);
+        thrustZ.push_back(thrust.z);
+        area.push_back(_area);
+        mass.push_back(_mass);
+        maxVelocity.push_back(_maxVelocity);
+    }
+
+    Vector3<double> acceleration(size_t i) const { return Vector3<double>(ax[i], ay[i], az[i]); }
+
+    std::vector<double> x, y, z;                    // absolute position
+    std::vector<double> vx, vy, vz;
+    std::vector<double> thrustX, thrustY, thrustZ;  // N
+    std::vector<double> area;                       // as Spacecraft::getArea
+    std::vector<double> mass;
+    std::vector<double> maxVelocity;                // sets the drag limit, see Planet::getMaxDragForce
+
+    std::vector<double> ax, ay, az;                 // written by ForceModel
+};
+
+
+// Gravity, drag and thrust of every spacecraft in a batch summed into one acceleration. The
+// physics are those of the Planet methods: getGravitationalAcceleration about the planet center,
+// getLimitedAirResistance limited to getMaxDragForce and divided by the spacecraft mass, and
+// thrust / mass. The batch is walked in blocks that stay in L1: a vectorized pass computes the
+// altitudes, the planet's atmosphere table turns them into densities, and a second vectorized
+// pass sums the accelerations.
+class ForceModel
+{
+    public:
+        ForceModel(Planet* planet);
+        ~ForceModel() {}
+
+        void evaluate(ForceBatch& batch) const;
+
+        // One spacecraft at a time through the Planet methods, for checking evaluate()
+        void evaluateScalar(ForceBatch& batch) const;
+
+        Planet* getPlanet() const { return _planet; }
+
+    protected:
+        Planet* _planet;
+};
+
+#endif // FORCEMODEL_H
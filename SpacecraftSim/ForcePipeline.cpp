@@ -0,0 +1,53 @@
+#include "ForcePipeline.h"
+
+#include <stdexcept>
+
+static const std::vector<ForcePipelineDefinition>& getForcePipelines()
+{
+    static const std::vector<ForcePipelineDefinition> pipelines = {
+        // Central body only
+        makeForcePipelineDefinition<ForcePipeline<PointMassGravity> >("point-mass"),
+
+        // Central body with its oblateness, J2 from Harmonics.csv
+        makeForcePipelineDefinition<ForcePipeline<PointMassGravity, J2Gravity> >("oblate"),
+
+        // Central body with the harmonics from Harmonics.csv
+        makeForcePipelineDefinition<ForcePipeline<PointMassGravity, HarmonicGravity> >("harmonic"),
+
+        // Gravity and the engines, no air
+        makeForcePipelineDefinition<ForcePipeline<PointMassGravity, ThrustAcceleration> >("powered"),
+
+        // Ascent and entry: gravity, limited drag and the engines
+        makeForcePipelineDefinition<ForcePipeline<PointMassGravity, LimitedDrag, ThrustAcceleration> >("atmospheric"),
+
+        // Every model; the harmonics include J2
+        makeForcePipelineDefinition<ForcePipeline<PointMassGravity, HarmonicGravity, LimitedDrag, SolarRadiationPressure, ThirdBodyGravity, ThrustAcceleration> >("full"),
+    };
+
+    return pipelines;
+}
+
+const ForcePipelineDefinition& findForcePipeline(const std::string& name)
+{
+    for (const auto& pipeline : getForcePipelines())
+    {
+        if (pipeline.name == name)
+        {
+            return pipeline;
+        }
+    }
+
+    throw std::runtime_error("Error: Unknown force pipeline " + name);
+}
+
+std::vector<std::string> getForcePipelineNames()
+{
+    std::vector<std::string> names;
+
+    for (const auto& pipeline : getForcePipelines())
+    {
+        names.push_back(pipeline.name);
+    }
+
+    return names;
+}
@@ -0,0 +1,197 @@
+#ifndef FORCEPIPELINE_H
+#define FORCEPIPELINE_H
+
+#include "Planet.h"
+#include "System.h"
+#include "Vector3.h"
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+// Where the forces act. Planets.csv has no sun data, so that is set here.
+struct ForceContext
+{
+    ForceContext() : planet(nullptr), system(nullptr), j2(0.0), sunDirection(1.0, 0.0, 0.0), radiationPressure(4.56e-6), reflectivity(1.3) {}
+    ForceContext(Planet* _planet, System* _system) : planet(nullptr), system(_system), j2(0.0), sunDirection(1.0, 0.0, 0.0), radiationPressure(4.56e-6), reflectivity(1.3) { setCentralBody(_planet); }
+    ~ForceContext() {}
+
+    // Takes gravity about body, with its J2
+    void setCentralBody(Planet* body) { planet = body; j2 = body ? body->getJ2() : 0.0; }
+
+    Planet* planet;                 // central body
+    System* system;                 // its system; every other planet in it is a third body
+    double j2;                      // oblateness of the central body about its z axis, from its GravityField
+    Vector3<double> sunDirection;   // unit vector towards the sun
+    double radiationPressure;       // N/m^2 at the spacecraft, 4.56e-6 at 1 AU
+    double reflectivity;            // Cr, 1 absorbs everything and 2 reflects everything
+};
+
+// The spacecraft the forces act on
+struct ForceState
+{
+    ForceState() : area(0.0), mass(1.0), maxVelocity(0.0) {}
+    ForceState(const Vector3<double>& _position, const Vector3<double>& _velocity, const Vector3<double>& _thrust, double _area, double _mass, double _maxVelocity)
+        : position(_position), velocity(_velocity), thrust(_thrust), area(_area), mass(_mass), maxVelocity(_maxVelocity) {}
+    ~ForceState() {}
+
+    Vector3<double> position;   // absolute
+    Vector3<double> velocity;
+    Vector3<double> thrust;     // N
+    double area;                // as Spacecraft::getArea
+    double mass;
+    double maxVelocity;         // sets the drag limit, see Planet::getMaxDragForce
+};
+
+
+// Force models. Each is a type with a static acceleration(context, state), so a pipeline built
+// from them is resolved at compile time and every model inlines into the sum.
+
+// -mu / r^2 towards the center of the central body
+struct PointMassGravity
+{
+    static Vector3<double> acceleration(const ForceContext& context, const ForceState& state)
+    {
+        return context.planet->getGravitationalAcceleration(state.position - context.planet->getCenterPosition());
+    }
+};
+
+// Second zonal harmonic of the central body, pole along z, in closed form. HarmonicGravity already
+// includes it, so a pipeline has one or the other.
+struct J2Gravity
+{
+    static Vector3<double> acceleration(const ForceContext& context, const ForceState& state)
+    {
+        auto r = state.position - context.planet->getCenterPosition();
+        double r2 = r.magnitudeSquared();
+
+        if (r2 == 0 || context.j2 == 0)
+        {
+            return Vector3<double>(0, 0, 0);
+        }
+
+        double R = context.planet->getRadius();
+        double k = -1.5 * context.j2 * context.planet->getGravititationParameter() * R * R / (r2 * r2 * std::sqrt(r2));
+        double z2 = 5 * r.z * r.z / r2;
+
+        return Vector3<double>(k * r.x * (1 - z2), k * r.y * (1 - z2), k * r.z * (3 - z2));
+    }
+};
+
+// Zonal and tesseral harmonics of the central body from its GravityField
+struct HarmonicGravity
+{
+    static Vector3<double> acceleration(const ForceContext& context, const ForceState& state)
+    {
+        return context.planet->getHarmonicAcceleration(state.position - context.planet->getCenterPosition());
+    }
+};
+
+// Air resistance limited to getMaxDragForce, over the spacecraft mass
+struct LimitedDrag
+{
+    static Vector3<double> acceleration(const ForceContext& context, const ForceState& state)
+    {
+        double altitude = (state.position - context.planet->getCenterPosition()).magnitude() - context.planet->getRadius();
+        double maxDrag = context.planet->getMaxDragForce(state.area, state.maxVelocity, altitude);
+
+        return context.planet->getLimitedAirResistance(state.velocity, altitude, state.area, maxDrag) / state.mass;
+    }
+};
+
+// Sunlight pushing the cross section away from the sun. No eclipse.
+struct SolarRadiationPressure
+{
+    static Vector3<double> acceleration(const ForceContext& context, const ForceState& state)
+    {
+        double cross = PI_SHORT * state.area * state.area;
+        return context.sunDirection * (-context.radiationPressure * context.reflectivity * cross / state.mass);
+    }
+};
+
+// Pull of the other planets of the system relative to the pull on the central body
+struct ThirdBodyGravity
+{
+    static Vector3<double> acceleration(const ForceContext& context, const ForceState& state)
+    {
+        Vector3<double> total(0, 0, 0);
+
+        if (!context.system)
+        {
+            return total;
+        }
+
+        auto center = context.planet->getCenterPosition();
+        auto r = state.position - center;
+
+        for (const auto& kv : context.system->getPlanets())
+        {
+            auto body = kv.second;
+            if (body == context.planet)
+            {
+                continue;
+            }
+
+            auto rb = body->getCenterPosition() - center;
+            auto d = rb - r;
+            double d2 = d.magnitudeSquared();
+            double rb2 = rb.magnitudeSquared();
+
+            if (d2 == 0 || rb2 == 0)
+            {
+                continue;
+            }
+
+            double mu = body->getGravititationParameter();
+            total += d * (mu / (d2 * std::sqrt(d2))) - rb * (mu / (rb2 * std::sqrt(rb2)));
+        }
+
+        return total;
+    }
+};
+
+struct ThrustAcceleration
+{
+    static Vector3<double> acceleration(const ForceContext&, const ForceState& state)
+    {
+        return state.thrust / state.mass;
+    }
+};
+
+
+// Sum of the accelerations of Models, in order
+template<typename... Models>
+class ForcePipeline
+{
+    public:
+        static Vector3<double> acceleration(const ForceContext& context, const ForceState& state)
+        {
+            Vector3<double> total(0, 0, 0);
+            ((total += Models::acceleration(context, state)), ...);
+            return total;
+        }
+};
+
+
+// Runtime selection by name. Each entry points at one ForcePipeline instantiation, so picking a
+// combination costs one indirect call per evaluation and the models inside it are still inlined.
+typedef Vector3<double> (*ForceFunction)(const ForceContext& context, const ForceState& state);
+
+struct ForcePipelineDefinition
+{
+    std::string name;
+    ForceFunction acceleration;
+};
+
+template<typename Pipeline>
+ForcePipelineDefinition makeForcePipelineDefinition(const std::string& name)
+{
+    return { name, &Pipeline::acceleration };
+}
+
+// Throws if there is no force pipeline with that name
+const ForcePipelineDefinition& findForcePipeline(const std::string& name);
+
+std::vector<std::string> getForcePipelineNames();
+
+#endif // FORCEPIPELINE_H
@@ -0,0 +1,135 @@
+#include "FrameTree.h"
+
+#include <stdexcept>
+
+FrameTree::FrameTree() : _time(0.0), _epoch(1), _evaluations(0)
+{
+    Frame root;
+    root.name = "root";
+    root.epoch = _epoch;
+    _frames.push_back(root);
+}
+
+int FrameTree::addFrame(const std::string& name, int parent, FrameMotion motion)
+{
+    if (parent < 0 || parent >= static_cast<int>(_frames.size()))
+    {
+        throw std::runtime_error("Error: Frame " + name + " has no parent frame " + std::to_string(parent));
+    }
+
+    Frame frame;
+    frame.name = name;
+    frame.parent = parent;
+    frame.depth = _frames[parent].depth + 1;
+    frame.motion = motion;
+    _frames.push_back(frame);
+
+    return static_cast<int>(_frames.size()) - 1;
+}
+
+int FrameTree::findFrame(const std::string& name) const
+{
+    for (size_t i = 0; i < _frames.size(); i++)
+    {
+        if (_frames[i].name == name)
+        {
+            return static_cast<int>(i);
+        }
+    }
+
+    return -1;
+}
+
+void FrameTree::setTime(double time)
+{
+    _time = time;
+    _epoch++;
+
+    // The root has no motion to evaluate
+    _frames[ROOT].epoch = _epoch;
+}
+
+const FrameTree::Frame& FrameTree::update(int index)
+{
+    Frame& frame = _frames[index];
+
+    if (frame.epoch != _epoch)
+    {
+        frame.motion(_time, frame.position, frame.velocity);
+        frame.epoch = _epoch;
+        _evaluations++;
+    }
+
+    return frame;
+}
+
+void FrameTree::getOffset(int from, int to, Vector3<double>& position, Vector3<double>& velocity)
+{
+    // Climb from both ends to the common ancestor. Offsets on the way up from `from` add, those
+    // on the way up from `to` subtract; the large offsets above the ancestor never enter.
+    Vector3<double> up, upVelocity, down, downVelocity;
+
+    while (from != to)
+    {
+        if (_frames[from].depth >= _frames[to].depth)
+        {
+            const Frame& frame = update(from);
+            up += frame.position;
+            upVelocity += frame.velocity;
+            from = frame.parent;
+        }
+        else
+        {
+            const Frame& frame = update(to);
+            down += frame.position;
+            downVelocity += frame.velocity;
+            to = frame.parent;
+        }
+    }
+
+    position = up - down;
+    velocity = upVelocity - downVelocity;
+}
+
+Vector3<double> FrameTree::transformPosition(const Vector3<double>& position, int from, int to)
+{
+    Vector3<double> offset, velocity;
+    getOffset(from, to, offset, velocity);
+    return offset + position;
+}
+
+void FrameTree::transform(int from, int to, Vector3<double>& position, Vector3<double>& velocity)
+{
+    Vector3<double> offset, offsetVelocity;
+    getOffset(from, to, offset, offsetVelocity);
+
+    position = offset + position;
+    velocity = offsetVelocity + velocity;
+}
+
+void FrameTree::transform(int from, int to, const Vector3<double>* positions, const Vector3<double>* velocities,
+    Vector3<double>* outPositions, Vector3<double>* outVelocities, size_t count)
+{
+    Vector3<double> offset, offsetVelocity;
+    getOffset(from, to, offset, offsetVelocity);
+
+    // Plain loops over the components so they vectorise
+    const double ox = offset.x, oy = offset.y, oz = offset.z;
+    for (size_t i = 0; i < count; i++)
+    {
+        outPositions[i].x = positions[i].x + ox;
+        outPositions[i].y = positions[i].y + oy;
+        outPositions[i].z = positions[i].z + oz;
+    }
+
+    if (velocities && outVelocities)
+    {
+        const double vx = offsetVelocity.x, vy = offsetVelocity.y, vz = offsetVelocity.z;
+        for (size_t i = 0; i < count; i++)
+        {
+            outVelocities[i].x = velocities[i].x + vx;
+            outVelocities[i].y = velocities[i].y + vy;
+            outVelocities[i].z = velocities[i].z + vz;
+        }
+    }
+}
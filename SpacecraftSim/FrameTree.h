@@ -0,0 +1,83 @@
+#ifndef FRAMETREE_H
+#define FRAMETREE_H
+
+#include "Vector3.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Position and velocity of a frame's origin in its parent frame at a mission time
+typedef std::function<void(double time, Vector3<double>& position, Vector3<double>& velocity)> FrameMotion;
+
+// Reference frames as a tree of translating frames: system barycentre, planet, moon, spacecraft.
+// Each frame knows only its offset from its parent. A conversion sums the offsets up to the
+// lowest common ancestor of the two frames instead of going through the root, so a spacecraft
+// near a moon far from the origin is converted with the precision of the small offsets, not the
+// large ones.
+//
+// Offsets are evaluated lazily: setTime() only invalidates them, and a frame's motion is called
+// the first time it is needed at the new time. Not safe to query from several threads.
+class FrameTree
+{
+    public:
+        // The root frame, which never moves
+        static const int ROOT = 0;
+
+        FrameTree();
+        ~FrameTree() {}
+
+        // Returns the new frame's index
+        int addFrame(const std::string& name, int parent, FrameMotion motion);
+
+        // Index of a frame, -1 if there is none by that name
+        int findFrame(const std::string& name) const;
+        const std::string& getName(int frame) const { return _frames[frame].name; }
+        int getParent(int frame) const { return _frames[frame].parent; }
+        size_t size() const { return _frames.size(); }
+
+        // Moves to a new time; every offset is evaluated again when next needed
+        void setTime(double time);
+        double getTime() const { return _time; }
+
+        // Origin of frame `from` in frame `to`
+        void getOffset(int from, int to, Vector3<double>& position, Vector3<double>& velocity);
+
+        Vector3<double> transformPosition(const Vector3<double>& position, int from, int to);
+        void transform(int from, int to, Vector3<double>& position, Vector3<double>& velocity);
+
+        // Many states from one frame to another, with the offset found once
+        void transform(int from, int to, const Vector3<double>* positions, const Vector3<double>* velocities,
+            Vector3<double>* outPositions, Vector3<double>* outVelocities, size_t count);
+
+        // Motions evaluated since construction, for checking that caching works
+        uint64_t getEvaluations() const { return _evaluations; }
+
+    protected:
+        struct Frame
+        {
+            Frame() : parent(-1), depth(0), epoch(0) {}
+            ~Frame() {}
+
+            std::string name;
+            int parent;
+            int depth;
+            FrameMotion motion;
+
+            // Offset from the parent, valid while epoch matches the tree's
+            uint64_t epoch;
+            Vector3<double> position;
+            Vector3<double> velocity;
+        };
+
+        // Brings a frame's offset up to the current time
+        const Frame& update(int frame);
+
+        std::vector<Frame> _frames;
+        double _time;
+        uint64_t _epoch;
+        uint64_t _evaluations;
+};
+
+#endif // FRAMETREE_H
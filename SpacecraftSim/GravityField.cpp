@@ -0,0 +1,239 @@
+#include "GravityField.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+static uint64_t nextRevision()
+{
+    static std::atomic<uint64_t> revision(0);
+    return ++revision;
+}
+
+GravityField::GravityField() : _maxDegree(0), _tolerance(1e-9), _revision(nextRevision()), _maxCutoffRatio(0.0)
+{
+}
+
+void GravityField::resize(int maxDegree)
+{
+    if (maxDegree <= _maxDegree)
+    {
+        return;
+    }
+
+    // Keep the coefficients already set
+    std::vector<double> c(index(maxDegree, maxDegree) + 1, 0.0), s(c.size(), 0.0);
+    std::copy(_c.begin(), _c.end(), c.begin());
+    std::copy(_s.begin(), _s.end(), s.begin());
+    _c.swap(c);
+    _s.swap(s);
+
+    _cutoffRatio.resize(maxDegree + 1, 0.0);
+    _maxDegree = maxDegree;
+
+    // Recursion factors. _a holds the factor of each entry's own recursion: the diagonal
+    // P(m, m) = a * cos(lat) * P(m - 1, m - 1), the sub-diagonal P(m + 1, m) = a * sin(lat) * P(m, m),
+    // and the column recursion below them.
+    _a.assign(_c.size(), 0.0);
+    _b.assign(_c.size(), 0.0);
+    _derivative.assign(_c.size(), 0.0);
+
+    for (int n = 1; n <= maxDegree; n++)
+    {
+        _a[index(n, n)] = n == 1 ? std::sqrt(3.0) : std::sqrt((2.0 * n + 1) / (2.0 * n));
+        _a[index(n, n - 1)] = std::sqrt(2.0 * n + 1);
+
+        for (int m = 0; m + 2 <= n; m++)
+        {
+            double nm = static_cast<double>(n - m) * (n + m);
+            _a[index(n, m)] = std::sqrt((2.0 * n + 1) * (2.0 * n - 1) / nm);
+            _b[index(n, m)] = std::sqrt((2.0 * n + 1) * (n + m - 1) * (n - m - 1) / (nm * (2.0 * n - 3)));
+        }
+
+        for (int m = 0; m < n; m++)
+        {
+            _derivative[index(n, m)] = m == 0 ? std::sqrt(n * (n + 1) / 2.0) : std::sqrt(static_cast<double>(n - m) * (n + m + 1));
+        }
+    }
+}
+
+void GravityField::setCoefficient(int degree, int order, double c, double s)
+{
+    if (degree < 2 || order < 0 || order > degree)
+    {
+        throw std::runtime_error("Error: Harmonic coefficients need degree >= 2 and 0 <= order <= degree. degree = "
+            + std::to_string(degree) + ", order = " + std::to_string(order));
+    }
+
+    resize(degree);
+
+    _c[index(degree, order)] = c;
+    _s[index(degree, order)] = s;
+    _revision = nextRevision();
+
+    // Distance in radii inside which this degree matters: (n + 1) * (R / r)^n * size >= tolerance
+    double size = 0.0;
+    for (int m = 0; m <= degree; m++)
+    {
+        size = std::max(size, std::max(std::fabs(_c[index(degree, m)]), std::fabs(_s[index(degree, m)])));
+    }
+
+    _cutoffRatio[degree] = size > 0 ? std::pow((degree + 1) * size / _tolerance, 1.0 / degree) : 0.0;
+    _maxCutoffRatio = *std::max_element(_cutoffRatio.begin(), _cutoffRatio.end());
+}
+
+void GravityField::setTolerance(double tolerance)
+{
+    _tolerance = tolerance;
+
+    for (int n = 2; n <= _maxDegree; n++)
+    {
+        setCoefficient(n, 0, _c[index(n, 0)], _s[index(n, 0)]);
+    }
+}
+
+int GravityField::getDegreeForDistance(double r, double radius) const
+{
+    if (r >= _maxCutoffRatio * radius)
+    {
+        return 0;
+    }
+
+    for (int n = _maxDegree; n >= 2; n--)
+    {
+        if (r < _cutoffRatio[n] * radius)
+        {
+            return n;
+        }
+    }
+
+    return 0;
+}
+
+Vector3<double> GravityField::getAcceleration(const Vector3<double>& position, double mu, double radius) const
+{
+    int degree = getDegreeForDistance(position.magnitude(), radius);
+    if (degree < 2)
+    {
+        return Vector3<double>(0, 0, 0);
+    }
+
+    static thread_local GravityWorkspace workspace;
+    return getAcceleration(position, mu, radius, degree, workspace);
+}
+
+Vector3<double> GravityField::getAcceleration(const Vector3<double>& position, double mu, double radius, int degree, GravityWorkspace& workspace) const
+{
+    degree = std::min(degree, _maxDegree);
+
+    if (degree < 2)
+    {
+        return Vector3<double>(0, 0, 0);
+    }
+
+    if (degree == workspace.degree && _revision == workspace.revision && mu == workspace.mu && radius == workspace.radius
+        && position.x == workspace.position.x && position.y == workspace.position.y && position.z == workspace.position.z)
+    {
+        return workspace.result;
+    }
+
+    const double x = position.x, y = position.y, z = position.z;
+    const double r2 = x * x + y * y + z * z;
+    const double r = std::sqrt(r2);
+
+    if (r == 0)
+    {
+        return Vector3<double>(0, 0, 0);
+    }
+
+    // On the pole axis the longitude is undefined; a tiny distance from the axis keeps the
+    // formulas finite and the terms that depend on it vanish with x and y
+    const double rho = std::max(std::sqrt(x * x + y * y), 1e-12 * r);
+    const double t = z / r;         // sin(lat)
+    const double u = rho / r;       // cos(lat)
+    const double tanLatitude = t / u;
+
+    // cos(m * lon) and sin(m * lon) by angle addition
+    auto& cosine = workspace.cosine;
+    auto& sine = workspace.sine;
+    cosine.resize(degree + 1);
+    sine.resize(degree + 1);
+
+    cosine[0] = 1.0;
+    sine[0] = 0.0;
+    const double cosLongitude = x / rho, sinLongitude = y / rho;
+
+    for (int m = 1; m <= degree; m++)
+    {
+        cosine[m] = cosine[m - 1] * cosLongitude - sine[m - 1] * sinLongitude;
+        sine[m] = sine[m - 1] * cosLongitude + cosine[m - 1] * sinLongitude;
+    }
+
+    // Normalized associated Legendre functions of sin(lat)
+    auto& P = workspace.legendre;
+    P.assign(index(degree, degree) + 1, 0.0);
+    P[0] = 1.0;
+
+    for (int m = 1; m <= degree; m++)
+    {
+        P[index(m, m)] = _a[index(m, m)] * u * P[index(m - 1, m - 1)];
+    }
+
+    for (int m = 0; m < degree; m++)
+    {
+        P[index(m + 1, m)] = _a[index(m + 1, m)] * t * P[index(m, m)];
+    }
+
+    for (int m = 0; m <= degree; m++)
+    {
+        for (int n = m + 2; n <= degree; n++)
+        {
+            P[index(n, m)] = _a[index(n, m)] * t * P[index(n - 1, m)] - _b[index(n, m)] * P[index(n - 2, m)];
+        }
+    }
+
+    // Partial derivatives of the potential in radius, latitude and longitude
+    double dRadius = 0.0, dLatitude = 0.0, dLongitude = 0.0;
+    const double ratio = radius / r;
+    double scale = ratio;
+
+    for (int n = 2; n <= degree; n++)
+    {
+        scale *= ratio;
+
+        double sumRadius = 0.0, sumLatitude = 0.0, sumLongitude = 0.0;
+
+        for (int m = 0; m <= n; m++)
+        {
+            int nm = index(n, m);
+            double term = _c[nm] * cosine[m] + _s[nm] * sine[m];
+            double derivative = (m < n ? _derivative[nm] * P[nm + 1] : 0.0) - m * tanLatitude * P[nm];
+
+            sumRadius += P[nm] * term;
+            sumLatitude += derivative * term;
+            sumLongitude += m * P[nm] * (_s[nm] * cosine[m] - _c[nm] * sine[m]);
+        }
+
+        dRadius -= (n + 1) * scale * sumRadius;
+        dLatitude += scale * sumLatitude;
+        dLongitude += scale * sumLongitude;
+    }
+
+    dRadius *= mu / r2;
+    dLatitude *= mu / r;
+    dLongitude *= mu / r;
+
+    const double radial = dRadius / r - z * dLatitude / (r2 * rho);
+    const double east = dLongitude / (rho * rho);
+
+    workspace.revision = _revision;
+    workspace.mu = mu;
+    workspace.radius = radius;
+    workspace.position = position;
+    workspace.degree = degree;
+    workspace.result = Vector3<double>(radial * x - east * y, radial * y + east * x, dRadius * z / r + rho * dLatitude / r2);
+
+    return workspace.result;
+}
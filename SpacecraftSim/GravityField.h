@@ -0,0 +1,96 @@
+#ifndef GRAVITYFIELD_H
+#define GRAVITYFIELD_H
+
+#include "Vector3.h"
+
+#include <cstdint>
+#include <vector>
+
+// Scratch of one evaluation: Legendre functions, cos(m*lon) and sin(m*lon), and the last
+// result. Each thread or caller keeps its own so a field can be shared.
+struct GravityWorkspace
+{
+    GravityWorkspace() : revision(0), mu(0.0), radius(0.0), degree(-1) {}
+    ~GravityWorkspace() {}
+
+    std::vector<double> legendre;
+    std::vector<double> cosine;
+    std::vector<double> sine;
+
+    // Evaluating the same field at the same position again, from another stage of the same step,
+    // reuses the result
+    uint64_t revision;
+    double mu;
+    double radius;
+    Vector3<double> position;
+    Vector3<double> result;
+    int degree;
+};
+
+
+// Zonal and tesseral harmonics of a planet's gravity from fully normalized coefficients C(n, m)
+// and S(n, m), degree 2 and up. The point mass term is left to getGravitationalAcceleration, so
+// this returns only the perturbation.
+//
+// The associated Legendre functions come from the standard normalized recursions (diagonal,
+// first sub-diagonal, then the column recursion in n), which stay stable to high degree, with
+// the recursion factors computed once per field. cos(m*lon) and sin(m*lon) come from the angle
+// addition recursion, so an evaluation makes no trig calls.
+//
+// The degree adapts to distance: degree n is skipped once (n + 1) * (R / r)^n * max|C, S|(n)
+// falls below the tolerance relative to the point mass term. The distance where that happens is
+// kept per degree, so spacecraft beyond every cutoff get no harmonic terms and pay one comparison.
+class GravityField
+{
+    public:
+        GravityField();
+        ~GravityField() {}
+
+        // Throws for degree below 2 or order above degree
+        void setCoefficient(int degree, int order, double c, double s);
+        double getC(int degree, int order) const { return _c[index(degree, order)]; }
+        double getS(int degree, int order) const { return _s[index(degree, order)]; }
+
+        int getMaxDegree() const { return _maxDegree; }
+        bool isEmpty() const { return _maxDegree < 2; }
+
+        // Per degree, relative to the point mass acceleration; 1e-9 by default
+        void setTolerance(double tolerance);
+        double getTolerance() const { return _tolerance; }
+
+        // Highest degree worth evaluating at distance r from the center; below 2 means none
+        int getDegreeForDistance(double r, double radius) const;
+
+        // Perturbing acceleration at a position relative to the planet center, with the
+        // planet's gravitational parameter and reference radius. The first form picks the
+        // degree from the distance and uses a per thread workspace.
+        Vector3<double> getAcceleration(const Vector3<double>& position, double mu, double radius) const;
+        Vector3<double> getAcceleration(const Vector3<double>& position, double mu, double radius, int degree, GravityWorkspace& workspace) const;
+
+    protected:
+        static int index(int degree, int order) { return degree * (degree + 1) / 2 + order; }
+
+        void resize(int maxDegree);
+
+        int _maxDegree;
+        double _tolerance;
+
+        // Unique to these coefficients across all fields; renewed whenever one is set, so a
+        // workspace never returns a result of another field or of coefficients since changed
+        uint64_t _revision;
+
+        std::vector<double> _c;
+        std::vector<double> _s;
+
+        // Beyond _cutoffRatio[n] planet radii degree n is below the tolerance
+        std::vector<double> _cutoffRatio;
+        double _maxCutoffRatio;
+
+        // Recursion factors P(n, m) = a * sin(lat) * P(n - 1, m) - b * P(n - 2, m), and the
+        // factor of P(n, m + 1) in dP(n, m)/dlat
+        std::vector<double> _a;
+        std::vector<double> _b;
+        std::vector<double> _derivative;
+};
+
+#endif // GRAVITYFIELD_H
@@ -0,0 +1,256 @@
+#include "KeplerPropagator.h"
+
+#include <algorithm>
+#include <cmath>
+
+static const double PI = 3.14159265358979323846;
+
+// Steps of rotated sines and cosines between exact ones
+static const int ROTATIONS = 256;
+
+// Mean anomaly in [-pi, pi)
+static double wrapMeanAnomaly(double meanAnomaly)
+{
+    return meanAnomaly - 2.0 * PI * std::floor((meanAnomaly + PI) * (0.5 / PI));
+}
+
+// The same for angles already within 2 pi of the range
+static double wrapNear(double angle)
+{
+    return angle >= PI ? angle - 2.0 * PI : (angle < -PI ? angle + 2.0 * PI : angle);
+}
+
+KeplerPropagator::KeplerPropagator() : _hyperbolic(false), _eccentricity(0), _meanMotion(0), _meanAnomaly(0), _velocityScale(0),
+    _anomaly(0), _sine(0), _cosine(1), _inverse(1), _rotations(0), _lastMeanAnomaly(0)
+{
+}
+
+bool KeplerPropagator::initialize(const Vector3<double>& position, const Vector3<double>& velocity, double mu)
+{
+    if (!(mu > 0) || position.cross(velocity).magnitudeSquared() == 0)
+    {
+        return false;
+    }
+
+    _elements = OrbitalElements::fromState(position, velocity, mu);
+    _eccentricity = _elements.eccentricity;
+
+    if (std::fabs(_eccentricity - 1.0) < 1e-6)
+    {
+        return false;
+    }
+
+    _hyperbolic = _eccentricity > 1.0;
+
+    const double a = std::fabs(_elements.semiMajorAxis);
+    const double b = a * std::sqrt(std::fabs(1.0 - _eccentricity * _eccentricity));
+
+    _meanMotion = std::sqrt(mu / (a * a * a));
+    _velocityScale = std::sqrt(mu / a) / a;
+    _axisP = _elements.periapsisDirection * a;
+    _axisQ = _elements.lateralDirection * b;
+
+    // Anomaly of the initial state, true anomaly in (-pi, pi]
+    double nu = _elements.trueAnomaly > PI ? _elements.trueAnomaly - 2.0 * PI : _elements.trueAnomaly;
+
+    if (_hyperbolic)
+    {
+        _anomaly = 2.0 * std::atanh(std::sqrt((_eccentricity - 1.0) / (_eccentricity + 1.0)) * std::tan(0.5 * nu));
+        _meanAnomaly = _eccentricity * std::sinh(_anomaly) - _anomaly;
+    }
+    else
+    {
+        _anomaly = 2.0 * std::atan2(std::sqrt(1.0 - _eccentricity) * std::sin(0.5 * nu), std::sqrt(1.0 + _eccentricity) * std::cos(0.5 * nu));
+        _meanAnomaly = _anomaly - _eccentricity * std::sin(_anomaly);
+        _sine = std::sin(_anomaly);
+        _cosine = std::cos(_anomaly);
+        _inverse = 1.0 / (1.0 - _eccentricity * _cosine);
+        _rotations = 0;
+    }
+
+    _lastMeanAnomaly = _meanAnomaly;
+    return true;
+}
+
+void KeplerPropagator::getState(double time, Vector3<double>& position, Vector3<double>& velocity)
+{
+    const double e = _eccentricity;
+    double meanAnomaly = _meanAnomaly + _meanMotion * time;
+
+    if (_hyperbolic)
+    {
+        // No wrap: the hyperbolic anomaly grows without bound
+        _anomaly = solveHyperbolic(meanAnomaly, e, _anomaly);
+        _lastMeanAnomaly = meanAnomaly;
+
+        double s = std::sinh(_anomaly), c = std::cosh(_anomaly);
+        double scale = _velocityScale / (e * c - 1.0);
+
+        position = _axisP * (e - c) + _axisQ * s;
+        velocity = (_axisP * -s + _axisQ * c) * scale;
+        return;
+    }
+
+    // Wrapped so precision holds over many orbits
+    meanAnomaly = wrapMeanAnomaly(meanAnomaly);
+
+    // Prediction from the last solution, dE = dM / (1 - e cos(E)), and one Newton correction.
+    // The prediction is good to second order in the step, so after the correction the error is
+    // far below double precision. Small steps rotate the last sine and cosine by dE instead of
+    // calling sin and cos, with exact ones every ROTATIONS steps so rounding cannot build up.
+    double dE = wrapNear(meanAnomaly - _lastMeanAnomaly) * _inverse;
+    double E = _anomaly + dE;
+    double s, c;
+
+    if (std::fabs(dE) < 1e-3 && _rotations < ROTATIONS)
+    {
+        double d2 = dE * dE;
+        double sinStep = dE * (1.0 - d2 / 6.0 * (1.0 - d2 / 20.0));
+        double cosStep = 1.0 - d2 / 2.0 * (1.0 - d2 / 12.0);
+
+        s = _sine * cosStep + _cosine * sinStep;
+        c = _cosine * cosStep - _sine * sinStep;
+        _rotations++;
+    }
+    else
+    {
+        s = std::sin(E);
+        c = std::cos(E);
+        _rotations = 0;
+    }
+
+    // The last solution's 1 / (1 - e cos(E)) is close enough for the derivative
+    double step = wrapNear(E - e * s - meanAnomaly) * _inverse;
+
+    if (std::fabs(step) < 1e-8)
+    {
+        E -= step;
+        double rotated = s - step * c;
+        c += step * s;
+        s = rotated;
+    }
+    else
+    {
+        // A long step or the first one
+        E = solveElliptic(meanAnomaly, e, wrapMeanAnomaly(E));
+        s = std::sin(E);
+        c = std::cos(E);
+        _rotations = 0;
+    }
+
+    _anomaly = wrapNear(E);
+    _sine = s;
+    _cosine = c;
+    _inverse = 1.0 / (1.0 - e * c);
+    _lastMeanAnomaly = meanAnomaly;
+
+    double scale = _velocityScale * _inverse;
+
+    position = _axisP * (c - e) + _axisQ * s;
+    velocity = (_axisP * -s + _axisQ * c) * scale;
+}
+
+double KeplerPropagator::solveElliptic(double meanAnomaly, double eccentricity, double guess)
+{
+    // The root lies within e of M; keeping the iterates there stops Newton from wandering at high e
+    const double low = meanAnomaly - eccentricity, high = meanAnomaly + eccentricity;
+    double E = std::min(std::max(guess, low), high);
+
+    for (int i = 0; i < 50; i++)
+    {
+        double step = (E - eccentricity * std::sin(E) - meanAnomaly) / (1.0 - eccentricity * std::cos(E));
+        E = std::min(std::max(E - step, low), high);
+
+        if (std::fabs(step) < 1e-14)
+        {
+            break;
+        }
+    }
+
+    return E;
+}
+
+double KeplerPropagator::solveHyperbolic(double meanAnomaly, double eccentricity, double guess)
+{
+    double H = guess;
+
+    for (int i = 0; i < 100; i++)
+    {
+        double step = (eccentricity * std::sinh(H) - H - meanAnomaly) / (eccentricity * std::cosh(H) - 1.0);
+
+        // Far from the root the exponential overshoots; limit the step
+        if (std::fabs(step) > 1.0)
+        {
+            step = step > 0 ? 1.0 : -1.0;
+        }
+
+        H -= step;
+
+        if (std::fabs(step) < 1e-14 * std::max(1.0, std::fabs(H)))
+        {
+            break;
+        }
+    }
+
+    return H;
+}
+
+
+void KeplerPropagator::saveState(BinaryWriter& writer) const
+{
+    writer.write(_elements.semiMajorAxis);
+    writer.write(_elements.eccentricity);
+    writer.write(_elements.inclination);
+    writer.write(_elements.rightAscension);
+    writer.write(_elements.argumentOfPeriapsis);
+    writer.write(_elements.trueAnomaly);
+    writer.write(_elements.semiLatusRectum);
+    writer.write(_elements.gravitationalParameter);
+    writer.write(_elements.periapsisDirection);
+    writer.write(_elements.lateralDirection);
+    writer.write(_elements.normal);
+
+    writer.write(_hyperbolic);
+    writer.write(_eccentricity);
+    writer.write(_meanMotion);
+    writer.write(_meanAnomaly);
+    writer.write(_velocityScale);
+    writer.write(_anomaly);
+    writer.write(_sine);
+    writer.write(_cosine);
+    writer.write(_inverse);
+    writer.write(_rotations);
+    writer.write(_lastMeanAnomaly);
+    writer.write(_axisP);
+    writer.write(_axisQ);
+}
+
+
+void KeplerPropagator::loadState(BinaryReader& reader)
+{
+    reader.read(_elements.semiMajorAxis);
+    reader.read(_elements.eccentricity);
+    reader.read(_elements.inclination);
+    reader.read(_elements.rightAscension);
+    reader.read(_elements.argumentOfPeriapsis);
+    reader.read(_elements.trueAnomaly);
+    reader.read(_elements.semiLatusRectum);
+    reader.read(_elements.gravitationalParameter);
+    reader.read(_elements.periapsisDirection);
+    reader.read(_elements.lateralDirection);
+    reader.read(_elements.normal);
+
+    reader.read(_hyperbolic);
+    reader.read(_eccentricity);
+    reader.read(_meanMotion);
+    reader.read(_meanAnomaly);
+    reader.read(_velocityScale);
+    reader.read(_anomaly);
+    reader.read(_sine);
+    reader.read(_cosine);
+    reader.read(_inverse);
+    reader.read(_rotations);
+    reader.read(_lastMeanAnomaly);
+    reader.read(_axisP);
+    reader.read(_axisQ);
+}
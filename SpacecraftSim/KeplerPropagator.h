@@ -0,0 +1,59 @@
+#ifndef KEPLERPROPAGATOR_H
+#define KEPLERPROPAGATOR_H
+
+#include "Checkpoint.h"
+#include "OrbitalElements.h"
+#include "Vector3.h"
+
+// Two-body motion around one body, solved analytically. The state is converted to elements once;
+// after that a state at any time is one solve of Kepler's equation. Steps in sequence predict the
+// anomaly from the last solution, rotate its sine and cosine and need a single Newton correction,
+// a few dozen flops and no trig calls.
+//
+// Elliptic orbits use the eccentric anomaly E, M = E - e sin(E); hyperbolic orbits the
+// hyperbolic anomaly H, M = e sinh(H) - H. Orbits within 1e-6 of parabolic are not handled.
+class KeplerPropagator
+{
+    public:
+        KeplerPropagator();
+        ~KeplerPropagator() {}
+
+        // From a state relative to the body's center. Returns false for orbits it cannot propagate:
+        // radial, near parabolic, or mu not positive.
+        bool initialize(const Vector3<double>& position, const Vector3<double>& velocity, double mu);
+
+        // State time seconds after the initial one, relative to the body's center
+        void getState(double time, Vector3<double>& position, Vector3<double>& velocity);
+
+        const OrbitalElements& getElements() const { return _elements; }
+        bool isHyperbolic() const { return _hyperbolic; }
+
+        // Checkpoint methods. The last solution is saved too, since the next step starts from it.
+        void saveState(BinaryWriter& writer) const;
+        void loadState(BinaryReader& reader);
+
+        // Eccentric and hyperbolic anomaly of a mean anomaly, by Newton's method from guess
+        static double solveElliptic(double meanAnomaly, double eccentricity, double guess);
+        static double solveHyperbolic(double meanAnomaly, double eccentricity, double guess);
+
+    protected:
+        OrbitalElements _elements;
+        bool _hyperbolic;
+
+        double _eccentricity;
+        double _meanMotion;
+        double _meanAnomaly;        // at time 0
+        double _velocityScale;      // sqrt(mu / a) / a with a = |semi-major axis|
+        double _anomaly;            // last E or H, the next guess
+        double _sine;               // sin(E) and cos(E) of the last solution
+        double _cosine;
+        double _inverse;            // 1 / (1 - e cos(E)), dE/dM
+        int _rotations;             // steps since sin and cos were last called
+        double _lastMeanAnomaly;
+
+        // a * periapsis direction, and b * lateral direction with b = a * sqrt(|1 - e^2|)
+        Vector3<double> _axisP;
+        Vector3<double> _axisQ;
+};
+
+#endif // KEPLERPROPAGATOR_H
@@ -0,0 +1,173 @@
+#include "Lambert.h"
+
+#include <algorithm>
+#include <cmath>
+
+static const double FOUR_PI_SQUARED = 4.0 * 3.14159265358979323846 * 3.14159265358979323846;
+
+// Stumpff functions C(z) and S(z), by series near z = 0 where the closed forms cancel
+static void stumpff(double z, double& C, double& S)
+{
+    if (z > 1e-3)
+    {
+        double s = std::sqrt(z);
+        C = (1.0 - std::cos(s)) / z;
+        S = (s - std::sin(s)) / (s * z);
+    }
+    else if (z < -1e-3)
+    {
+        double s = std::sqrt(-z);
+        C = (std::cosh(s) - 1.0) / -z;
+        S = (std::sinh(s) - s) / (s * -z);
+    }
+    else
+    {
+        C = 1.0 / 2.0 - z * (1.0 / 24.0 - z * (1.0 / 720.0 - z / 40320.0));
+        S = 1.0 / 6.0 - z * (1.0 / 120.0 - z * (1.0 / 5040.0 - z / 362880.0));
+    }
+}
+
+// y(z), negative where the geometry allows no arc
+static double yFunction(double z, double r1, double r2, double A, double C, double S)
+{
+    return r1 + r2 + A * (z * S - 1.0) / std::sqrt(C);
+}
+
+// sqrt(mu) times the time of flight of z less the wanted one, and its derivative. Where y is
+// negative the arc does not exist; the value is then below any real one, which keeps the
+// function increasing for the bracket.
+static double timeFunction(double z, double r1, double r2, double A, double scaledTime, double& derivative)
+{
+    double C, S;
+    stumpff(z, C, S);
+
+    double y = yFunction(z, r1, r2, A, C, S);
+    if (y < 0)
+    {
+        derivative = 0.0;
+        return -scaledTime;
+    }
+
+    double sqrtY = std::sqrt(y);
+    double x3 = std::pow(y / C, 1.5);
+
+    if (std::fabs(z) > 1e-3)
+    {
+        derivative = x3 * ((C - 1.5 * S / C) / (2.0 * z) + 0.75 * S * S / C) + A / 8.0 * (3.0 * S / C * sqrtY + A * std::sqrt(C / y));
+    }
+    else
+    {
+        derivative = std::sqrt(2.0) / 40.0 * y * sqrtY + A / 8.0 * (sqrtY + A * std::sqrt(0.5 / y));
+    }
+
+    return x3 * S + A * sqrtY - scaledTime;
+}
+
+bool LambertSolver::solve(const Vector3<double>& r1, const Vector3<double>& r2, double timeOfFlight, double mu,
+    Vector3<double>& v1, Vector3<double>& v2)
+{
+    double A = geometry(r1, r2);
+    double z = 0.0;
+
+    if (!solveUniversal(r1.magnitude(), r2.magnitude(), A, timeOfFlight, mu, z))
+    {
+        return false;
+    }
+
+    double f, g, gdot;
+    coefficients(r1.magnitude(), r2.magnitude(), A, z, mu, f, g, gdot);
+
+    v1 = (r2 - r1 * f) / g;
+    v2 = (r2 * gdot - r1) / g;
+    return true;
+}
+
+double LambertSolver::geometry(const Vector3<double>& r1, const Vector3<double>& r2)
+{
+    double r1r2 = r1.magnitude() * r2.magnitude();
+
+    // No transfer plane
+    if (r1.cross(r2).magnitude() <= 1e-12 * r1r2)
+    {
+        return 0.0;
+    }
+
+    // sin(theta) sqrt(r1 r2 / (1 - cos(theta))) for the short way, without the angle
+    return std::sqrt(r1r2 + r1.dot(r2));
+}
+
+bool LambertSolver::solveUniversal(double r1, double r2, double A, double timeOfFlight, double mu, double& z)
+{
+    if (!(A > 0) || !(timeOfFlight > 0) || !(mu > 0))
+    {
+        return false;
+    }
+
+    const double scaledTime = std::sqrt(mu) * timeOfFlight;
+    double derivative;
+
+    // The time of flight runs to infinity as z nears 4 pi^2 and falls towards 0 for very
+    // hyperbolic arcs, so the root lies in [low, high] once low is far enough down
+    double high = FOUR_PI_SQUARED * (1.0 - 1e-9);
+    double low = -FOUR_PI_SQUARED;
+
+    if (timeFunction(high, r1, r2, A, scaledTime, derivative) <= 0)
+    {
+        return false;
+    }
+
+    while (timeFunction(low, r1, r2, A, scaledTime, derivative) > 0)
+    {
+        high = low;
+        low *= 2.0;
+
+        // cosh overflows further out; arcs this fast are straight lines
+        if (low < -4e5)
+        {
+            return false;
+        }
+    }
+
+    z = std::min(std::max(z, low), high);
+
+    // Newton, with bisection whenever a step leaves the bracket
+    for (int i = 0; i < 100; i++)
+    {
+        double value = timeFunction(z, r1, r2, A, scaledTime, derivative);
+
+        if (value == 0)
+        {
+            return true;
+        }
+
+        (value < 0 ? low : high) = z;
+
+        double next = z - value / derivative;
+        if (!(next > low && next < high))
+        {
+            next = 0.5 * (low + high);
+        }
+
+        if (std::fabs(next - z) < 1e-13 * std::max(1.0, std::fabs(z)))
+        {
+            z = next;
+            return true;
+        }
+
+        z = next;
+    }
+
+    return high - low < 1e-9 * std::max(1.0, std::fabs(z));
+}
+
+void LambertSolver::coefficients(double r1, double r2, double A, double z, double mu, double& f, double& g, double& gdot)
+{
+    double C, S;
+    stumpff(z, C, S);
+
+    double y = yFunction(z, r1, r2, A, C, S);
+
+    f = 1.0 - y / r1;
+    g = A * std::sqrt(y / mu);
+    gdot = 1.0 - y / r2;
+}
@@ -0,0 +1,29 @@
+#ifndef LAMBERT_H
+#define LAMBERT_H
+
+#include "Vector3.h"
+
+// Lambert's problem: the two-body arc from r1 to r2 in a given time of flight, solved with
+// universal variables. The time of flight grows monotonically with the variable z, from
+// hyperbolic arcs (z < 0) through the parabola (z = 0) to the slowest ellipse as z nears 4 pi^2,
+// so a Newton iteration kept inside a bracket always converges. Zero revolutions, and the
+// short way round, where the transfer angle is below pi.
+class LambertSolver
+{
+    public:
+        // Velocities at r1 and r2. Returns false when there is no solution or r1 and r2 are parallel.
+        static bool solve(const Vector3<double>& r1, const Vector3<double>& r2, double timeOfFlight, double mu,
+            Vector3<double>& v1, Vector3<double>& v2);
+
+        // Geometry term A of the universal variable form, 0 when r1 and r2 are parallel or opposite
+        static double geometry(const Vector3<double>& r1, const Vector3<double>& r2);
+
+        // z for |r1|, |r2| and A, from a guess; neighbouring problems make good guesses.
+        // Returns false when there is no solution.
+        static bool solveUniversal(double r1, double r2, double A, double timeOfFlight, double mu, double& z);
+
+        // Lagrange coefficients of a solution, v1 = (r2 - f r1) / g and v2 = (gdot r2 - r1) / g
+        static void coefficients(double r1, double r2, double A, double z, double mu, double& f, double& g, double& gdot);
+};
+
+#endif // LAMBERT_H
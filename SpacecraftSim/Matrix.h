@@ -0,0 +1,534 @@
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#include "Vector3.h"
+
+#include <cmath>
+#include <initializer_list>
+#include <stdexcept>
+#include <type_traits>
+
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
+
+// Fixed-size matrices for attitude, covariance and harmonics work: 3x3, 4x4, 6x6 and the like.
+// Elements are stored row-major in the object itself; a vector is an N x 1 matrix, VectorN.
+//
+// Everything is constexpr except what needs sqrt or intrinsics: cholesky(), and operator* on
+// double 3x3 and 6x6 matrices when built with AVX, which takes the hand-written kernels below.
+// multiply() is the same product, always constexpr.
+//
+// Sums, differences, negation and scaling are expression templates. A + B * 2.0 - C builds one
+// object, and the Matrix constructed or assigned from it computes each element once with no
+// temporary matrices. Products and everything else evaluate at once. Expressions hold references
+// to their Matrix operands; do not keep them in `auto` variables past those operands' lifetimes.
+template<typename T, int R, int C>
+class Matrix;
+
+template<typename E, typename T, int R, int C>
+struct MatrixExpression {
+    typedef T value_type;
+
+    constexpr const E& self() const { return static_cast<const E&>(*this); }
+
+    // Element i in row-major order
+    constexpr T get(int i) const { return self().get(i); }
+};
+
+// Expressions keep Matrix operands by reference and other expressions by value
+template<typename E>
+struct MatrixOperand {
+    typedef const E type;
+};
+
+template<typename T, int R, int C>
+struct MatrixOperand<Matrix<T, R, C> > {
+    typedef const Matrix<T, R, C>& type;
+};
+
+template<typename A, typename B, typename T, int R, int C>
+struct MatrixSum : public MatrixExpression<MatrixSum<A, B, T, R, C>, T, R, C> {
+    constexpr MatrixSum(const A& a, const B& b) : a(a), b(b) {}
+    constexpr T get(int i) const { return a.get(i) + b.get(i); }
+
+    typename MatrixOperand<A>::type a;
+    typename MatrixOperand<B>::type b;
+};
+
+template<typename A, typename B, typename T, int R, int C>
+struct MatrixDifference : public MatrixExpression<MatrixDifference<A, B, T, R, C>, T, R, C> {
+    constexpr MatrixDifference(const A& a, const B& b) : a(a), b(b) {}
+    constexpr T get(int i) const { return a.get(i) - b.get(i); }
+
+    typename MatrixOperand<A>::type a;
+    typename MatrixOperand<B>::type b;
+};
+
+template<typename E, typename T, int R, int C>
+struct MatrixScale : public MatrixExpression<MatrixScale<E, T, R, C>, T, R, C> {
+    constexpr MatrixScale(const E& e, T s) : e(e), s(s) {}
+    constexpr T get(int i) const { return e.get(i) * s; }
+
+    typename MatrixOperand<E>::type e;
+    T s;
+};
+
+template<typename E, typename T, int R, int C>
+struct MatrixNegate : public MatrixExpression<MatrixNegate<E, T, R, C>, T, R, C> {
+    constexpr MatrixNegate(const E& e) : e(e) {}
+    constexpr T get(int i) const { return -e.get(i); }
+
+    typename MatrixOperand<E>::type e;
+};
+
+template<typename T, int R, int C>
+class Matrix : public MatrixExpression<Matrix<T, R, C>, T, R, C> {
+    public:
+        static_assert(R > 0 && C > 0, "Matrix dimensions must be positive");
+
+        static const int SIZE = R * C;
+
+        // Zero
+        constexpr Matrix() : _data{} {}
+
+        // Elements in row-major order
+        constexpr Matrix(std::initializer_list<T> elements) : _data{} {
+            if (elements.size() != static_cast<size_t>(SIZE)) {
+                throw std::runtime_error("Error: Matrix initializer has the wrong number of elements.");
+            }
+
+            int i = 0;
+            for (T element : elements) {
+                _data[i++] = element;
+            }
+        }
+
+        template<typename E>
+        constexpr Matrix(const MatrixExpression<E, T, R, C>& e) : _data{} {
+            for (int i = 0; i < SIZE; i++) {
+                _data[i] = e.get(i);
+            }
+        }
+
+        // A column vector from a Vector3
+        template<int N = R, typename = typename std::enable_if<N == 3 && C == 1>::type>
+        explicit Matrix(const Vector3<T>& v) : _data{ v.x, v.y, v.z } {}
+
+        template<int N = R, typename = typename std::enable_if<N == 3 && C == 1>::type>
+        Vector3<T> toVector3() const {
+            return Vector3<T>(_data[0], _data[1], _data[2]);
+        }
+
+        static constexpr Matrix identity() {
+            static_assert(R == C, "Only square matrices have an identity");
+
+            Matrix m;
+            for (int i = 0; i < R; i++) {
+                m(i, i) = T(1);
+            }
+            return m;
+        }
+
+        constexpr T& operator()(int row, int column) { return _data[row * C + column]; }
+        constexpr const T& operator()(int row, int column) const { return _data[row * C + column]; }
+
+        // Elements in row-major order; for vectors, the components
+        constexpr T& operator[](int i) { return _data[i]; }
+        constexpr const T& operator[](int i) const { return _data[i]; }
+
+        constexpr T get(int i) const { return _data[i]; }
+
+        T* data() { return _data; }
+        const T* data() const { return _data; }
+
+        // Evaluates every element before storing any, so the target may appear in the expression
+        template<typename E>
+        constexpr Matrix& operator=(const MatrixExpression<E, T, R, C>& e) {
+            Matrix m(e);
+            return *this = m;
+        }
+
+        template<typename E>
+        constexpr Matrix& operator+=(const MatrixExpression<E, T, R, C>& e) {
+            for (int i = 0; i < SIZE; i++) {
+                _data[i] += e.get(i);
+            }
+            return *this;
+        }
+
+        template<typename E>
+        constexpr Matrix& operator-=(const MatrixExpression<E, T, R, C>& e) {
+            for (int i = 0; i < SIZE; i++) {
+                _data[i] -= e.get(i);
+            }
+            return *this;
+        }
+
+        constexpr Matrix& operator*=(T s) {
+            for (int i = 0; i < SIZE; i++) {
+                _data[i] *= s;
+            }
+            return *this;
+        }
+
+        constexpr Matrix<T, C, R> transpose() const {
+            Matrix<T, C, R> m;
+            for (int i = 0; i < R; i++) {
+                for (int j = 0; j < C; j++) {
+                    m(j, i) = (*this)(i, j);
+                }
+            }
+            return m;
+        }
+
+        constexpr T trace() const {
+            static_assert(R == C, "Only square matrices have a trace");
+
+            T sum = 0;
+            for (int i = 0; i < R; i++) {
+                sum += (*this)(i, i);
+            }
+            return sum;
+        }
+
+        // Sum of squared elements; for vectors, the squared length
+        constexpr T normSquared() const {
+            T sum = 0;
+            for (int i = 0; i < SIZE; i++) {
+                sum += _data[i] * _data[i];
+            }
+            return sum;
+        }
+
+        constexpr T dot(const Matrix& m) const {
+            static_assert(C == 1, "dot is for column vectors");
+
+            T sum = 0;
+            for (int i = 0; i < R; i++) {
+                sum += _data[i] * m._data[i];
+            }
+            return sum;
+        }
+
+        // Gaussian elimination with partial pivoting; closed form for 3x3
+        constexpr T determinant() const {
+            static_assert(R == C, "Only square matrices have a determinant");
+
+            if constexpr (R == 3) {
+                const Matrix& m = *this;
+                return m(0, 0) * (m(1, 1) * m(2, 2) - m(1, 2) * m(2, 1))
+                    - m(0, 1) * (m(1, 0) * m(2, 2) - m(1, 2) * m(2, 0))
+                    + m(0, 2) * (m(1, 0) * m(2, 1) - m(1, 1) * m(2, 0));
+            }
+            else {
+                Matrix m = *this;
+                T determinant = 1;
+
+                for (int k = 0; k < R; k++) {
+                    int pivot = findPivot(m, k);
+                    if (m(pivot, k) == 0) {
+                        return 0;
+                    }
+                    if (pivot != k) {
+                        swapRows(m, pivot, k);
+                        determinant = -determinant;
+                    }
+
+                    determinant *= m(k, k);
+                    for (int i = k + 1; i < R; i++) {
+                        T f = m(i, k) / m(k, k);
+                        for (int j = k; j < C; j++) {
+                            m(i, j) -= f * m(k, j);
+                        }
+                    }
+                }
+
+                return determinant;
+            }
+        }
+
+        // Adjugate over determinant for 3x3, Gauss-Jordan with partial pivoting otherwise. Throws if singular.
+        constexpr Matrix inverse() const {
+            static_assert(R == C, "Only square matrices have an inverse");
+
+            if constexpr (R == 3) {
+                const Matrix& m = *this;
+                Matrix adjugate = {
+                    m(1, 1) * m(2, 2) - m(1, 2) * m(2, 1), m(0, 2) * m(2, 1) - m(0, 1) * m(2, 2), m(0, 1) * m(1, 2) - m(0, 2) * m(1, 1),
+                    m(1, 2) * m(2, 0) - m(1, 0) * m(2, 2), m(0, 0) * m(2, 2) - m(0, 2) * m(2, 0), m(0, 2) * m(1, 0) - m(0, 0) * m(1, 2),
+                    m(1, 0) * m(2, 1) - m(1, 1) * m(2, 0), m(0, 1) * m(2, 0) - m(0, 0) * m(2, 1), m(0, 0) * m(1, 1) - m(0, 1) * m(1, 0) };
+
+                T determinant = m(0, 0) * adjugate(0, 0) + m(0, 1) * adjugate(1, 0) + m(0, 2) * adjugate(2, 0);
+                if (determinant == 0) {
+                    throw std::runtime_error("Error: Matrix is singular.");
+                }
+
+                adjugate *= T(1) / determinant;
+                return adjugate;
+            }
+            else {
+                Matrix m = *this;
+                Matrix result = identity();
+
+                for (int k = 0; k < R; k++) {
+                    int pivot = findPivot(m, k);
+                    if (m(pivot, k) == 0) {
+                        throw std::runtime_error("Error: Matrix is singular.");
+                    }
+                    swapRows(m, pivot, k);
+                    swapRows(result, pivot, k);
+
+                    T scale = T(1) / m(k, k);
+                    for (int j = 0; j < C; j++) {
+                        m(k, j) *= scale;
+                        result(k, j) *= scale;
+                    }
+
+                    for (int i = 0; i < R; i++) {
+                        T f = m(i, k);
+                        if (i == k || f == 0) {
+                            continue;
+                        }
+                        for (int j = 0; j < C; j++) {
+                            m(i, j) -= f * m(k, j);
+                            result(i, j) -= f * result(k, j);
+                        }
+                    }
+                }
+
+                return result;
+            }
+        }
+
+        // The lower triangular L with L L^T equal to this matrix, which must be symmetric positive
+        // definite; only the lower triangle is read. Throws otherwise.
+        Matrix cholesky() const {
+            static_assert(R == C, "Only square matrices have a Cholesky factor");
+
+            Matrix l;
+            for (int j = 0; j < R; j++) {
+                T d = (*this)(j, j);
+                for (int k = 0; k < j; k++) {
+                    d -= l(j, k) * l(j, k);
+                }
+                if (!(d > 0)) {
+                    throw std::runtime_error("Error: Matrix is not positive definite.");
+                }
+
+                T diagonal = std::sqrt(d);
+                T scale = T(1) / diagonal;
+                l(j, j) = diagonal;
+
+                for (int i = j + 1; i < R; i++) {
+                    T s = (*this)(i, j);
+                    for (int k = 0; k < j; k++) {
+                        s -= l(i, k) * l(j, k);
+                    }
+                    l(i, j) = s * scale;
+                }
+            }
+            return l;
+        }
+
+        // With this matrix the factor from cholesky(), solves (L L^T) x = b by forward and back substitution
+        template<int K>
+        constexpr Matrix<T, R, K> solveCholesky(const Matrix<T, R, K>& b) const {
+            Matrix<T, R, K> x = b;
+            const Matrix& l = *this;
+
+            for (int c = 0; c < K; c++) {
+                for (int i = 0; i < R; i++) {
+                    T s = x(i, c);
+                    for (int k = 0; k < i; k++) {
+                        s -= l(i, k) * x(k, c);
+                    }
+                    x(i, c) = s / l(i, i);
+                }
+                for (int i = R - 1; i >= 0; i--) {
+                    T s = x(i, c);
+                    for (int k = i + 1; k < R; k++) {
+                        s -= l(k, i) * x(k, c);
+                    }
+                    x(i, c) = s / l(i, i);
+                }
+            }
+            return x;
+        }
+
+    protected:
+        static constexpr int findPivot(const Matrix& m, int k) {
+            int pivot = k;
+            for (int i = k + 1; i < R; i++) {
+                if (absolute(m(i, k)) > absolute(m(pivot, k))) {
+                    pivot = i;
+                }
+            }
+            return pivot;
+        }
+
+        static constexpr void swapRows(Matrix& m, int a, int b) {
+            for (int j = 0; j < C; j++) {
+                T t = m(a, j);
+                m(a, j) = m(b, j);
+                m(b, j) = t;
+            }
+        }
+
+        // std::fabs is not constexpr
+        static constexpr T absolute(T x) { return x < 0 ? -x : x; }
+
+        T _data[R * C];
+};
+
+template<typename T, int N>
+using VectorN = Matrix<T, N, 1>;
+
+// Element-wise expressions
+template<typename A, typename B, typename T, int R, int C>
+constexpr MatrixSum<A, B, T, R, C> operator+(const MatrixExpression<A, T, R, C>& a, const MatrixExpression<B, T, R, C>& b) {
+    return MatrixSum<A, B, T, R, C>(a.self(), b.self());
+}
+
+template<typename A, typename B, typename T, int R, int C>
+constexpr MatrixDifference<A, B, T, R, C> operator-(const MatrixExpression<A, T, R, C>& a, const MatrixExpression<B, T, R, C>& b) {
+    return MatrixDifference<A, B, T, R, C>(a.self(), b.self());
+}
+
+template<typename E, typename T, int R, int C>
+constexpr MatrixNegate<E, T, R, C> operator-(const MatrixExpression<E, T, R, C>& e) {
+    return MatrixNegate<E, T, R, C>(e.self());
+}
+
+// The scalar type is taken from the expression so literals of other types convert
+template<typename E, typename T, int R, int C>
+constexpr MatrixScale<E, T, R, C> operator*(const MatrixExpression<E, T, R, C>& e, typename MatrixExpression<E, T, R, C>::value_type s) {
+    return MatrixScale<E, T, R, C>(e.self(), s);
+}
+
+template<typename E, typename T, int R, int C>
+constexpr MatrixScale<E, T, R, C> operator*(typename MatrixExpression<E, T, R, C>::value_type s, const MatrixExpression<E, T, R, C>& e) {
+    return MatrixScale<E, T, R, C>(e.self(), s);
+}
+
+template<typename E, typename T, int R, int C>
+constexpr MatrixScale<E, T, R, C> operator/(const MatrixExpression<E, T, R, C>& e, typename MatrixExpression<E, T, R, C>::value_type s) {
+    return MatrixScale<E, T, R, C>(e.self(), T(1) / s);
+}
+
+// The product by the definition, summing k in order
+template<typename T, int R, int K, int C>
+constexpr Matrix<T, R, C> multiply(const Matrix<T, R, K>& a, const Matrix<T, K, C>& b) {
+    Matrix<T, R, C> m;
+    for (int i = 0; i < R; i++) {
+        for (int j = 0; j < C; j++) {
+            T sum = a(i, 0) * b(0, j);
+            for (int k = 1; k < K; k++) {
+                sum += a(i, k) * b(k, j);
+            }
+            m(i, j) = sum;
+        }
+    }
+    return m;
+}
+
+// Products go through MatrixKernel so the sizes that matter can have their own code
+template<typename T, int R, int K, int C>
+struct MatrixKernel {
+    static constexpr Matrix<T, R, C> multiply(const Matrix<T, R, K>& a, const Matrix<T, K, C>& b) { return ::multiply(a, b); }
+};
+
+#ifdef __AVX__
+// Row i of the product is the sum over k of a(i, k) times row k of b: one broadcast, multiply
+// and add per term, in the same order as multiply(), so the results are the same unless the
+// compiler fuses the scalar loop's multiply-adds.
+template<>
+struct MatrixKernel<double, 3, 3, 3> {
+    static Matrix<double, 3, 3> multiply(const Matrix<double, 3, 3>& a, const Matrix<double, 3, 3>& b) {
+        const __m256i mask = _mm256_set_epi64x(0, -1, -1, -1);
+        const double* x = a.data();
+        const double* y = b.data();
+
+        __m256d b0 = _mm256_maskload_pd(y, mask);
+        __m256d b1 = _mm256_maskload_pd(y + 3, mask);
+        __m256d b2 = _mm256_maskload_pd(y + 6, mask);
+
+        __m256d rows[3];
+        for (int i = 0; i < 3; i++) {
+            __m256d r = _mm256_mul_pd(_mm256_broadcast_sd(x + 3 * i), b0);
+            r = _mm256_add_pd(r, _mm256_mul_pd(_mm256_broadcast_sd(x + 3 * i + 1), b1));
+            rows[i] = _mm256_add_pd(r, _mm256_mul_pd(_mm256_broadcast_sd(x + 3 * i + 2), b2));
+        }
+
+        // Each full-width store spills one element into the next row, which that row's store
+        // then overwrites; only the last needs the mask
+        Matrix<double, 3, 3> m;
+        double* z = m.data();
+        _mm256_storeu_pd(z, rows[0]);
+        _mm256_storeu_pd(z + 3, rows[1]);
+        _mm256_maskstore_pd(z + 6, mask, rows[2]);
+        return m;
+    }
+};
+
+// Rows of six as a four-wide and a two-wide register
+template<>
+struct MatrixKernel<double, 6, 6, 6> {
+    static Matrix<double, 6, 6> multiply(const Matrix<double, 6, 6>& a, const Matrix<double, 6, 6>& b) {
+        const double* x = a.data();
+        const double* y = b.data();
+
+        __m256d low[6];
+        __m128d high[6];
+        for (int k = 0; k < 6; k++) {
+            low[k] = _mm256_loadu_pd(y + 6 * k);
+            high[k] = _mm_loadu_pd(y + 6 * k + 4);
+        }
+
+        Matrix<double, 6, 6> m;
+        double* z = m.data();
+        for (int i = 0; i < 6; i++) {
+            __m256d s = _mm256_broadcast_sd(x + 6 * i);
+            __m256d l = _mm256_mul_pd(s, low[0]);
+            __m128d h = _mm_mul_pd(_mm256_castpd256_pd128(s), high[0]);
+
+            for (int k = 1; k < 6; k++) {
+                s = _mm256_broadcast_sd(x + 6 * i + k);
+                l = _mm256_add_pd(l, _mm256_mul_pd(s, low[k]));
+                h = _mm_add_pd(h, _mm_mul_pd(_mm256_castpd256_pd128(s), high[k]));
+            }
+
+            _mm256_storeu_pd(z + 6 * i, l);
+            _mm_storeu_pd(z + 6 * i + 4, h);
+        }
+        return m;
+    }
+};
+#endif
+
+template<typename T, int R, int K, int C>
+constexpr Matrix<T, R, C> operator*(const Matrix<T, R, K>& a, const Matrix<T, K, C>& b) {
+    return MatrixKernel<T, R, K, C>::multiply(a, b);
+}
+
+// Products of expressions evaluate them first
+template<typename A, typename B, typename T, int R, int K, int C>
+constexpr Matrix<T, R, C> operator*(const MatrixExpression<A, T, R, K>& a, const MatrixExpression<B, T, K, C>& b) {
+    return MatrixKernel<T, R, K, C>::multiply(Matrix<T, R, K>(a), Matrix<T, K, C>(b));
+}
+
+// A 3x3 matrix applied to a Vector3
+template<typename T>
+Vector3<T> operator*(const Matrix<T, 3, 3>& m, const Vector3<T>& v) {
+    return Vector3<T>(m(0, 0) * v.x + m(0, 1) * v.y + m(0, 2) * v.z,
+        m(1, 0) * v.x + m(1, 1) * v.y + m(1, 2) * v.z,
+        m(2, 0) * v.x + m(2, 1) * v.y + m(2, 2) * v.z);
+}
+
+// The matrix of v x, so that crossMatrix(v) * u == v.cross(u)
+template<typename T>
+Matrix<T, 3, 3> crossMatrix(const Vector3<T>& v) {
+    return Matrix<T, 3, 3>{ 0, -v.z, v.y, v.z, 0, -v.x, -v.y, v.x, 0 };
+}
+
+#endif // MATRIX_H
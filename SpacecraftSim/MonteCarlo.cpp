@@ -0,0 +1,199 @@
+#include "MonteCarlo.h"
+
+#include "Database.h"
+#include "EventDetector.h"
+#include "Parallel.h"
+#include "Pipeline.h"
+#include "Spacecraft.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+void MonteCarloResults::add(const MissionOutcome& outcome)
+{
+    samples++;
+
+    if (outcome.arrived)
+    {
+        arrivedCount++;
+        arrivalTime.add(outcome.arrivalTime);
+    }
+
+    if (outcome.landed)
+    {
+        landedCount++;
+        landingTime.add(outcome.landingTime);
+    }
+
+    missDistance.add(outcome.missDistance);
+    finalDistance.add(outcome.finalDistance);
+    maxSpeed.add(outcome.maxSpeed);
+    steps.add(outcome.steps);
+}
+
+
+MonteCarloRunner::MonteCarloRunner(Scenario* scenario) : _scenario(scenario)
+{
+    if (_scenario->getSpacecraftInitData().empty())
+    {
+        throw std::runtime_error("Error: Monte Carlo needs at least one spacecraft in the scenario.");
+    }
+
+    // The mission flies a single spacecraft, the same one runSimulation uses
+    _nominal = _scenario->getSpacecraftInitData().front();
+}
+
+
+SpacecraftInitializationData MonteCarloRunner::disperse(RandomStream& random) const
+{
+    auto data = _nominal;
+
+    // Relative dispersions are clamped so a far tail draw can never flip the sign of a parameter
+    data.mass *= std::max(0.01, random.normal(1.0, _dispersion.massSigma));
+    data.area *= std::max(0.01, random.normal(1.0, _dispersion.areaSigma));
+    data.maxVelocity *= std::max(0.01, random.normal(1.0, _dispersion.maxVelocitySigma));
+
+    return data;
+}
+
+
+MissionOutcome MonteCarloRunner::runSample(uint64_t sampleIndex) const
+{
+    auto random = makeRandomStream("montecarlo", sampleIndex);
+    auto data = disperse(random);
+
+    std::unique_ptr<Spacecraft> spacecraft(_scenario->createSpacecraft(data));
+    spacecraft->setVerbose(false);
+
+    _scenario->setupMission(spacecraft.get());
+
+    Vector3<double> startOffset(
+        random.normal(0.0, _dispersion.startPositionSigma),
+        random.normal(0.0, _dispersion.startPositionSigma),
+        random.normal(0.0, _dispersion.startPositionSigma));
+    spacecraft->setPosition(spacecraft->getPosition() + startOffset);
+
+    MissionOutcome outcome;
+
+    spacecraft->getEventDetector().registerCallback(EventType::TargetApproach, [&outcome](const SimulationEvent& event)
+    {
+        if (!outcome.arrived)
+        {
+            outcome.arrived = true;
+            outcome.arrivalTime = event.time;
+        }
+    });
+
+    auto targetName = spacecraft->getTargetPlanet().name;
+    spacecraft->getEventDetector().registerCallback(EventType::SurfaceContact, [&outcome, targetName](const SimulationEvent& event)
+    {
+        if (!outcome.landed && event.planetName == targetName)
+        {
+            outcome.landed = true;
+            outcome.landingTime = event.time;
+        }
+    });
+
+    const auto& mission = _scenario->getMission();
+    const auto& pipeline = findPipeline(mission.pipeline);
+    auto target = spacecraft->getTargetPosition();
+
+    outcome.missDistance = (spacecraft->getPosition() - target).magnitude();
+
+    while (!_scenario->equalVectors(spacecraft->getPosition(), target) && !spacecraft->isLanded() && outcome.steps < mission.maxSteps)
+    {
+        auto start = spacecraft->getPosition();
+
+        pipeline.step(*spacecraft, mission.timeStep);
+        outcome.steps++;
+
+        // Closest approach along the straight segment flown this step
+        auto end = spacecraft->getPosition();
+        auto segment = end - start;
+        double lengthSquared = segment.dot(segment);
+        double fraction = lengthSquared > 0 ? std::clamp((target - start).dot(segment) / lengthSquared, 0.0, 1.0) : 0.0;
+
+        outcome.missDistance = std::min(outcome.missDistance, (start + segment * fraction - target).magnitude());
+        outcome.maxSpeed = std::max(outcome.maxSpeed, spacecraft->getVelocity().magnitude());
+    }
+
+    outcome.finalDistance = (spacecraft->getPosition() - target).magnitude();
+
+    return outcome;
+}
+
+
+MonteCarloResults MonteCarloRunner::run(uint64_t samples, unsigned int threads)
+{
+    threads = std::max(1u, threads);
+
+    // Workers take samples in whatever order they come free, so each outcome goes to its own slot
+    // and the statistics are accumulated in sample order afterwards. The results are then the same
+    // to the bit on any number of threads.
+    std::vector<MissionOutcome> outcomes(samples);
+
+    parallelFor(samples, threads, [this, &outcomes](uint64_t i, unsigned int)
+    {
+        outcomes[i] = runSample(i);
+    });
+
+    MonteCarloResults results;
+    for (const auto& outcome : outcomes)
+    {
+        results.add(outcome);
+    }
+
+    return results;
+}
+
+
+void MonteCarloRunner::printResults(const MonteCarloResults& results) const
+{
+    std::cout << " - Monte Carlo samples = " << results.samples
+        << ", arrived = " << results.arrivedCount
+        << ", landed = " << results.landedCount << std::endl;
+
+    std::vector<std::pair<std::string, const OutcomeStatistics*>> outcomes = {
+        { "arrivalTime", &results.arrivalTime },
+        { "landingTime", &results.landingTime },
+        { "missDistance", &results.missDistance },
+        { "finalDistance", &results.finalDistance },
+        { "maxSpeed", &results.maxSpeed },
+        { "steps", &results.steps } };
+
+    std::cout << std::left << std::setw(16) << "   outcome" << std::right
+        << std::setw(14) << "mean" << std::setw(14) << "stddev" << std::setw(14) << "min"
+        << std::setw(14) << "p05" << std::setw(14) << "p50" << std::setw(14) << "p95" << std::setw(14) << "max" << std::endl;
+
+    for (const auto& kv : outcomes)
+    {
+        const auto& statistics = kv.second->getStatistics();
+
+        if (statistics.getCount() == 0)
+        {
+            continue;
+        }
+
+        std::cout << std::left << std::setw(16) << "   " + kv.first << std::right << std::setprecision(6)
+            << std::setw(14) << statistics.getMean() << std::setw(14) << statistics.getStandardDeviation()
+            << std::setw(14) << statistics.getMin() << std::setw(14) << kv.second->quantile(0.05)
+            << std::setw(14) << kv.second->quantile(0.5) << std::setw(14) << kv.second->quantile(0.95)
+            << std::setw(14) << statistics.getMax() << std::endl;
+    }
+}
+
+
+void MonteCarloRunner::logResults(const MonteCarloResults& results) const
+{
+    auto database = _scenario->getDatabase();
+
+    database->logMonteCarloSummary("arrivalTime", results.arrivalTime);
+    database->logMonteCarloSummary("landingTime", results.landingTime);
+    database->logMonteCarloSummary("missDistance", results.missDistance);
+    database->logMonteCarloSummary("finalDistance", results.finalDistance);
+    database->logMonteCarloSummary("maxSpeed", results.maxSpeed);
+    database->logMonteCarloSummary("steps", results.steps);
+}
@@ -0,0 +1,87 @@
+#ifndef MONTECARLO_H
+#define MONTECARLO_H
+
+#include "Scenario.h"
+#include "Statistics.h"
+
+#include <cstdint>
+#include <string>
+
+// 1-sigma dispersions applied around the SpacecraftInitializationData values
+struct DispersionSettings
+{
+    DispersionSettings() : massSigma(0.05), areaSigma(0.05), maxVelocitySigma(0.05), startPositionSigma(100.0) {}
+    ~DispersionSettings() {}
+
+    double massSigma;           // fraction of the nominal mass
+    double areaSigma;           // fraction of the nominal area
+    double maxVelocitySigma;    // fraction of the nominal max velocity
+    double startPositionSigma;  // distance per axis
+};
+
+// What a single run produced. Only these scalars are kept, never the trajectory.
+struct MissionOutcome
+{
+    MissionOutcome() : arrived(false), arrivalTime(0.0), landed(false), landingTime(0.0), missDistance(0.0), finalDistance(0.0), maxSpeed(0.0), steps(0) {}
+    ~MissionOutcome() {}
+
+    bool arrived;           // reached the target approach radius
+    double arrivalTime;
+    bool landed;            // touched the surface of the target planet
+    double landingTime;
+    double missDistance;    // closest distance to the target position
+    double finalDistance;
+    double maxSpeed;
+    int steps;
+};
+
+struct MonteCarloResults
+{
+    MonteCarloResults() : samples(0), arrivedCount(0), landedCount(0) {}
+    ~MonteCarloResults() {}
+
+    void add(const MissionOutcome& outcome);
+
+    uint64_t samples;
+    uint64_t arrivedCount;
+    uint64_t landedCount;
+
+    OutcomeStatistics arrivalTime;
+    OutcomeStatistics landingTime;
+    OutcomeStatistics missDistance;
+    OutcomeStatistics finalDistance;
+    OutcomeStatistics maxSpeed;
+    OutcomeStatistics steps;
+};
+
+
+// Runs the scenario's mission many times with dispersed spacecraft parameters.
+// Every sample builds its own spacecraft but shares the compiled scenario, whose systems and
+// planets are only read during a run. Samples draw from their own random stream, so sample i
+// is the same on any number of threads, and the outcomes are accumulated in sample order, so the
+// results are as well. Because the planets are shared, samples do not advance
+// them along the ephemeris: every sample flies with the planets held where they are at the start.
+class MonteCarloRunner
+{
+    public:
+        MonteCarloRunner(Scenario* scenario);
+        ~MonteCarloRunner() {}
+
+        void setDispersion(const DispersionSettings& dispersion) { _dispersion = dispersion; }
+        const DispersionSettings& getDispersion() const { return _dispersion; }
+
+        MonteCarloResults run(uint64_t samples, unsigned int threads);
+        MissionOutcome runSample(uint64_t sampleIndex) const;
+
+        void printResults(const MonteCarloResults& results) const;
+        void logResults(const MonteCarloResults& results) const;
+
+    protected:
+        SpacecraftInitializationData disperse(RandomStream& random) const;
+
+        Scenario* _scenario;
+        SpacecraftInitializationData _nominal;
+        DispersionSettings _dispersion;
+};
+
+#endif // MONTECARLO_H
@@ -0,0 +1,75 @@
+#include "OrbitalElements.h"
+
+#include <cmath>
+#include <limits>
+
+static const double TWO_PI = 2.0 * 3.14159265358979323846;
+
+// Below this eccentricity or inclination the periapsis or the node is taken as undefined
+static const double ELEMENT_EPSILON = 1e-10;
+
+static double wrapAngle(double angle)
+{
+    angle = std::fmod(angle, TWO_PI);
+    return angle < 0 ? angle + TWO_PI : angle;
+}
+
+OrbitalElements OrbitalElements::fromState(const Vector3<double>& position, const Vector3<double>& velocity, double mu)
+{
+    OrbitalElements elements;
+    elements.gravitationalParameter = mu;
+
+    const double r = position.magnitude();
+    const auto momentum = position.cross(velocity);
+    const double h = momentum.magnitude();
+
+    elements.normal = momentum / h;
+    elements.semiLatusRectum = h * h / mu;
+
+    // Eccentricity vector
+    const auto eccentricity = velocity.cross(momentum) / mu - position / r;
+    elements.eccentricity = eccentricity.magnitude();
+    elements.semiMajorAxis = 1.0 / (2.0 / r - velocity.magnitudeSquared() / mu);
+
+    elements.periapsisDirection = elements.eccentricity > ELEMENT_EPSILON ? eccentricity / elements.eccentricity : position / r;
+    elements.lateralDirection = elements.normal.cross(elements.periapsisDirection);
+
+    elements.inclination = std::acos(std::max(-1.0, std::min(1.0, elements.normal.z)));
+
+    // Line of nodes; equatorial orbits measure from the x axis
+    Vector3<double> node(-momentum.y, momentum.x, 0.0);
+    double nodeMagnitude = node.magnitude();
+    node = nodeMagnitude > ELEMENT_EPSILON * h ? node / nodeMagnitude : Vector3<double>(1, 0, 0);
+
+    elements.rightAscension = wrapAngle(std::atan2(node.y, node.x));
+    elements.argumentOfPeriapsis = wrapAngle(std::atan2(node.cross(elements.periapsisDirection).dot(elements.normal), node.dot(elements.periapsisDirection)));
+    elements.trueAnomaly = elements.getAnomalyOf(position);
+
+    return elements;
+}
+
+double OrbitalElements::getApoapsis() const
+{
+    return isClosed() ? semiLatusRectum / (1.0 - eccentricity) : std::numeric_limits<double>::infinity();
+}
+
+double OrbitalElements::getMeanMotion() const
+{
+    return std::sqrt(gravitationalParameter / (semiMajorAxis * semiMajorAxis * semiMajorAxis));
+}
+
+double OrbitalElements::getPeriod() const
+{
+    return TWO_PI / getMeanMotion();
+}
+
+double OrbitalElements::getMeanAnomaly(double anomaly) const
+{
+    double eccentricAnomaly = 2.0 * std::atan2(std::sqrt(1.0 - eccentricity) * std::sin(0.5 * anomaly), std::sqrt(1.0 + eccentricity) * std::cos(0.5 * anomaly));
+    return wrapAngle(eccentricAnomaly - eccentricity * std::sin(eccentricAnomaly));
+}
+
+double OrbitalElements::getAnomalyOf(const Vector3<double>& direction) const
+{
+    return wrapAngle(std::atan2(direction.dot(lateralDirection), direction.dot(periapsisDirection)));
+}
@@ -0,0 +1,49 @@
+#ifndef ORBITALELEMENTS_H
+#define ORBITALELEMENTS_H
+
+#include "Vector3.h"
+
+// Classical elements of a two-body orbit around a planet, from a position and velocity relative
+// to the planet's center. Angles are in radians; the reference plane is the planet's xy plane.
+struct OrbitalElements
+{
+    OrbitalElements() : semiMajorAxis(0), eccentricity(0), inclination(0), rightAscension(0), argumentOfPeriapsis(0),
+        trueAnomaly(0), semiLatusRectum(0), gravitationalParameter(0) {}
+    ~OrbitalElements() {}
+
+    static OrbitalElements fromState(const Vector3<double>& position, const Vector3<double>& velocity, double mu);
+
+    bool isClosed() const { return eccentricity < 1.0; }
+
+    double getPeriapsis() const { return semiLatusRectum / (1.0 + eccentricity); }
+    // Infinite for open orbits
+    double getApoapsis() const;
+    double getRadius(double anomaly) const { return semiLatusRectum / (1.0 + eccentricity * std::cos(anomaly)); }
+
+    // Closed orbits only
+    double getMeanMotion() const;
+    double getPeriod() const;
+
+    // Mean anomaly in [0, 2 pi) of a true anomaly, closed orbits only
+    double getMeanAnomaly(double anomaly) const;
+
+    // True anomaly where the orbit passes through a direction; the direction need not lie in the plane
+    double getAnomalyOf(const Vector3<double>& direction) const;
+
+    double semiMajorAxis;           // negative for hyperbolic orbits
+    double eccentricity;
+    double inclination;
+    double rightAscension;          // of the ascending node
+    double argumentOfPeriapsis;
+    double trueAnomaly;
+    double semiLatusRectum;
+    double gravitationalParameter;
+
+    // Orbit frame: toward periapsis, 90 degrees ahead of it, and along the angular momentum.
+    // For circular orbits periapsis is taken at the given position.
+    Vector3<double> periapsisDirection;
+    Vector3<double> lateralDirection;
+    Vector3<double> normal;
+};
+
+#endif // ORBITALELEMENTS_H
@@ -0,0 +1,283 @@
+#ifndef PID_H
+#define PID_H
+
+#include "Checkpoint.h"
+#include "Vector3.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <limits>
+#include <utility>
+
+// Gains that can be changed at run time
+template<typename T>
+class RuntimeGains
+{
+    public:
+        RuntimeGains() : _kp(T(0.1)), _ki(T(0.01)), _kd(T(0.001)) {}
+        RuntimeGains(T kp, T ki, T kd) : _kp(kp), _ki(ki), _kd(kd) {}
+
+        void setGains(T kp, T ki, T kd)
+        {
+            _kp = kp;
+            _ki = ki;
+            _kd = kd;
+        }
+
+        T kp() const { return _kp; }
+        T ki() const { return _ki; }
+        T kd() const { return _kd; }
+
+    protected:
+        T _kp, _ki, _kd;
+};
+
+// Gains fixed at compile time so they fold into the update. Values is a type with
+// static constexpr members kp, ki and kd, e.g.
+//     struct HoldGains { static constexpr double kp = 0.5, ki = 0.0, kd = 0.1; };
+template<typename Values>
+class ConstantGains
+{
+    public:
+        static constexpr double kp() { return Values::kp; }
+        static constexpr double ki() { return Values::ki; }
+        static constexpr double kd() { return Values::kd; }
+};
+
+struct DefaultGainValues
+{
+    static constexpr double kp = 0.1;
+    static constexpr double ki = 0.01;
+    static constexpr double kd = 0.001;
+};
+
+
+// Policies decide how the integral and derivative terms are formed. FILTERS says whether the
+// derivative keeps filter state, which PID<> only stores for the policies that do.
+// StandardPolicy is the plain form the controllers have always used.
+struct StandardPolicy
+{
+    enum { FILTERS = 0 };
+
+    template<typename T>
+    void integrate(T& integral, T error, T dt) const { integral += error * dt; }
+
+    template<typename T>
+    T derivative(T error, T previousError, T& /*filtered*/, T dt) const { return (error - previousError) / dt; }
+};
+
+// Clamps the integral to [-limit, limit] so a long saturation does not wind it up
+struct AntiWindupPolicy : public StandardPolicy
+{
+    AntiWindupPolicy() : limit(std::numeric_limits<double>::infinity()) {}
+    AntiWindupPolicy(double _limit) : limit(_limit) {}
+
+    template<typename T>
+    void integrate(T& integral, T error, T dt) const
+    {
+        integral = std::min(std::max(integral + error * dt, T(-limit)), T(limit));
+    }
+
+    double limit;
+};
+
+// First order low pass on the derivative term. alpha = 1 is no filtering and gives exactly the raw derivative.
+struct DerivativeFilterPolicy : public StandardPolicy
+{
+    enum { FILTERS = 1 };
+
+    DerivativeFilterPolicy() : alpha(1.0) {}
+    DerivativeFilterPolicy(double _alpha) : alpha(_alpha) {}
+
+    template<typename T>
+    T derivative(T error, T previousError, T& filtered, T dt) const
+    {
+        filtered = T(alpha) * ((error - previousError) / dt) + T(1.0 - alpha) * filtered;
+        return filtered;
+    }
+
+    double alpha;
+};
+
+// Both of the above
+struct AntiWindupFilterPolicy
+{
+    enum { FILTERS = 1 };
+
+    AntiWindupFilterPolicy() {}
+    AntiWindupFilterPolicy(double limit, double alpha) : antiWindup(limit), filter(alpha) {}
+
+    template<typename T>
+    void integrate(T& integral, T error, T dt) const { antiWindup.integrate(integral, error, dt); }
+
+    template<typename T>
+    T derivative(T error, T previousError, T& filtered, T dt) const { return filter.derivative(error, previousError, filtered, dt); }
+
+    AntiWindupPolicy antiWindup;
+    DerivativeFilterPolicy filter;
+};
+
+
+// The policy and the derivative filter state it needs, as the base of PID<> rather than members
+// of it, so a policy with no members and no filter state takes no room in the controller
+template<typename T, size_t Dim, typename Policy, bool Filters = Policy::FILTERS>
+class PIDPolicyState : protected Policy
+{
+    public:
+        PIDPolicyState() : _filtered() {}
+        PIDPolicyState(const Policy& policy) : Policy(policy), _filtered() {}
+
+    protected:
+        std::array<T, Dim> _filtered;
+};
+
+template<typename T, size_t Dim, typename Policy>
+class PIDPolicyState<T, Dim, Policy, false> : protected Policy
+{
+    public:
+        PIDPolicyState() {}
+        PIDPolicyState(const Policy& policy) : Policy(policy) {}
+};
+
+
+// Per-axis PID over Dim independent axes
+template<size_t Dim, typename T = double, typename Policy = StandardPolicy, typename Gains = RuntimeGains<T> >
+class PID : public PIDPolicyState<T, Dim, Policy>
+{
+    public:
+        typedef std::array<T, Dim> Values;
+        typedef PIDPolicyState<T, Dim, Policy> State;
+
+        PID() : _output(), _integral(), _previousError() {}
+        PID(const Policy& policy) : State(policy), _output(), _integral(), _previousError() {}
+        PID(const Policy& policy, const Gains& gains) : State(policy), _gains(gains), _output(), _integral(), _previousError() {}
+
+        void update(T dt, const Values& error)
+        {
+            // Gains, policy and error are copied into locals first. Stored to directly, the state
+            // arrays could alias any of them, which would reload every one of them on every axis.
+            const T kp = T(_gains.kp()), ki = T(_gains.ki()), kd = T(_gains.kd());
+            const Policy policy = getPolicy();
+            const Values e = error;
+
+            updateAxes(dt, e, kp, ki, kd, policy, std::make_index_sequence<Dim>());
+        }
+
+        void reset()
+        {
+            _integral = Values();
+            _previousError = Values();
+            _output = Values();
+
+            if constexpr (Policy::FILTERS)
+            {
+                this->_filtered = Values();
+            }
+        }
+
+        const Values& getOutputValues() const { return _output; }
+        const Values& getIntegral() const { return _integral; }
+        const Values& getPreviousError() const { return _previousError; }
+
+        Gains& getGains() { return _gains; }
+        const Gains& getGains() const { return _gains; }
+        Policy& getPolicy() { return *this; }
+        const Policy& getPolicy() const { return *this; }
+
+    protected:
+        // The axes written out rather than left to a loop the compiler keeps at -O2, and in phases
+        // across all of them as the hand-written controllers were, which lets the compiler pair
+        // the axes up in vector registers
+        template<size_t... Axis>
+        void updateAxes(T dt, const Values& e, T kp, T ki, T kd, const Policy& policy, std::index_sequence<Axis...>)
+        {
+            T unused = T();
+
+            Values integral = _integral;
+            (policy.integrate(integral[Axis], e[Axis], dt), ...);
+            const Values derivative = { policy.derivative(e[Axis], _previousError[Axis], filterState(Axis, unused), dt)... };
+
+            _integral = integral;
+            _output = { (e[Axis] * kp + integral[Axis] * ki + derivative[Axis] * kd)... };
+            _previousError = e;
+        }
+
+        // The filter state of an axis, or a scratch value for a policy without it
+        T& filterState(size_t axis, T& unused)
+        {
+            if constexpr (Policy::FILTERS)
+            {
+                return this->_filtered[axis];
+            }
+            else
+            {
+                return unused;
+            }
+        }
+
+        // In the order of the hand-written controllers, which the compiler pairs axes up best for
+        Gains _gains;
+        Values _output;
+        Values _integral;
+        Values _previousError;
+};
+
+
+// The three axis PID the controllers fly, with Vector3 in and out
+template<typename T = double, typename Policy = StandardPolicy, typename Gains = RuntimeGains<T> >
+class VectorPID : public PID<3, T, Policy, Gains>
+{
+    public:
+        typedef PID<3, T, Policy, Gains> Base;
+
+        VectorPID() {}
+        VectorPID(const Policy& policy) : Base(policy) {}
+
+        void update(T dt, const Vector3<T>& target, const Vector3<T>& current)
+        {
+            auto error = target - current;
+            Base::update(dt, { error.x, error.y, error.z });
+        }
+
+        Vector3<T> getOutput() const { return Vector3<T>(this->_output[0], this->_output[1], this->_output[2]); }
+
+        void setGains(T kp, T ki, T kd) { this->_gains.setGains(kp, ki, kd); }
+
+        T getKp() const { return this->_gains.kp(); }
+        T getKi() const { return this->_gains.ki(); }
+        T getKd() const { return this->_gains.kd(); }
+
+        void saveState(BinaryWriter& writer) const
+        {
+            writer.write(getKp());
+            writer.write(getKi());
+            writer.write(getKd());
+            writer.write(this->_integral);
+            writer.write(this->_previousError);
+            writer.write(this->_output);
+
+            if constexpr (Policy::FILTERS)
+            {
+                writer.write(this->_filtered);
+            }
+        }
+
+        void loadState(BinaryReader& reader)
+        {
+            T kp = reader.read<T>();
+            T ki = reader.read<T>();
+            T kd = reader.read<T>();
+            setGains(kp, ki, kd);
+            reader.read(this->_integral);
+            reader.read(this->_previousError);
+            reader.read(this->_output);
+
+            if constexpr (Policy::FILTERS)
+            {
+                reader.read(this->_filtered);
+            }
+        }
+};
+
+#endif // PID_H
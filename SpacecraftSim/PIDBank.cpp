@@ -0,0 +1,113 @@
+#include "PIDBank.h"
+
+#include <algorithm>
+#include <limits>
+
+PIDBank::PIDBank() : _clamped(false), _filteredChannels(false)
+{
+}
+
+size_t PIDBank::add(double kp, double ki, double kd)
+{
+    _kp.push_back(kp);
+    _ki.push_back(ki);
+    _kd.push_back(kd);
+    _integralLimit.push_back(std::numeric_limits<double>::infinity());
+    _alpha.push_back(1.0);
+
+    _integral.push_back(0.0);
+    _previousError.push_back(0.0);
+    _filtered.push_back(0.0);
+    _output.push_back(0.0);
+
+    return _kp.size() - 1;
+}
+
+void PIDBank::setGains(size_t channel, double kp, double ki, double kd)
+{
+    _kp[channel] = kp;
+    _ki[channel] = ki;
+    _kd[channel] = kd;
+}
+
+void PIDBank::setIntegralLimit(size_t channel, double limit)
+{
+    _integralLimit[channel] = limit;
+    _clamped = _clamped || limit != std::numeric_limits<double>::infinity();
+}
+
+void PIDBank::setDerivativeFilter(size_t channel, double alpha)
+{
+    _alpha[channel] = alpha;
+    _filteredChannels = _filteredChannels || alpha != 1.0;
+}
+
+void PIDBank::reset()
+{
+    std::fill(_integral.begin(), _integral.end(), 0.0);
+    std::fill(_previousError.begin(), _previousError.end(), 0.0);
+    std::fill(_filtered.begin(), _filtered.end(), 0.0);
+    std::fill(_output.begin(), _output.end(), 0.0);
+}
+
+// One channel, in the same operations and order as PID<> with AntiWindupFilterPolicy
+template<bool Clamp, bool Filter>
+static inline void updateChannel(double e, double dt, double kp, double ki, double kd, double limit, double alpha,
+    double& integral, double previousError, double& filtered, double& output)
+{
+    double in = integral + e * dt;
+    if (Clamp)
+    {
+        in = std::min(std::max(in, -limit), limit);
+    }
+    integral = in;
+
+    double d = (e - previousError) / dt;
+    if (Filter)
+    {
+        d = alpha * d + (1.0 - alpha) * filtered;
+        filtered = d;
+    }
+
+    output = e * kp + in * ki + d * kd;
+}
+
+// The update over every channel. The clamp and filter passes are compiled out when no channel
+// uses them, which saves two of the nine array streams in the common case. Channels go through
+// in runs of a fixed length: with the arrays restrict and the trip count known, the loop over a
+// run vectorizes at -O2 with whatever vector width the target has, with no alias checks for the
+// compiler to weigh. The channels short of a run are done one by one.
+template<bool Clamp, bool Filter>
+static void updateChannels(size_t count, double dt, const double* __restrict error,
+    const double* __restrict kp, const double* __restrict ki, const double* __restrict kd,
+    const double* __restrict limit, const double* __restrict alpha,
+    double* __restrict integral, double* __restrict previousError, double* __restrict filtered, double* __restrict output)
+{
+    const size_t RUN = 16;
+
+    size_t run = 0;
+    for (; run + RUN <= count; run += RUN)
+    {
+        for (size_t i = run; i < run + RUN; i++)
+        {
+            updateChannel<Clamp, Filter>(error[i], dt, kp[i], ki[i], kd[i], Clamp ? limit[i] : 0.0, Filter ? alpha[i] : 1.0,
+                integral[i], previousError[i], filtered[i], output[i]);
+            previousError[i] = error[i];
+        }
+    }
+
+    for (size_t i = run; i < count; i++)
+    {
+        updateChannel<Clamp, Filter>(error[i], dt, kp[i], ki[i], kd[i], limit[i], alpha[i], integral[i], previousError[i], filtered[i], output[i]);
+        previousError[i] = error[i];
+    }
+}
+
+void PIDBank::update(double dt, const double* error)
+{
+    auto kernel = _clamped ? (_filteredChannels ? &updateChannels<true, true> : &updateChannels<true, false>)
+        : (_filteredChannels ? &updateChannels<false, true> : &updateChannels<false, false>);
+
+    kernel(size(), dt, error, _kp.data(), _ki.data(), _kd.data(), _integralLimit.data(), _alpha.data(),
+        _integral.data(), _previousError.data(), _filtered.data(), _output.data());
+}
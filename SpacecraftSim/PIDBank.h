@@ -0,0 +1,50 @@
+#ifndef PIDBANK_H
+#define PIDBANK_H
+
+#include <cstddef>
+#include <vector>
+
+// Many independent scalar PID channels kept as structure of arrays, so one update is a
+// straight pass over contiguous memory that vectorizes. A three axis controller takes three
+// channels. Every channel has the anti-windup clamp and derivative filter of
+// AntiWindupFilterPolicy; with the defaults (no limit, alpha = 1) it computes the StandardPolicy result.
+class PIDBank
+{
+    public:
+        PIDBank();
+        ~PIDBank() {}
+
+        // Adds a channel and returns its index
+        size_t add(double kp, double ki, double kd);
+
+        void setGains(size_t channel, double kp, double ki, double kd);
+        void setIntegralLimit(size_t channel, double limit);
+        void setDerivativeFilter(size_t channel, double alpha);
+
+        // error holds one value per channel. Outputs are written to getOutputs().
+        void update(double dt, const double* error);
+
+        void reset();
+
+        size_t size() const { return _kp.size(); }
+        const double* getOutputs() const { return _output.data(); }
+        double getOutput(size_t channel) const { return _output[channel]; }
+
+    protected:
+        std::vector<double> _kp;
+        std::vector<double> _ki;
+        std::vector<double> _kd;
+        std::vector<double> _integralLimit;
+        std::vector<double> _alpha;
+
+        std::vector<double> _integral;
+        std::vector<double> _previousError;
+        std::vector<double> _filtered;
+        std::vector<double> _output;
+
+        // Set once any channel has a finite limit or a filter, picking the update that handles them
+        bool _clamped;
+        bool _filteredChannels;
+};
+
+#endif // PIDBANK_H
@@ -0,0 +1,323 @@
+#include "PIDTuner.h"
+
+#include "Database.h"
+#include "EventDetector.h"
+#include "Parallel.h"
+#include "Pipeline.h"
+#include "Spacecraft.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+
+PIDTuner::PIDTuner(Scenario* scenario) : _scenario(scenario)
+{
+    if (_scenario->getSpacecraftInitData().empty())
+    {
+        throw std::runtime_error("Error: PID tuning needs at least one spacecraft in the scenario.");
+    }
+
+    _nominal = _scenario->getSpacecraftInitData().front();
+}
+
+
+TuningScore PIDTuner::evaluate(const TuningCandidate& candidate) const
+{
+    std::unique_ptr<Spacecraft> spacecraft(_scenario->createSpacecraft(_nominal));
+    spacecraft->setVerbose(false);
+
+    _scenario->setupMission(spacecraft.get());
+
+    spacecraft->setPositionPID(candidate.position.kp, candidate.position.ki, candidate.position.kd);
+    spacecraft->setVelocityPID(candidate.velocity.kp, candidate.velocity.ki, candidate.velocity.kd);
+
+    TuningScore score;
+
+    spacecraft->getEventDetector().registerCallback(EventType::TargetApproach, [&score](const SimulationEvent& event)
+    {
+        if (!score.reached)
+        {
+            score.reached = true;
+            score.timeToTarget = event.time;
+        }
+    });
+
+    const auto& mission = _scenario->getMission();
+    auto target = spacecraft->getTargetPosition();
+
+    double startDistance = std::max((spacecraft->getPosition() - target).magnitude(), 1.0);
+    double closest = startDistance;
+
+    while (!_scenario->equalVectors(spacecraft->getPosition(), target) && !spacecraft->isLanded() && score.steps < mission.maxSteps)
+    {
+        // Always the full chain: the gains being scored only matter with guidance and control on
+        StandardPipeline::step(*spacecraft, mission.timeStep);
+        score.steps++;
+
+        double distance = (spacecraft->getPosition() - target).magnitude();
+        score.controlEffort += spacecraft->getVelocityController().getOutput().magnitude() * mission.timeStep;
+
+        // Overshoot is how far the spacecraft flies back out after its closest approach so far
+        if (score.reached)
+        {
+            closest = std::min(closest, distance);
+            score.overshoot = std::max(score.overshoot, distance - closest);
+        }
+
+        // Stop runs that are clearly running away instead of paying for the full mission
+        if (!std::isfinite(distance) || distance > _weights.divergenceFactor * startDistance)
+        {
+            score.diverged = true;
+            break;
+        }
+    }
+
+    double missionTime = mission.maxSteps * mission.timeStep;
+
+    if (!score.reached)
+    {
+        score.timeToTarget = missionTime;
+    }
+
+    score.cost = _weights.time * score.timeToTarget / missionTime
+        + _weights.overshoot * score.overshoot / startDistance
+        + _weights.effort * score.controlEffort / startDistance;
+
+    if (!score.reached || score.diverged || !std::isfinite(score.cost))
+    {
+        score.cost = (std::isfinite(score.cost) ? score.cost : 0.0) + _weights.missPenalty;
+    }
+
+    return score;
+}
+
+
+std::vector<TuningScore> PIDTuner::evaluateAll(const std::vector<TuningCandidate>& candidates, unsigned int threads) const
+{
+    std::vector<TuningScore> scores(candidates.size());
+
+    parallelFor(candidates.size(), threads, [this, &candidates, &scores](uint64_t i, unsigned int)
+    {
+        scores[i] = evaluate(candidates[i]);
+    });
+
+    return scores;
+}
+
+
+std::vector<TuningResult> PIDTuner::gridSearch(const std::vector<double>& positionKp, const std::vector<double>& positionKi, const std::vector<double>& positionKd,
+    const std::vector<double>& velocityKp, const std::vector<double>& velocityKi, const std::vector<double>& velocityKd, unsigned int threads) const
+{
+    std::vector<TuningCandidate> candidates;
+
+    for (double pkp : positionKp)
+        for (double pki : positionKi)
+            for (double pkd : positionKd)
+                for (double vkp : velocityKp)
+                    for (double vki : velocityKi)
+                        for (double vkd : velocityKd)
+                        {
+                            candidates.push_back(TuningCandidate(PIDGains(pkp, pki, pkd), PIDGains(vkp, vki, vkd)));
+                        }
+
+    auto scores = evaluateAll(candidates, threads);
+
+    std::vector<TuningResult> results(candidates.size());
+    for (size_t i = 0; i < candidates.size(); i++)
+    {
+        results[i].candidate = candidates[i];
+        results[i].score = scores[i];
+    }
+
+    std::stable_sort(results.begin(), results.end(), [](const TuningResult& a, const TuningResult& b) { return a.score.cost < b.score.cost; });
+
+    return results;
+}
+
+
+// The simplex lives in log space so every gain stays positive and steps scale with the gain
+typedef std::array<double, 6> GainVector;
+
+static GainVector toGainVector(const TuningCandidate& candidate)
+{
+    return { log(candidate.position.kp), log(candidate.position.ki), log(candidate.position.kd),
+        log(candidate.velocity.kp), log(candidate.velocity.ki), log(candidate.velocity.kd) };
+}
+
+static TuningCandidate toCandidate(const GainVector& x)
+{
+    return TuningCandidate(PIDGains(exp(x[0]), exp(x[1]), exp(x[2])), PIDGains(exp(x[3]), exp(x[4]), exp(x[5])));
+}
+
+// a + t * (b - a)
+static GainVector lerp(const GainVector& a, const GainVector& b, double t)
+{
+    GainVector result;
+    for (size_t i = 0; i < result.size(); i++)
+    {
+        result[i] = a[i] + t * (b[i] - a[i]);
+    }
+    return result;
+}
+
+
+TuningResult PIDTuner::nelderMead(const TuningCandidate& start, int iterations, unsigned int threads) const
+{
+    const size_t n = 6;
+
+    // Initial simplex: the start point plus one vertex per gain, scaled up by a factor of two
+    std::vector<GainVector> simplex(n + 1, toGainVector(start));
+    for (size_t i = 0; i < n; i++)
+    {
+        simplex[i + 1][i] += log(2.0);
+    }
+
+    std::vector<TuningCandidate> candidates;
+    for (const auto& vertex : simplex)
+    {
+        candidates.push_back(toCandidate(vertex));
+    }
+
+    auto scores = evaluateAll(candidates, threads);
+
+    for (int iteration = 0; iteration < iterations; iteration++)
+    {
+        // Order the vertices best to worst
+        std::vector<size_t> order(n + 1);
+        for (size_t i = 0; i <= n; i++)
+        {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(), [&scores](size_t a, size_t b) { return scores[a].cost < scores[b].cost; });
+
+        size_t best = order[0];
+        size_t worst = order[n];
+        size_t secondWorst = order[n - 1];
+
+        GainVector centroid = {};
+        for (size_t i = 0; i < n; i++)
+        {
+            for (size_t k = 0; k < n; k++)
+            {
+                centroid[k] += simplex[order[i]][k] / n;
+            }
+        }
+
+        // Reflection, expansion and both contractions are evaluated together so the step costs one parallel batch
+        std::vector<GainVector> trial = {
+            lerp(centroid, simplex[worst], -1.0),
+            lerp(centroid, simplex[worst], -2.0),
+            lerp(centroid, simplex[worst], -0.5),
+            lerp(centroid, simplex[worst], 0.5) };
+
+        std::vector<TuningCandidate> trialCandidates;
+        for (const auto& vertex : trial)
+        {
+            trialCandidates.push_back(toCandidate(vertex));
+        }
+
+        auto trialScores = evaluateAll(trialCandidates, threads);
+
+        const auto& reflected = trialScores[0];
+        const auto& expanded = trialScores[1];
+        const auto& outside = trialScores[2];
+        const auto& inside = trialScores[3];
+
+        int accepted = -1;
+
+        if (reflected.cost < scores[best].cost)
+        {
+            accepted = expanded.cost < reflected.cost ? 1 : 0;
+        }
+        else if (reflected.cost < scores[secondWorst].cost)
+        {
+            accepted = 0;
+        }
+        else if (reflected.cost < scores[worst].cost)
+        {
+            accepted = outside.cost <= reflected.cost ? 2 : -1;
+        }
+        else
+        {
+            accepted = inside.cost < scores[worst].cost ? 3 : -1;
+        }
+
+        if (accepted >= 0)
+        {
+            simplex[worst] = trial[accepted];
+            scores[worst] = trialScores[accepted];
+            continue;
+        }
+
+        // Shrink every vertex towards the best one
+        std::vector<size_t> shrunk;
+        candidates.clear();
+
+        for (size_t i = 0; i <= n; i++)
+        {
+            if (i == best)
+            {
+                continue;
+            }
+
+            simplex[i] = lerp(simplex[best], simplex[i], 0.5);
+            candidates.push_back(toCandidate(simplex[i]));
+            shrunk.push_back(i);
+        }
+
+        auto shrunkScores = evaluateAll(candidates, threads);
+        for (size_t i = 0; i < shrunk.size(); i++)
+        {
+            scores[shrunk[i]] = shrunkScores[i];
+        }
+    }
+
+    size_t best = 0;
+    for (size_t i = 1; i <= n; i++)
+    {
+        if (scores[i].cost < scores[best].cost)
+        {
+            best = i;
+        }
+    }
+
+    TuningResult result;
+    result.candidate = toCandidate(simplex[best]);
+    result.score = scores[best];
+    return result;
+}
+
+
+void PIDTuner::printResults(const std::vector<TuningResult>& results, size_t count) const
+{
+    std::cout << std::left << std::setw(6) << "   #" << std::right
+        << std::setw(11) << "pos kp" << std::setw(11) << "pos ki" << std::setw(11) << "pos kd"
+        << std::setw(11) << "vel kp" << std::setw(11) << "vel ki" << std::setw(11) << "vel kd"
+        << std::setw(12) << "time" << std::setw(12) << "overshoot" << std::setw(12) << "effort" << std::setw(12) << "cost" << std::endl;
+
+    for (size_t i = 0; i < std::min(count, results.size()); i++)
+    {
+        const auto& c = results[i].candidate;
+        const auto& s = results[i].score;
+
+        std::cout << std::left << std::setw(6) << "   " + std::to_string(i + 1) << std::right << std::setprecision(4)
+            << std::setw(11) << c.position.kp << std::setw(11) << c.position.ki << std::setw(11) << c.position.kd
+            << std::setw(11) << c.velocity.kp << std::setw(11) << c.velocity.ki << std::setw(11) << c.velocity.kd
+            << std::setw(12) << s.timeToTarget << std::setw(12) << s.overshoot << std::setw(12) << s.controlEffort
+            << std::setw(12) << s.cost << (s.diverged ? "  diverged" : "") << std::endl;
+    }
+}
+
+
+void PIDTuner::logResults(const std::vector<TuningResult>& results) const
+{
+    auto database = _scenario->getDatabase();
+
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        database->logTuningResult(static_cast<int>(i + 1), results[i]);
+    }
+}
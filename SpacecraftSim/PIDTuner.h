@@ -0,0 +1,97 @@
+#ifndef PIDTUNER_H
+#define PIDTUNER_H
+
+#include "Scenario.h"
+
+#include <string>
+#include <vector>
+
+struct PIDGains
+{
+    PIDGains() : kp(0.1), ki(0.01), kd(0.001) {}
+    PIDGains(double _kp, double _ki, double _kd) : kp(_kp), ki(_ki), kd(_kd) {}
+    ~PIDGains() {}
+
+    double kp;
+    double ki;
+    double kd;
+};
+
+// Gains for the position and velocity loops that runSimulation flies
+struct TuningCandidate
+{
+    TuningCandidate() {}
+    TuningCandidate(PIDGains _position, PIDGains _velocity) : position(_position), velocity(_velocity) {}
+    ~TuningCandidate() {}
+
+    PIDGains position;
+    PIDGains velocity;
+};
+
+struct TuningScore
+{
+    TuningScore() : reached(false), diverged(false), timeToTarget(0.0), overshoot(0.0), controlEffort(0.0), cost(0.0), steps(0) {}
+    ~TuningScore() {}
+
+    bool reached;           // entered the target approach radius
+    bool diverged;          // stopped early because the run was running away
+    double timeToTarget;    // time of the first target approach, or the full mission time if never reached
+    double overshoot;       // furthest distance from the target after the first approach
+    double controlEffort;   // integral of the commanded acceleration magnitude
+    double cost;
+    int steps;
+};
+
+// Cost = time * timeToTarget / missionTime + overshoot * overshoot / startDistance + effort * controlEffort / startDistance
+struct TuningWeights
+{
+    TuningWeights() : time(1.0), overshoot(1.0), effort(0.01), missPenalty(10.0), divergenceFactor(3.0) {}
+    ~TuningWeights() {}
+
+    double time;
+    double overshoot;
+    double effort;
+    double missPenalty;         // added when the target is never reached or the run diverges
+    double divergenceFactor;    // distance to target, as a multiple of the start distance, that ends a run early
+};
+
+struct TuningResult
+{
+    TuningCandidate candidate;
+    TuningScore score;
+};
+
+
+// Scores PID gain candidates by flying the scenario's mission with a fresh spacecraft per candidate.
+// Candidates share the compiled scenario and run in parallel.
+class PIDTuner
+{
+    public:
+        PIDTuner(Scenario* scenario);
+        ~PIDTuner() {}
+
+        void setWeights(const TuningWeights& weights) { _weights = weights; }
+        const TuningWeights& getWeights() const { return _weights; }
+
+        TuningScore evaluate(const TuningCandidate& candidate) const;
+
+        // Every combination of the given values. Results are sorted by cost, best first.
+        std::vector<TuningResult> gridSearch(const std::vector<double>& positionKp, const std::vector<double>& positionKi, const std::vector<double>& positionKd,
+            const std::vector<double>& velocityKp, const std::vector<double>& velocityKi, const std::vector<double>& velocityKd, unsigned int threads) const;
+
+        // Derivative-free Nelder-Mead search over the six gains in log space.
+        // The vertices of the simplex are evaluated in parallel whenever more than one is needed.
+        TuningResult nelderMead(const TuningCandidate& start, int iterations, unsigned int threads) const;
+
+        void printResults(const std::vector<TuningResult>& results, size_t count) const;
+        void logResults(const std::vector<TuningResult>& results) const;
+
+    protected:
+        std::vector<TuningScore> evaluateAll(const std::vector<TuningCandidate>& candidates, unsigned int threads) const;
+
+        Scenario* _scenario;
+        SpacecraftInitializationData _nominal;
+        TuningWeights _weights;
+};
+
+#endif // PIDTUNER_H
@@ -0,0 +1,54 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// Calls fn(index, worker) for every index in [0, count) on up to `threads` worker threads.
+// Workers pull indices from a shared counter, so long and short items balance out.
+// `worker` is in [0, threads) and lets callers keep per-worker accumulators without locking.
+template<typename Function>
+void parallelFor(uint64_t count, unsigned int threads, Function fn)
+{
+    threads = std::max(1u, threads);
+    threads = static_cast<unsigned int>(std::min<uint64_t>(threads, std::max<uint64_t>(count, 1)));
+
+    if (threads == 1)
+    {
+        for (uint64_t i = 0; i < count; i++)
+        {
+            fn(i, 0u);
+        }
+        return;
+    }
+
+    std::atomic<uint64_t> next(0);
+    std::vector<std::thread> workers;
+
+    for (unsigned int w = 0; w < threads; w++)
+    {
+        workers.emplace_back([&next, &fn, count, w]()
+        {
+            for (uint64_t i = next++; i < count; i = next++)
+            {
+                fn(i, w);
+            }
+        });
+    }
+
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+// Number of threads to use when the caller did not ask for a specific count
+inline unsigned int defaultThreadCount()
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+#endif // PARALLEL_H
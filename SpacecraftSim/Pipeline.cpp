@@ -0,0 +1,44 @@
+#include "Pipeline.h"
+
+#include <stdexcept>
+
+static const std::vector<PipelineDefinition>& getPipelines()
+{
+    static const std::vector<PipelineDefinition> pipelines = {
+        // Guidance, PID chain and event handling
+        makePipelineDefinition<StandardPipeline>("standard"),
+
+        // PID chain without guidance; the orientation is never updated
+        makePipelineDefinition<StepPipeline<NoGuidance, CascadeControl, EventIntegrator> >("open-loop"),
+
+        // Unpowered drift at the current velocity
+        makePipelineDefinition<StepPipeline<NoGuidance, NoControl, EventIntegrator> >("coast"),
+    };
+
+    return pipelines;
+}
+
+const PipelineDefinition& findPipeline(const std::string& name)
+{
+    for (const auto& pipeline : getPipelines())
+    {
+        if (pipeline.name == name)
+        {
+            return pipeline;
+        }
+    }
+
+    throw std::runtime_error("Error: Unknown pipeline " + name);
+}
+
+std::vector<std::string> getPipelineNames()
+{
+    std::vector<std::string> names;
+
+    for (const auto& pipeline : getPipelines())
+    {
+        names.push_back(pipeline.name);
+    }
+
+    return names;
+}
@@ -0,0 +1,92 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "Scheduler.h"
+#include "Spacecraft.h"
+
+#include <string>
+#include <vector>
+
+// Stages of one spacecraft step. Each stage is a type with a static run(spacecraft, dt), so a
+// pipeline is a combination of stages fixed at compile time. This is for composing steps; a step
+// costs the same as ControlSystem::update, since the stages' own work dwarfs any dispatch.
+
+// Guidance: target checks and orientation
+struct TargetGuidance
+{
+    static void run(Spacecraft& spacecraft, double) { spacecraft.updateGNC(); }
+};
+
+struct NoGuidance
+{
+    static void run(Spacecraft&, double) {}
+};
+
+// Control: position and velocity PID chain setting the commanded velocity
+struct CascadeControl
+{
+    static void run(Spacecraft& spacecraft, double dt) { spacecraft.updateControllers(dt); }
+};
+
+// Keeps the last commanded velocity
+struct NoControl
+{
+    static void run(Spacecraft&, double) {}
+};
+
+// Integration: advance the state and handle the events crossed during the step
+struct EventIntegrator
+{
+    static void run(Spacecraft& spacecraft, double dt) { spacecraft.integrate(dt); }
+};
+
+
+template<typename Guidance, typename Control, typename Integrator>
+class StepPipeline
+{
+    public:
+        static void step(Spacecraft& spacecraft, double dt)
+        {
+            Guidance::run(spacecraft, dt);
+            Control::run(spacecraft, dt);
+            Integrator::run(spacecraft, dt);
+        }
+
+        // Adds the stages to a scheduler at their own periods. Each scheduled function calls its
+        // stage type directly, so the stage is compiled into it.
+        static void schedule(Scheduler& scheduler, Spacecraft* spacecraft, double guidancePeriod, double controlPeriod, double dynamicsPeriod)
+        {
+            scheduler.addStage("guidance", guidancePeriod, [spacecraft](double, double dt) { Guidance::run(*spacecraft, dt); });
+            scheduler.addStage("control", controlPeriod, [spacecraft](double, double dt) { Control::run(*spacecraft, dt); });
+            scheduler.addStage("dynamics", dynamicsPeriod, [spacecraft](double, double dt) { Integrator::run(*spacecraft, dt); });
+        }
+};
+
+// What ControlSystem::update does
+typedef StepPipeline<TargetGuidance, CascadeControl, EventIntegrator> StandardPipeline;
+
+
+// Runtime selection for scenario driven runs. Each entry points at the functions of one
+// StepPipeline instantiation; the name is looked up once, before the run.
+typedef void (*PipelineFunction)(Spacecraft& spacecraft, double dt);
+typedef void (*PipelineSchedule)(Scheduler& scheduler, Spacecraft* spacecraft, double guidancePeriod, double controlPeriod, double dynamicsPeriod);
+
+struct PipelineDefinition
+{
+    std::string name;
+    PipelineFunction step;
+    PipelineSchedule schedule;
+};
+
+template<typename Pipeline>
+PipelineDefinition makePipelineDefinition(const std::string& name)
+{
+    return { name, &Pipeline::step, &Pipeline::schedule };
+}
+
+// Throws if there is no pipeline with that name
+const PipelineDefinition& findPipeline(const std::string& name);
+
+std::vector<std::string> getPipelineNames();
+
+#endif // PIPELINE_H
@@ -1,10 +1,20 @@
 #include "Planet.h"
 #include "random_gen.h"
 
-Planet::Planet() {}
+#include <limits>
+
+// International Standard Atmosphere (ISA) troposphere
+static const double ISA_SEA_LEVEL_TEMPERATURE = 288.15;
+static const double ISA_SEA_LEVEL_PRESSURE = 101325.0;
+static const double ISA_LAPSE_RATE = -0.0065;
+static const double ISA_GRAVITY = 9.80665;
+static const double ISA_GAS_CONSTANT = 287.05;
+
+Planet::Planet() : _sphereOfInfluence(std::numeric_limits<double>::infinity()) {}
 
 Planet::Planet(std::string systemName, std::string name, double radius, double mass, Vector3<double> centerPosition)
-        : _systemName(systemName), _name(name), _radius(radius), _mass(mass), _centerPosition(centerPosition), _surfacePosition(calcSurfacePosition(radius))
+        : _systemName(systemName), _name(name), _radius(radius), _mass(mass), _centerPosition(centerPosition), _surfacePosition(calcSurfacePosition(radius)),
+        _sphereOfInfluence(std::numeric_limits<double>::infinity())
 {
     _dragCoefficient = 2;
     _airTemperature = 70;
@@ -22,37 +32,29 @@ Vector3<double> Planet::getGravitationalForce(double altitude, Vector3<double> p
 double Planet::getMaxDragForce(double scArea, double scMaxVelocity, double altitude)
 {
     auto cross = calcCrossSectionalArea(scArea);
-    return 0.5 * calcAirDensity(altitude) * _dragCoefficient * cross * scMaxVelocity * scMaxVelocity;
+    return 0.5 * getAirDensity(altitude) * _dragCoefficient * cross * scMaxVelocity * scMaxVelocity;
 }
 
 Vector3<double> Planet::getAirResistance(Vector3<double> velocity, double altitude, double area)
 {
-    double rho = calcAirDensity(altitude);
-    double v = velocity.magnitude();
+    double rho = getAirDensity(altitude);
+    double v;
+    auto direction = velocity.normalizeAndMagnitude(v);
     double Cd = calcDragCoefficient(v);
     double A = calcCrossSectionalArea(area);
 
     // Calculate air resistance using the following formula
     // F_drag = 0.5 * rho * v^2 * Cd * A
     double airResistance = 0.5 * rho * v * v * Cd * A;
-    auto result = velocity.normalize() * (-airResistance);
+    auto result = direction * (-airResistance);
     return result;
 }
 
 // atmospheric model formula to calculate air density based on altitude
-double Planet::calcAirDensity(double altitude)
+double Planet::calcAirDensity(double altitude) const
 {
-    // Uses Interational Standard Atmosphere (ISA) model
-    double T0 = 288.15;
-    double p0 = 101325.0;
-    double L = -0.0065;
-    double g = 9.80665;
-    double R = 287.05;
-
-    double T = T0 + L * altitude;
-    double p = p0 * pow(T / T0, -g / (R * L));
-
-    double result = p / (R * T);
+    double T = calcAirTemperature(altitude);
+    double result = T > 0 ? calcAirPressure(altitude) / (ISA_GAS_CONSTANT * T) : 0.0;
 
     if (std::isnan(result))
     {
@@ -62,6 +64,36 @@ double Planet::calcAirDensity(double altitude)
     return result;
 }
 
+double Planet::calcAirTemperature(double altitude) const
+{
+    return ISA_SEA_LEVEL_TEMPERATURE + ISA_LAPSE_RATE * altitude;
+}
+
+double Planet::calcAirPressure(double altitude) const
+{
+    double T = calcAirTemperature(altitude);
+
+    if (!(T > 0))
+    {
+        return 0;
+    }
+
+    return ISA_SEA_LEVEL_PRESSURE * pow(T / ISA_SEA_LEVEL_TEMPERATURE, -ISA_GRAVITY / (ISA_GAS_CONSTANT * ISA_LAPSE_RATE));
+}
+
+double Planet::getAtmosphereCeiling()
+{
+    return -ISA_SEA_LEVEL_TEMPERATURE / ISA_LAPSE_RATE;
+}
+
+void Planet::buildAtmosphereTable(double resolution)
+{
+    _atmosphereTable.build([this](double altitude)
+    {
+        return AtmosphereSample(calcAirDensity(altitude), calcAirTemperature(altitude), calcAirPressure(altitude));
+    }, 0.0, getAtmosphereCeiling(), resolution);
+}
+
 // formula to calculate drag coefficient based on velocity
 double Planet::calcDragCoefficient(double velocity)
 {
@@ -79,13 +111,14 @@ double Planet::calcCrossSectionalArea(double area)
 
 Vector3<double> Planet::calcSurfacePosition(double radius)
 {
+    // Each planet draws from its own stream so the result does not depend on construction order
+    auto random = makeRandomStream("planet", _systemName + "/" + _name);
+
     // Generate random theta (0 to 2 * pi)
-    std::uniform_real_distribution<double> thetaDist(0, 2 * PI_SHORT);
-    double theta = thetaDist(random_gen);
+    double theta = random.uniform(0, 2 * PI_SHORT);
 
     // Generate random phi (0 to pi)
-    std::uniform_real_distribution<double> phiDist(0, PI_SHORT);
-    double phi = phiDist(random_gen);
+    double phi = random.uniform(0, PI_SHORT);
 
     // Calculate x, y, and z coordinates
     double x = radius * sin(phi) * cos(theta);
@@ -100,10 +133,36 @@ Vector3<double> Planet::getLimitedAirResistance(Vector3<double> velocity, double
 {
     auto airRes = getAirResistance(velocity, altitude, area);
 
-    if (airRes.magnitude() > maxAirResistance)
+    double magnitude;
+    auto direction = airRes.normalizeAndMagnitude(magnitude);
+
+    if (magnitude > maxAirResistance)
     {
-        return airRes.normalize() * maxAirResistance;
+        return direction * maxAirResistance;
     }
     return airRes;
 }
 
+void Planet::saveState(BinaryWriter& writer) const
+{
+    writer.write(_centerPosition);
+    writer.write(_surfacePosition);
+    writer.write(_radius);
+    writer.write(_mass);
+    writer.write(_gravitationalParameter);
+    writer.write(_dragCoefficient);
+    writer.write(_airTemperature);
+    writer.write(_atmosphereRadius);
+}
+
+void Planet::loadState(BinaryReader& reader)
+{
+    reader.read(_centerPosition);
+    reader.read(_surfacePosition);
+    reader.read(_radius);
+    reader.read(_mass);
+    reader.read(_gravitationalParameter);
+    reader.read(_dragCoefficient);
+    reader.read(_airTemperature);
+    reader.read(_atmosphereRadius);
+}
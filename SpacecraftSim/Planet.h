@@ -1,6 +1,9 @@
 #ifndef PLANET_H
 #define PLANET_H
 
+#include "AtmosphereTable.h"
+#include "Checkpoint.h"
+#include "GravityField.h"
 #include "Vector3.h"
 
 #include <cmath>
@@ -22,10 +25,15 @@ class Planet
         double getRadius() const { return _radius; }
         double getMass() const { return _mass; }
         Vector3<double> getCenterPosition() const { return _centerPosition; }
+        Vector3<double> getCenterVelocity() const { return _centerVelocity; }
         Vector3<double> getSurfacePosition() const { return _surfacePosition; }
 
-        // Environment calc methods
-        double calcAirDensity(double altitude);
+        // Environment calc methods. The air model is the ISA troposphere, which ends at
+        // getAtmosphereCeiling() where the temperature reaches zero.
+        double calcAirDensity(double altitude) const;
+        double calcAirTemperature(double altitude) const;
+        double calcAirPressure(double altitude) const;
+        static double getAtmosphereCeiling();
         double calcDragCoefficient(double velocity);
         double calcCrossSectionalArea(double area);
 
@@ -45,23 +53,49 @@ class Planet
         Vector3<double> getLimitedAirResistance(Vector3<double> velocity, double altitude, double area, double maxAirResistance);
         // TODO: add max air resistance to input file
 
+        // Air density from the lookup table once it is built, from the analytic model before
+        double getAirDensity(double altitude) const { return _atmosphereTable.isBuilt() ? _atmosphereTable.getDensity(altitude) : calcAirDensity(altitude); }
+
+        // Tabulates the air model from the surface to the ceiling every `resolution` metres
+        void buildAtmosphereTable(double resolution);
+        const AtmosphereTable& getAtmosphereTable() const { return _atmosphereTable; }
+
 
         // Environment set methods
         void setGravitationalParameter(double gp) { _gravitationalParameter = gp; }
         void setAtmosphereRadius(double ar) { _atmosphereRadius = ar; }
 
+        // Moves the planet; set from the ephemeris each step when planets move, see Scenario::updatePlanets
+        void setCenterState(const Vector3<double>& position, const Vector3<double>& velocity) { _centerPosition = position; _centerVelocity = velocity; }
+
+        // Radius of the sphere of influence, set by System::buildSpheresOfInfluence; infinite for the primary of a system
+        double getSphereOfInfluence() const { return _sphereOfInfluence; }
+        void setSphereOfInfluence(double radius) { _sphereOfInfluence = radius; }
+
+        // Spherical harmonics on top of the point mass; empty unless Harmonics.csv lists the planet
+        GravityField& getGravityField() { return _gravityField; }
+        const GravityField& getGravityField() const { return _gravityField; }
+        Vector3<double> getHarmonicAcceleration(const Vector3<double>& position) const { return _gravityField.getAcceleration(position, _gravitationalParameter, _radius); }
+        // Oblateness from the normalized C(2, 0) of the gravity field; 0 when the field has none
+        double getJ2() const { return _gravityField.isEmpty() ? 0.0 : -std::sqrt(5.0) * _gravityField.getC(2, 0); }
+
+        // Checkpoint methods
+        void saveState(BinaryWriter& writer) const;
+        void loadState(BinaryReader& reader);
+
         // Templated methods
         template<typename T>
         Vector3<T> getGravitationalAcceleration(const Vector3<T>& position) const
         {
-            T distance = position.magnitude();
+            T distance;
+            auto direction = position.normalizeAndMagnitude(distance);
 
             if (distance == 0)
             {
-                return Vector3<double>(0, 0, 0);
+                return Vector3<T>(0, 0, 0);
             }
 
-            return position.normalize() * (-_gravitationalParameter / (distance * distance));
+            return direction * (-_gravitationalParameter / (distance * distance));
         }
 
         template<typename T>
@@ -78,6 +112,7 @@ class Planet
         std::string _systemName;
         std::string _name;
         Vector3<double> _centerPosition;
+        Vector3<double> _centerVelocity;
         Vector3<double> _surfacePosition;
         double _radius;
         double _mass;
@@ -85,6 +120,9 @@ class Planet
         double _dragCoefficient;
         double _airTemperature;
         double _atmosphereRadius;
+        double _sphereOfInfluence;
+        AtmosphereTable _atmosphereTable;
+        GravityField _gravityField;
 };
 
 #endif // PLANET_H
\ No newline at end of file
@@ -0,0 +1,261 @@
+#include "Porkchop.h"
+
+#include "Checkpoint.h"
+#include "Lambert.h"
+#include "Parallel.h"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+// Identifies a porkchop table file. Bump the version whenever the layout changes.
+static const char PORKCHOP_MAGIC[8] = { 'S', 'C', 'S', 'I', 'M', 'P', 'K', 'C' };
+static const uint32_t PORKCHOP_VERSION = 2;
+
+// Per-thread arrays for one row of the grid
+struct PorkchopRow
+{
+    PorkchopRow() {}
+    ~PorkchopRow() {}
+
+    void resize(size_t count)
+    {
+        A.resize(count);
+        f.resize(count);
+        g.resize(count);
+        gdot.resize(count);
+    }
+
+    std::vector<double> A;
+    std::vector<double> f;
+    std::vector<double> g;
+    std::vector<double> gdot;
+};
+
+void PorkchopTable::generate(const std::string& departureBody, const BodyEphemeris& departure, const std::string& arrivalBody, const BodyEphemeris& arrival,
+    double mu, uint64_t source, const TimeAxis& departures, const TimeAxis& arrivals, unsigned int threads)
+{
+    const double NaN = std::numeric_limits<double>::quiet_NaN();
+
+    _departureBody = departureBody;
+    _arrivalBody = arrivalBody;
+    _mu = mu;
+    _source = source;
+    _departures = departures;
+    _arrivals = arrivals;
+
+    const size_t cells = static_cast<size_t>(departures.count) * arrivals.count;
+    _velocityX.assign(cells, 0.0f);
+    _velocityY.assign(cells, 0.0f);
+    _velocityZ.assign(cells, 0.0f);
+    _departureDeltaV.assign(cells, 0.0f);
+    _arrivalDeltaV.assign(cells, 0.0f);
+
+    // Arrival states are shared by every row
+    const uint32_t columns = arrivals.count;
+    std::vector<double> rx(columns), ry(columns), rz(columns), r(columns), vx(columns), vy(columns), vz(columns);
+
+    for (uint32_t j = 0; j < columns; j++)
+    {
+        Vector3<double> position, velocity;
+        arrival(arrivals.at(j), position, velocity);
+
+        rx[j] = position.x; ry[j] = position.y; rz[j] = position.z;
+        vx[j] = velocity.x; vy[j] = velocity.y; vz[j] = velocity.z;
+        r[j] = position.magnitude();
+    }
+
+    threads = std::max(1u, threads);
+    std::vector<PorkchopRow> rows(threads);
+    for (auto& row : rows)
+    {
+        row.resize(columns);
+    }
+
+    parallelFor(departures.count, threads, [&](uint64_t i, unsigned int worker)
+    {
+        PorkchopRow& row = rows[worker];
+        const double time = departures.at(static_cast<uint32_t>(i));
+
+        Vector3<double> position, velocity;
+        departure(time, position, velocity);
+
+        const double r1 = position.magnitude();
+        const double x1 = position.x, y1 = position.y, z1 = position.z;
+
+        // Geometry term for every column, LambertSolver::geometry unrolled over the row
+        for (uint32_t j = 0; j < columns; j++)
+        {
+            double cx = y1 * rz[j] - z1 * ry[j];
+            double cy = z1 * rx[j] - x1 * rz[j];
+            double cz = x1 * ry[j] - y1 * rx[j];
+            double r1r2 = r1 * r[j];
+            bool planar = cx * cx + cy * cy + cz * cz > 1e-24 * r1r2 * r1r2;
+
+            row.A[j] = planar ? std::sqrt(r1r2 + x1 * rx[j] + y1 * ry[j] + z1 * rz[j]) : 0.0;
+        }
+
+        // The solves. Longer flights along the row have larger z, so the last solution is a good start.
+        double z = 0.0;
+        for (uint32_t j = 0; j < columns; j++)
+        {
+            double timeOfFlight = arrivals.at(j) - time;
+            double solution = z;
+
+            if (LambertSolver::solveUniversal(r1, r[j], row.A[j], timeOfFlight, _mu, solution))
+            {
+                LambertSolver::coefficients(r1, r[j], row.A[j], solution, _mu, row.f[j], row.g[j], row.gdot[j]);
+                z = solution;
+            }
+            else
+            {
+                row.f[j] = row.g[j] = row.gdot[j] = NaN;
+            }
+        }
+
+        // Velocities and delta-v
+        const size_t offset = static_cast<size_t>(i) * columns;
+        for (uint32_t j = 0; j < columns; j++)
+        {
+            double inverse = 1.0 / row.g[j];
+            double v1x = (rx[j] - row.f[j] * x1) * inverse;
+            double v1y = (ry[j] - row.f[j] * y1) * inverse;
+            double v1z = (rz[j] - row.f[j] * z1) * inverse;
+            double v2x = (row.gdot[j] * rx[j] - x1) * inverse;
+            double v2y = (row.gdot[j] * ry[j] - y1) * inverse;
+            double v2z = (row.gdot[j] * rz[j] - z1) * inverse;
+
+            double dx = v1x - velocity.x, dy = v1y - velocity.y, dz = v1z - velocity.z;
+            double ax = vx[j] - v2x, ay = vy[j] - v2y, az = vz[j] - v2z;
+
+            _velocityX[offset + j] = static_cast<float>(v1x);
+            _velocityY[offset + j] = static_cast<float>(v1y);
+            _velocityZ[offset + j] = static_cast<float>(v1z);
+            _departureDeltaV[offset + j] = static_cast<float>(std::sqrt(dx * dx + dy * dy + dz * dz));
+            _arrivalDeltaV[offset + j] = static_cast<float>(std::sqrt(ax * ax + ay * ay + az * az));
+        }
+    });
+}
+
+bool PorkchopTable::matches(const std::string& departureBody, const std::string& arrivalBody, double mu, uint64_t source, const TimeAxis& departures, const TimeAxis& arrivals) const
+{
+    return isBuilt() && _departureBody == departureBody && _arrivalBody == arrivalBody && _mu == mu && _source == source && _departures == departures && _arrivals == arrivals;
+}
+
+bool PorkchopTable::findBest(uint32_t& departure, uint32_t& arrival) const
+{
+    bool found = false;
+    float best = 0.0f;
+
+    for (uint32_t i = 0; i < _departures.count; i++)
+    {
+        for (uint32_t j = 0; j < _arrivals.count; j++)
+        {
+            // NaN compares false, so cells without a transfer never win
+            float total = _departureDeltaV[index(i, j)] + _arrivalDeltaV[index(i, j)];
+            if (total >= 0 && (!found || total < best))
+            {
+                departure = i;
+                arrival = j;
+                best = total;
+                found = true;
+            }
+        }
+    }
+
+    return found;
+}
+
+Vector3<double> PorkchopTable::getDepartureVelocity(uint32_t departure, uint32_t arrival) const
+{
+    size_t i = index(departure, arrival);
+    return Vector3<double>(_velocityX[i], _velocityY[i], _velocityZ[i]);
+}
+
+void PorkchopTable::save(const std::string& path) const
+{
+    BinaryWriter writer;
+
+    writer.write(PORKCHOP_MAGIC);
+    writer.write(PORKCHOP_VERSION);
+    writer.writeString(_departureBody);
+    writer.writeString(_arrivalBody);
+    writer.write(_mu);
+    writer.write(_source);
+    for (const auto* axis : { &_departures, &_arrivals })
+    {
+        writer.write(axis->start);
+        writer.write(axis->step);
+        writer.write(axis->count);
+    }
+
+    // The arrays as they are in memory
+    auto& buffer = writer.getBuffer();
+    for (const auto* values : { &_velocityX, &_velocityY, &_velocityZ, &_departureDeltaV, &_arrivalDeltaV })
+    {
+        const char* bytes = reinterpret_cast<const char*>(values->data());
+        buffer.insert(buffer.end(), bytes, bytes + values->size() * sizeof(float));
+    }
+
+    if (!writeCheckpointFile(buffer, path))
+    {
+        throw std::runtime_error("Error: Could not write porkchop table " + path);
+    }
+}
+
+bool PorkchopTable::load(const std::string& path)
+{
+    if (!std::ifstream(path).good())
+    {
+        return false;
+    }
+
+    BinaryReader reader(readCheckpointFile(path));
+
+    char magic[sizeof(PORKCHOP_MAGIC)];
+    for (auto& c : magic)
+    {
+        c = reader.read<char>();
+    }
+
+    if (std::memcmp(magic, PORKCHOP_MAGIC, sizeof(PORKCHOP_MAGIC)) != 0)
+    {
+        throw std::runtime_error("Error: File is not a porkchop table: " + path);
+    }
+
+    auto version = reader.read<uint32_t>();
+    if (version != PORKCHOP_VERSION)
+    {
+        throw std::runtime_error("Error: Unsupported porkchop table version " + std::to_string(version));
+    }
+
+    _departureBody = reader.readString();
+    _arrivalBody = reader.readString();
+    reader.read(_mu);
+    reader.read(_source);
+    for (auto* axis : { &_departures, &_arrivals })
+    {
+        reader.read(axis->start);
+        reader.read(axis->step);
+        reader.read(axis->count);
+    }
+
+    const size_t cells = static_cast<size_t>(_departures.count) * _arrivals.count;
+    for (auto* values : { &_velocityX, &_velocityY, &_velocityZ, &_departureDeltaV, &_arrivalDeltaV })
+    {
+        values->resize(cells);
+        for (auto& value : *values)
+        {
+            reader.read(value);
+        }
+    }
+
+    if (!reader.atEnd())
+    {
+        throw std::runtime_error("Error: Porkchop table " + path + " has trailing bytes.");
+    }
+
+    return true;
+}
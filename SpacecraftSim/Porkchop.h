@@ -0,0 +1,83 @@
+#ifndef PORKCHOP_H
+#define PORKCHOP_H
+
+#include "Vector3.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Position and velocity of a body at a mission time, relative to the central body of a transfer
+typedef std::function<void(double time, Vector3<double>& position, Vector3<double>& velocity)> BodyEphemeris;
+
+// count evenly spaced times from start to end
+struct TimeAxis
+{
+    TimeAxis() : start(0), step(0), count(0) {}
+    TimeAxis(double start, double end, uint32_t count) : start(start), step(count > 1 ? (end - start) / (count - 1) : 0), count(count) {}
+    ~TimeAxis() {}
+
+    double at(uint32_t i) const { return start + step * i; }
+    bool operator==(const TimeAxis& other) const { return start == other.start && step == other.step && count == other.count; }
+
+    double start;
+    double step;
+    uint32_t count;
+};
+
+// Lambert transfers between two bodies over a grid of departure and arrival times. Every cell
+// holds the velocity leaving the departure body and the delta-v at each end as floats, one array
+// per quantity, so a table is 20 bytes a cell on disk and in memory. Cells without a transfer,
+// such as arrivals before departures, hold NaN.
+class PorkchopTable
+{
+    public:
+        PorkchopTable() : _mu(0), _source(0) {}
+        ~PorkchopTable() {}
+
+        // Solves every cell. Rows of one departure time are spread over threads; along a row the
+        // geometry and velocities are computed in flat arrays, and each solve starts from the
+        // solution of the cell before it. source identifies where the body states came from, such
+        // as the fingerprint of the ephemeris, so a table is not reused for other planet motion.
+        void generate(const std::string& departureBody, const BodyEphemeris& departure, const std::string& arrivalBody, const BodyEphemeris& arrival,
+            double mu, uint64_t source, const TimeAxis& departures, const TimeAxis& arrivals, unsigned int threads);
+
+        bool isBuilt() const { return !_departureDeltaV.empty(); }
+
+        // Whether the table was generated for this transfer, source of body states and grid
+        bool matches(const std::string& departureBody, const std::string& arrivalBody, double mu, uint64_t source, const TimeAxis& departures, const TimeAxis& arrivals) const;
+
+        // Cell with the lowest total delta-v; false when no cell has a transfer
+        bool findBest(uint32_t& departure, uint32_t& arrival) const;
+
+        Vector3<double> getDepartureVelocity(uint32_t departure, uint32_t arrival) const;
+        double getDepartureDeltaV(uint32_t departure, uint32_t arrival) const { return _departureDeltaV[index(departure, arrival)]; }
+        double getArrivalDeltaV(uint32_t departure, uint32_t arrival) const { return _arrivalDeltaV[index(departure, arrival)]; }
+
+        const TimeAxis& getDepartures() const { return _departures; }
+        const TimeAxis& getArrivals() const { return _arrivals; }
+
+        void save(const std::string& path) const;
+        // False when there is no file at path; throws if the file is not a porkchop table
+        bool load(const std::string& path);
+
+    protected:
+        size_t index(uint32_t departure, uint32_t arrival) const { return static_cast<size_t>(departure) * _arrivals.count + arrival; }
+
+        std::string _departureBody;
+        std::string _arrivalBody;
+        double _mu;
+        uint64_t _source;
+        TimeAxis _departures;
+        TimeAxis _arrivals;
+
+        // Row major, one row per departure time
+        std::vector<float> _velocityX;
+        std::vector<float> _velocityY;
+        std::vector<float> _velocityZ;
+        std::vector<float> _departureDeltaV;
+        std::vector<float> _arrivalDeltaV;
+};
+
+#endif // PORKCHOP_H
@@ -0,0 +1,124 @@
+#include "Propulsion.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+// Segment index and fraction in [0, 1] of a burn time, clamped to the table
+static inline int locate(double burnTime, double inverseStep, int last, double& t)
+{
+    double u = std::min(std::max(burnTime * inverseStep, 0.0), static_cast<double>(last + 1));
+    int i = std::min(static_cast<int>(u), last);
+    t = u - i;
+    return i;
+}
+
+
+Engine::Engine() : _burnTime(0.0), _intervals(0), _step(0.0), _inverseStep(0.0)
+{
+}
+
+void Engine::build(const std::string& name, const std::vector<ThrustSample>& samples, double resolution)
+{
+    if (samples.size() < 2 || samples.front().time != 0.0)
+    {
+        throw std::runtime_error("Error: Thrust curve of engine " + name + " needs at least two samples, the first at time 0.");
+    }
+
+    double gap = resolution;
+    for (size_t k = 0; k < samples.size(); k++)
+    {
+        if (!(samples[k].thrust >= 0) || !(samples[k].isp > 0) || (k > 0 && !(samples[k].time > samples[k - 1].time)))
+        {
+            throw std::runtime_error("Error: Thrust curve of engine " + name + " has a bad sample at time " + std::to_string(samples[k].time)
+                + ". Times must increase, thrust must not be negative and Isp must be positive.");
+        }
+
+        if (k > 0)
+        {
+            gap = std::min(gap, samples[k].time - samples[k - 1].time);
+        }
+    }
+
+    if (!(gap > 0))
+    {
+        throw std::runtime_error("Error: Thrust curve of engine " + name + " needs a positive resolution. resolution = " + std::to_string(resolution));
+    }
+
+    _name = name;
+    _samples = samples;
+    _burnTime = samples.back().time;
+    _intervals = static_cast<size_t>(std::ceil(_burnTime / gap - 1e-9));
+    _step = _burnTime / _intervals;
+    _inverseStep = 1.0 / _step;
+
+    // Thrust and mass flow at the nodes, from the curve linear between samples
+    const size_t nodes = _intervals + 1;
+    std::vector<double> thrust(nodes), massFlow(nodes);
+
+    size_t k = 0;
+    for (size_t n = 0; n < nodes; n++)
+    {
+        double time = n == _intervals ? _burnTime : n * _step;
+
+        while (k + 2 < samples.size() && samples[k + 1].time <= time)
+        {
+            k++;
+        }
+
+        const ThrustSample& a = samples[k];
+        const ThrustSample& b = samples[k + 1];
+        double f = std::min(std::max((time - a.time) / (b.time - a.time), 0.0), 1.0);
+
+        thrust[n] = a.thrust + (b.thrust - a.thrust) * f;
+        massFlow[n] = thrust[n] / ((a.isp + (b.isp - a.isp) * f) * STANDARD_GRAVITY);
+    }
+
+    _coefficients.assign(STRIDE * _intervals, 0.0);
+
+    for (size_t n = 0; n < _intervals; n++)
+    {
+        double* c = &_coefficients[STRIDE * n];
+        c[THRUST] = thrust[n];
+        c[THRUST + 1] = thrust[n + 1] - thrust[n];
+        c[MASS_FLOW] = massFlow[n];
+        c[MASS_FLOW + 1] = massFlow[n + 1] - massFlow[n];
+    }
+}
+
+double Engine::getThrust(double burnTime) const
+{
+    double t;
+    const double* c = &_coefficients[STRIDE * locate(burnTime, _inverseStep, static_cast<int>(_intervals) - 1, t)];
+    return burnTime < _burnTime ? c[THRUST] + c[THRUST + 1] * t : 0.0;
+}
+
+double Engine::getMassFlow(double burnTime) const
+{
+    double t;
+    const double* c = &_coefficients[STRIDE * locate(burnTime, _inverseStep, static_cast<int>(_intervals) - 1, t)];
+    return burnTime < _burnTime ? c[MASS_FLOW] + c[MASS_FLOW + 1] * t : 0.0;
+}
+
+double Engine::burn(double throttle, double dt, double& burnTime, double& fuelMass) const
+{
+    // Selects rather than branches throughout
+    double middle = burnTime + 0.5 * dt;
+    double t;
+    const double* c = &_coefficients[STRIDE * locate(middle, _inverseStep, static_cast<int>(_intervals) - 1, t)];
+
+    throttle = std::min(std::max(throttle, 0.0), 1.0);
+    double on = middle < _burnTime ? throttle : 0.0;
+
+    double thrust = (c[THRUST] + c[THRUST + 1] * t) * on;
+    double demand = (c[MASS_FLOW] + c[MASS_FLOW + 1] * t) * on * dt;
+
+    // Share of the step the fuel lasts
+    double used = std::min(demand, fuelMass);
+    double fraction = demand > used ? used / demand : 1.0;
+
+    burnTime += on > 0 ? dt * fraction : 0.0;
+    fuelMass -= used;
+    return thrust * fraction;
+}
+
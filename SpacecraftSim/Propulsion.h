@@ -0,0 +1,72 @@
+#ifndef PROPULSION_H
+#define PROPULSION_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Standard gravity, which relates specific impulse to exhaust velocity, m/s^2
+static const double STANDARD_GRAVITY = 9.80665;
+
+// One point of an engine's thrust curve at full throttle
+struct ThrustSample
+{
+    ThrustSample() : time(0.0), thrust(0.0), isp(0.0) {}
+    ThrustSample(double _time, double _thrust, double _isp) : time(_time), thrust(_thrust), isp(_isp) {}
+    ~ThrustSample() {}
+
+    double time;        // s since ignition
+    double thrust;      // N
+    double isp;         // s
+};
+
+
+// An engine: thrust and specific impulse against burn time, linear between the samples of its
+// curve. build() resamples the curve onto a uniform grid of thrust and mass flow segments, so a
+// lookup is one index, one fraction and two multiply-adds, with no search and no division by
+// the Isp. Grid nodes fall on every sample whose time is a multiple of the step, which holds
+// for curves sampled at a regular interval; a corner between nodes is cut over one step. Mass
+// flow is linear between nodes too, so it strays a little from thrust over Isp where the Isp
+// changes within a step.
+//
+// The curve is the engine's whole burn: past the last sample it gives no thrust.
+class Engine
+{
+    public:
+        Engine();
+        ~Engine() {}
+
+        // Samples in time order from 0. The step is `resolution` seconds or the shortest gap
+        // between samples, whichever is smaller. Throws on an empty or unordered curve.
+        void build(const std::string& name, const std::vector<ThrustSample>& samples, double resolution = 1.0);
+
+        const std::string& getName() const { return _name; }
+        const std::vector<ThrustSample>& getSamples() const { return _samples; }
+        double getBurnTime() const { return _burnTime; }
+        double getStep() const { return _step; }
+        size_t getIntervalCount() const { return _intervals; }
+
+        // At full throttle, burnTime seconds after ignition
+        double getThrust(double burnTime) const;
+        double getMassFlow(double burnTime) const;
+
+        // Fires for dt seconds at a throttle in [0, 1], advancing the burn time and using fuel.
+        // The curve is taken at the middle of the step. The fuel runs out part way through a step
+        // rather than going negative. Returns the mean thrust over the step, N.
+        double burn(double throttle, double dt, double& burnTime, double& fuelMass) const;
+
+        // Layout of the table: thrust c0, c1 and mass flow c0, c1 of each segment, in the fraction of the step
+        enum { THRUST = 0, MASS_FLOW = 2, STRIDE = 4 };
+
+    protected:
+        std::string _name;
+        std::vector<ThrustSample> _samples;
+        double _burnTime;
+        size_t _intervals;
+        double _step;
+        double _inverseStep;
+        std::vector<double> _coefficients;
+};
+
+
+#endif // PROPULSION_H
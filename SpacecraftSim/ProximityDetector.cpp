@@ -0,0 +1,296 @@
+#include "ProximityDetector.h"
+
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+// Cell coordinates are packed into 21 bits each
+static const int64_t CELL_BIAS = int64_t(1) << 20;
+static const int64_t CELL_LIMIT = (int64_t(1) << 21) - 1;
+
+static uint64_t cellCoordinate(double value, double inverseCellSize)
+{
+    int64_t c = static_cast<int64_t>(std::floor(value * inverseCellSize)) + CELL_BIAS;
+    return static_cast<uint64_t>(std::min(std::max(c, int64_t(0)), CELL_LIMIT));
+}
+
+static uint64_t packCell(uint64_t x, uint64_t y, uint64_t z)
+{
+    return (x << 42) | (y << 21) | z;
+}
+
+
+std::string proximityEventTypeToString(ProximityEventType type)
+{
+    switch (type)
+    {
+        case ProximityEventType::CloseApproach: return "CloseApproach";
+        case ProximityEventType::Collision: return "Collision";
+        case ProximityEventType::Separation: return "Separation";
+    }
+
+    return "Unknown";
+}
+
+ProximitySettings::ProximitySettings() : threshold(1000.0), collisionDistance(10.0), threads(defaultThreadCount())
+{
+}
+
+
+ProximityDetector::ProximityDetector(const ProximitySettings& settings) : _settings(settings), _cellSize(0.0), _candidates(0)
+{
+}
+
+double ProximityDetector::closestApproach(const Vector3<double>& a0, const Vector3<double>& a1, const Vector3<double>& b0, const Vector3<double>& b1, double& fraction)
+{
+    auto start = a0 - b0;
+    auto motion = (a1 - a0) - (b1 - b0);
+    double motionSquared = motion.magnitudeSquared();
+
+    fraction = motionSquared > 0 ? std::min(std::max(-start.dot(motion) / motionSquared, 0.0), 1.0) : 0.0;
+    return (start + motion * fraction).magnitude();
+}
+
+const std::vector<ProximityEvent>& ProximityDetector::update(double time, double dt, size_t count,
+    const double* x0, const double* y0, const double* z0, const double* x1, const double* y1, const double* z1)
+{
+    _events.clear();
+
+    auto start = [=](uint32_t i) { return Vector3<double>(x0[i], y0[i], z0[i]); };
+    auto end = [=](uint32_t i) { return Vector3<double>(x1[i], y1[i], z1[i]); };
+
+    // Cell size from the longest step. It only shrinks when the steps get much shorter, so the
+    // keys, and the sort order that depends on them, stay stable from frame to frame.
+    double longest = 0.0;
+    for (size_t i = 0; i < count; i++)
+    {
+        double dx = x1[i] - x0[i], dy = y1[i] - y0[i], dz = z1[i] - z0[i];
+        longest = std::max(longest, dx * dx + dy * dy + dz * dz);
+    }
+
+    double needed = _settings.threshold + std::sqrt(longest);
+    bool resized = needed > _cellSize || needed < 0.5 * _cellSize;
+    if (resized)
+    {
+        _cellSize = 1.25 * needed;
+    }
+
+    // Cell of each step's midpoint
+    const double inverseCellSize = 1.0 / _cellSize;
+    size_t moved = 0;
+
+    bool coherent = !resized && _keys.size() == count && _order.size() == count;
+    _keys.resize(count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        uint64_t key = packCell(cellCoordinate(0.5 * (x0[i] + x1[i]), inverseCellSize),
+            cellCoordinate(0.5 * (y0[i] + y1[i]), inverseCellSize),
+            cellCoordinate(0.5 * (z0[i] + z1[i]), inverseCellSize));
+
+        moved += key != _keys[i];
+        _keys[i] = key;
+    }
+
+    // Last frame's order is nearly sorted while few spacecraft change cell
+    auto byKey = [this](uint32_t a, uint32_t b) { return _keys[a] < _keys[b]; };
+
+    if (coherent && moved <= count / 8)
+    {
+        for (size_t i = 1; i < count; i++)
+        {
+            uint32_t value = _order[i];
+            size_t j = i;
+
+            for (; j > 0 && byKey(value, _order[j - 1]); j--)
+            {
+                _order[j] = _order[j - 1];
+            }
+            _order[j] = value;
+        }
+    }
+    else
+    {
+        _order.resize(count);
+        std::iota(_order.begin(), _order.end(), 0u);
+        std::sort(_order.begin(), _order.end(), byKey);
+    }
+
+    _cells.clear();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (_cells.empty() || _cells.back().key != _keys[_order[i]])
+        {
+            _cells.push_back({ _keys[_order[i]], i, i });
+        }
+        _cells.back().end = i + 1;
+    }
+
+    // Each cell against itself and its forward neighbours
+    unsigned int threads = std::max(1u, _settings.threads);
+    _workerEncounters.resize(threads);
+    _workerCandidates.assign(threads, 0);
+    for (auto& encounters : _workerEncounters)
+    {
+        encounters.clear();
+    }
+
+    const double threshold = _settings.threshold;
+
+    parallelFor(_cells.size(), threads, [&](uint64_t c, unsigned int worker)
+    {
+        auto& encounters = _workerEncounters[worker];
+        uint64_t candidates = 0;
+
+        auto test = [&](uint32_t p, uint32_t q)
+        {
+            uint32_t a = std::min(p, q), b = std::max(p, q);
+            double fraction;
+            double distance = closestApproach(start(a), end(a), start(b), end(b), fraction);
+
+            candidates++;
+            if (distance <= threshold)
+            {
+                encounters.push_back({ a, b, distance, fraction });
+            }
+        };
+
+        const Cell& cell = _cells[c];
+
+        for (uint32_t i = cell.begin; i < cell.end; i++)
+        {
+            for (uint32_t j = i + 1; j < cell.end; j++)
+            {
+                test(_order[i], _order[j]);
+            }
+        }
+
+        const int64_t cx = static_cast<int64_t>(cell.key >> 42);
+        const int64_t cy = static_cast<int64_t>((cell.key >> 21) & CELL_LIMIT);
+        const int64_t cz = static_cast<int64_t>(cell.key & CELL_LIMIT);
+
+        // Forward neighbours come in rows of consecutive keys: (0, 0, +1), then (0, +1, -1..+1)
+        // and (+1, -1..+1, -1..+1). Each row is one search among the cells after this one.
+        static const int rows[5][3] = { { 0, 0, 1 }, { 0, 1, -1 }, { 1, -1, -1 }, { 1, 0, -1 }, { 1, 1, -1 } };
+
+        for (const auto& row : rows)
+        {
+            int64_t nx = cx + row[0], ny = cy + row[1];
+            int64_t first = std::max<int64_t>(cz + row[2], 0), last = std::min<int64_t>(cz + 1, CELL_LIMIT);
+
+            if (nx > CELL_LIMIT || ny < 0 || ny > CELL_LIMIT)
+            {
+                continue;
+            }
+
+            const uint64_t lastKey = packCell(nx, ny, last);
+            auto neighbour = std::lower_bound(_cells.begin() + c + 1, _cells.end(), packCell(nx, ny, first),
+                [](const Cell& cell, uint64_t key) { return cell.key < key; });
+
+            for (; neighbour != _cells.end() && neighbour->key <= lastKey; ++neighbour)
+            {
+                for (uint32_t i = cell.begin; i < cell.end; i++)
+                {
+                    for (uint32_t j = neighbour->begin; j < neighbour->end; j++)
+                    {
+                        test(_order[i], _order[j]);
+                    }
+                }
+            }
+        }
+
+        _workerCandidates[worker] += candidates;
+    });
+
+    _encounters.clear();
+    for (const auto& encounters : _workerEncounters)
+    {
+        _encounters.insert(_encounters.end(), encounters.begin(), encounters.end());
+    }
+    std::sort(_encounters.begin(), _encounters.end());
+
+    _candidates = std::accumulate(_workerCandidates.begin(), _workerCandidates.end(), uint64_t(0));
+
+    // Changes against the pairs of the last frame
+    auto midpoint = [&](uint32_t a, uint32_t b, double fraction)
+    {
+        auto pa = start(a) + (end(a) - start(a)) * fraction;
+        auto pb = start(b) + (end(b) - start(b)) * fraction;
+        return (pa + pb) * 0.5;
+    };
+
+    std::vector<Pair> active;
+    std::vector<uint8_t> activeCollision;
+    active.reserve(_encounters.size());
+    activeCollision.reserve(_encounters.size());
+
+    size_t previous = 0;
+
+    for (const auto& encounter : _encounters)
+    {
+        Pair pair(encounter.a, encounter.b);
+
+        // Last frame's pairs that come before this one have separated
+        for (; previous < _active.size() && _active[previous] < pair; previous++)
+        {
+            auto gone = _active[previous];
+            if (gone.second < count)
+            {
+                _events.push_back(ProximityEvent(ProximityEventType::Separation, time + dt, gone.first, gone.second,
+                    (end(gone.first) - end(gone.second)).magnitude(), midpoint(gone.first, gone.second, 1.0)));
+            }
+        }
+
+        bool known = previous < _active.size() && _active[previous] == pair;
+        bool wasColliding = known && _activeCollision[previous];
+        bool colliding = encounter.distance <= _settings.collisionDistance;
+
+        double when = time + encounter.fraction * dt;
+        auto where = midpoint(encounter.a, encounter.b, encounter.fraction);
+
+        if (!known)
+        {
+            _events.push_back(ProximityEvent(ProximityEventType::CloseApproach, when, encounter.a, encounter.b, encounter.distance, where));
+        }
+
+        if (colliding && !wasColliding)
+        {
+            _events.push_back(ProximityEvent(ProximityEventType::Collision, when, encounter.a, encounter.b, encounter.distance, where));
+        }
+
+        if (known)
+        {
+            previous++;
+        }
+
+        active.push_back(pair);
+        activeCollision.push_back(colliding);
+    }
+
+    for (; previous < _active.size(); previous++)
+    {
+        auto gone = _active[previous];
+        if (gone.second < count)
+        {
+            _events.push_back(ProximityEvent(ProximityEventType::Separation, time + dt, gone.first, gone.second,
+                (end(gone.first) - end(gone.second)).magnitude(), midpoint(gone.first, gone.second, 1.0)));
+        }
+    }
+
+    _active.swap(active);
+    _activeCollision.swap(activeCollision);
+
+    std::stable_sort(_events.begin(), _events.end(), [](const ProximityEvent& a, const ProximityEvent& b) { return a.time < b.time; });
+
+    for (const auto& event : _events)
+    {
+        for (const auto& callback : _callbacks)
+        {
+            callback(event);
+        }
+    }
+
+    return _events;
+}
@@ -0,0 +1,126 @@
+#ifndef PROXIMITYDETECTOR_H
+#define PROXIMITYDETECTOR_H
+
+#include "Vector3.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+enum class ProximityEventType
+{
+    CloseApproach,  // a pair came within the threshold
+    Collision,      // a pair came within the collision distance
+    Separation      // a pair that was within the threshold no longer is
+};
+
+std::string proximityEventTypeToString(ProximityEventType type);
+
+struct ProximityEvent
+{
+    ProximityEvent() {}
+
+    ProximityEvent(ProximityEventType _type, double _time, uint32_t _a, uint32_t _b, double _distance, Vector3<double> _position) :
+        type(_type), time(_time), a(_a), b(_b), distance(_distance), position(_position) {}
+
+    ~ProximityEvent() {}
+
+    ProximityEventType type;
+    double time;                // time of closest approach in the step, or the end of the step for a separation
+    uint32_t a, b;              // spacecraft indices, a < b
+    double distance;            // closest distance during the step
+    Vector3<double> position;   // midpoint of the pair at that time
+};
+
+struct ProximitySettings
+{
+    ProximitySettings();
+    ~ProximitySettings() {}
+
+    double threshold;           // close approach distance
+    double collisionDistance;
+    unsigned int threads;
+};
+
+
+// Finds pairs of spacecraft that come close during a step, from their positions at the start and
+// end of the step as structure of arrays.
+//
+// Broad phase: a uniform grid hashed on the midpoint of each spacecraft's step. The cell size is
+// the threshold plus the longest step, so any pair that gets within the threshold has midpoints in
+// the same or neighbouring cells. Spacecraft are sorted by cell so each cell is a contiguous range,
+// and the order from the last frame is kept and insertion sorted, which is close to linear while
+// few spacecraft change cell. Cells are processed in parallel, each against itself and its 13
+// forward neighbours so every pair of cells is visited once; the neighbours lie in five runs of
+// consecutive keys, so they take five binary searches.
+//
+// Narrow phase: both spacecraft move in a straight line over the step, so the closest approach is
+// the minimum of |relative start + t * relative displacement| over t in [0, 1].
+//
+// The pairs within the threshold are kept to the next frame; events are the changes against them.
+class ProximityDetector
+{
+    public:
+        typedef std::function<void(const ProximityEvent&)> ProximityCallback;
+        typedef std::pair<uint32_t, uint32_t> Pair;
+
+        ProximityDetector(const ProximitySettings& settings = ProximitySettings());
+        ~ProximityDetector() {}
+
+        // One step of `count` spacecraft from time to time + dt. Fires the callbacks and returns
+        // the events in time order.
+        const std::vector<ProximityEvent>& update(double time, double dt, size_t count,
+            const double* x0, const double* y0, const double* z0, const double* x1, const double* y1, const double* z1);
+
+        void registerCallback(ProximityCallback callback) { _callbacks.push_back(callback); }
+
+        // Pairs within the threshold during the last step, sorted
+        const std::vector<Pair>& getActivePairs() const { return _active; }
+
+        // Narrow phase tests in the last step, a measure of the broad phase's work
+        uint64_t getCandidateCount() const { return _candidates; }
+        size_t getCellCount() const { return _cells.size(); }
+
+        const ProximitySettings& getSettings() const { return _settings; }
+
+        // Closest distance of two straight moves over the same step, and the step fraction where it happens
+        static double closestApproach(const Vector3<double>& a0, const Vector3<double>& a1, const Vector3<double>& b0, const Vector3<double>& b1, double& fraction);
+
+    protected:
+        struct Cell
+        {
+            uint64_t key;
+            uint32_t begin, end;    // range in _order
+        };
+
+        struct Encounter
+        {
+            uint32_t a, b;
+            double distance;
+            double fraction;
+
+            bool operator<(const Encounter& other) const { return a < other.a || (a == other.a && b < other.b); }
+        };
+
+        ProximitySettings _settings;
+        double _cellSize;
+
+        std::vector<uint64_t> _keys;        // per spacecraft
+        std::vector<uint32_t> _order;       // spacecraft sorted by key
+        std::vector<Cell> _cells;
+
+        std::vector<std::vector<Encounter> > _workerEncounters;
+        std::vector<uint64_t> _workerCandidates;
+        std::vector<Encounter> _encounters;
+
+        std::vector<Pair> _active;
+        std::vector<uint8_t> _activeCollision;  // per active pair, within the collision distance
+        std::vector<ProximityEvent> _events;
+        std::vector<ProximityCallback> _callbacks;
+        uint64_t _candidates;
+};
+
+#endif // PROXIMITYDETECTOR_H
@@ -0,0 +1,85 @@
+#ifndef QUATERNION_H
+#define QUATERNION_H
+
+#include "Vector3.h"
+
+#include <cmath>
+
+// Unit quaternions for attitude. A quaternion q rotates body vectors into the inertial frame,
+// v_inertial = q v_body q*, and q * r applies r in the body frame first.
+template<typename T>
+class Quaternion {
+    public:
+        T w, x, y, z;
+
+        Quaternion() : w(1), x(0), y(0), z(0) {}
+        Quaternion(T w, T x, T y, T z) : w(w), x(x), y(y), z(z) {}
+
+        Quaternion operator*(const Quaternion &q) const {
+            return Quaternion(w * q.w - x * q.x - y * q.y - z * q.z,
+                w * q.x + x * q.w + y * q.z - z * q.y,
+                w * q.y - x * q.z + y * q.w + z * q.x,
+                w * q.z + x * q.y - y * q.x + z * q.w);
+        }
+
+        Quaternion conjugate() const {
+            return Quaternion(w, -x, -y, -z);
+        }
+
+        T norm() const {
+            return std::sqrt(w * w + x * x + y * y + z * z);
+        }
+
+        Quaternion normalize() const {
+            T n = norm();
+            return n == 0 ? Quaternion() : Quaternion(w / n, x / n, y / n, z / n);
+        }
+
+        // q v q* without building the product, as v + 2 w (u x v) + 2 u x (u x v)
+        Vector3<T> rotate(const Vector3<T> &v) const {
+            Vector3<T> u(x, y, z);
+            Vector3<T> t = u.cross(v) * T(2);
+            return v + t * w + u.cross(t);
+        }
+
+        // The rotation by |v| radians about v
+        static Quaternion fromRotationVector(const Vector3<T> &v) {
+            T angle = v.magnitude();
+            if (angle == 0) {
+                return Quaternion();
+            }
+
+            T s = std::sin(angle / 2) / angle;
+            return Quaternion(std::cos(angle / 2), v.x * s, v.y * s, v.z * s);
+        }
+
+        // The shortest rotation taking unit vector a onto unit vector b
+        static Quaternion fromTwoVectors(const Vector3<T> &a, const Vector3<T> &b) {
+            T c = a.dot(b);
+            Vector3<T> axis = a.cross(b);
+
+            // Opposite vectors: half a turn about any axis normal to a
+            if (c < T(-1) + T(1e-12)) {
+                axis = std::fabs(a.x) < T(0.9) ? Vector3<T>(1, 0, 0).cross(a) : Vector3<T>(0, 1, 0).cross(a);
+                axis = axis.normalize();
+                return Quaternion(0, axis.x, axis.y, axis.z);
+            }
+
+            return Quaternion(T(1) + c, axis.x, axis.y, axis.z).normalize();
+        }
+
+        // Rotation vector of q, the angle in (-pi, pi] times the axis
+        Vector3<T> toRotationVector() const {
+            Vector3<T> u(x, y, z);
+            T s = u.magnitude();
+            if (s == 0) {
+                return Vector3<T>(0, 0, 0);
+            }
+
+            // The shorter way round
+            T angle = T(2) * std::atan2(s, std::fabs(w));
+            return u * ((w < 0 ? -angle : angle) / s);
+        }
+};
+
+#endif // QUATERNION_H
@@ -0,0 +1,129 @@
+#include "RealTimePacer.h"
+
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#include <chrono>
+#include <thread>
+#else
+#include <cerrno>
+#include <time.h>
+#endif
+
+// Upper edges of the lateness histogram bins in microseconds; the last bin takes everything above
+static const double LATENESS_BINS[] = { 10, 50, 100, 500, 1000, 5000, 10000 };
+static const size_t LATENESS_BIN_COUNT = sizeof(LATENESS_BINS) / sizeof(LATENESS_BINS[0]) + 1;
+
+RealTimePacer::RealTimePacer(double framePeriod) : _framePeriod(framePeriod), _periodNanoseconds(0), _startTime(0), _frameStart(0), _nextDeadline(0),
+    _behind(false), _frames(0), _overruns(0), _latenessHistogram(LATENESS_BIN_COUNT, 0)
+{
+    if (!(framePeriod > 0))
+    {
+        throw std::runtime_error("Error: Real time frame period must be positive.");
+    }
+
+    _periodNanoseconds = static_cast<int64_t>(std::llround(framePeriod * 1e9));
+}
+
+int64_t RealTimePacer::now()
+{
+#ifdef _WIN32
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#else
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+void RealTimePacer::sleepUntil(int64_t deadline)
+{
+#ifdef _WIN32
+    // No absolute monotonic sleep on Windows; sleep_until on steady_clock is the closest match
+    std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::nanoseconds(deadline)));
+#else
+    timespec ts;
+    ts.tv_sec = static_cast<time_t>(deadline / 1000000000);
+    ts.tv_nsec = static_cast<long>(deadline % 1000000000);
+
+    // The deadline is absolute, so resuming after a signal does not stretch the sleep
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR)
+    {
+    }
+#endif
+}
+
+void RealTimePacer::start()
+{
+    _startTime = now();
+    _frameStart = _startTime;
+    _nextDeadline = _startTime + _periodNanoseconds;
+    _behind = false;
+}
+
+void RealTimePacer::waitForNextFrame()
+{
+    int64_t end = now();
+
+    _frames++;
+    _executionTime.add((end - _frameStart) * 1e-9);
+
+    if (end > _nextDeadline)
+    {
+        _overruns++;
+    }
+    else
+    {
+        sleepUntil(_nextDeadline);
+    }
+
+    _frameStart = now();
+
+    double lateness = (_frameStart - _nextDeadline) * 1e-9;
+    _behind = end > _nextDeadline;
+    _lateness.add(lateness);
+
+    size_t bin = 0;
+    while (bin < LATENESS_BIN_COUNT - 1 && lateness * 1e6 > LATENESS_BINS[bin])
+    {
+        bin++;
+    }
+    _latenessHistogram[bin]++;
+
+    _nextDeadline += _periodNanoseconds;
+}
+
+void RealTimePacer::printReport() const
+{
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << " - Real time pacing: " << _frames << " frames of " << _framePeriod * 1e3 << " ms, "
+        << _overruns << " overruns" << std::endl;
+
+    if (_frames == 0)
+    {
+        std::cout << std::defaultfloat;
+        return;
+    }
+
+    std::cout << "   execution ms: mean " << _executionTime.getStatistics().getMean() * 1e3
+        << ", p99 " << _executionTime.quantile(0.99) * 1e3
+        << ", max " << _executionTime.getStatistics().getMax() * 1e3 << std::endl;
+    std::cout << "   lateness  ms: mean " << _lateness.getStatistics().getMean() * 1e3
+        << ", p99 " << _lateness.quantile(0.99) * 1e3
+        << ", max " << _lateness.getStatistics().getMax() * 1e3 << std::endl;
+    std::cout << std::defaultfloat;
+
+    std::cout << "   lateness histogram:" << std::endl;
+    for (size_t i = 0; i < LATENESS_BIN_COUNT; i++)
+    {
+        std::string label = i < LATENESS_BIN_COUNT - 1
+            ? "<= " + std::to_string(static_cast<int>(LATENESS_BINS[i])) + " us"
+            : " > " + std::to_string(static_cast<int>(LATENESS_BINS[i - 1])) + " us";
+
+        std::cout << "   " << std::left << std::setw(14) << label << std::right << std::setw(10) << _latenessHistogram[i] << std::endl;
+    }
+}
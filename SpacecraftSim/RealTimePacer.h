@@ -0,0 +1,55 @@
+#ifndef REALTIMEPACER_H
+#define REALTIMEPACER_H
+
+#include "Statistics.h"
+
+#include <cstdint>
+#include <vector>
+
+// Holds a loop to a fixed wall clock frame period. Frame n starts at the absolute deadline
+// start + n * period, so sleep error does not accumulate from frame to frame. A frame that runs
+// past the next deadline is an overrun; the following frame starts immediately and the schedule
+// stays anchored to the original deadlines so the loop catches up instead of drifting.
+class RealTimePacer
+{
+    public:
+        RealTimePacer(double framePeriod);
+        ~RealTimePacer() {}
+
+        // Anchors the deadlines at the current time and starts the first frame
+        void start();
+
+        // Ends the current frame, sleeps until the next deadline and starts the next frame
+        void waitForNextFrame();
+
+        // True when the frame that just started began after its deadline had already passed
+        bool isBehind() const { return _behind; }
+
+        double getFramePeriod() const { return _framePeriod; }
+        uint64_t getFrames() const { return _frames; }
+        uint64_t getOverruns() const { return _overruns; }
+
+        // Frame execution time, start lateness and a histogram of the lateness
+        void printReport() const;
+
+    protected:
+        // CLOCK_MONOTONIC in nanoseconds
+        static int64_t now();
+        static void sleepUntil(int64_t deadline);
+
+        double _framePeriod;
+        int64_t _periodNanoseconds;
+        int64_t _startTime;
+        int64_t _frameStart;
+        int64_t _nextDeadline;
+        bool _behind;
+
+        uint64_t _frames;
+        uint64_t _overruns;
+
+        OutcomeStatistics _executionTime;   // seconds spent working in each frame
+        OutcomeStatistics _lateness;        // seconds between a deadline and the frame actually starting
+        std::vector<uint64_t> _latenessHistogram;
+};
+
+#endif // REALTIMEPACER_H
@@ -1,19 +1,42 @@
 #include "Scenario.h"
 
 #include "Database.h"
+#include "EventDetector.h"
+#include "ForcePipeline.h"
+#include "Pipeline.h"
+#include "RealTimePacer.h"
+#include "Scheduler.h"
 #include "Spacecraft.h"
 #include "System.h"
 #include "CSVParser.h"
 
+#include <cmath>
+#include <csignal>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
 
-Scenario::Scenario()
+// Set from signal handlers and polled by the simulation loop
+// 1 : write a checkpoint and keep running
+// 2 : write a checkpoint and stop
+static volatile std::sig_atomic_t checkpointRequest = 0;
+
+static void onCheckpointSignal(int signal)
+{
+    checkpointRequest = (signal == SIGINT || signal == SIGTERM) ? 2 : 1;
+    std::signal(signal, onCheckpointSignal);
+}
+
+Scenario::Scenario() : _currentStep(0), _currentTimestamp(0.0), _restored(false), _atmosphereResolution(100.0), _checkpointPath("spacecraft_simulation.ckpt"), _checkpointInterval(0)
 {
     _database = new Database("spacecraft_simulation.db");
 
     _filepaths["SystemsPath"] = "Systems.csv";
     _filepaths["PlanetsPath"] = "Planets.csv";
     _filepaths["SpacecraftPath"] = "Spacecraft.csv";
+    _filepaths["HarmonicsPath"] = "Harmonics.csv";
+    _filepaths["EnginesPath"] = "Engines.csv";
 }
 
 Scenario::~Scenario()
@@ -51,6 +74,18 @@ bool Scenario::loadFiles()
         {
             throw std::runtime_error("Could not load spacecraft from file. filepath = " + filepath);
         }
+
+        // Harmonics are optional; without the file every planet is a point mass
+        if (filepath.find("Harmonics.csv") != std::string::npos && std::ifstream(filepath).good() && !loadHarmonicsFromFile(filepath))
+        {
+            throw std::runtime_error("Could not load harmonics from file. filepath = " + filepath);
+        }
+
+        // Engines are optional too; without the file no spacecraft can name one
+        if (filepath.find("Engines.csv") != std::string::npos && std::ifstream(filepath).good() && !loadEnginesFromFile(filepath))
+        {
+            throw std::runtime_error("Could not load engines from file. filepath = " + filepath);
+        }
     }
 
     return true;
@@ -82,39 +117,321 @@ bool Scenario::compile()
         planet->setGravitationalParameter(planetData.gravParam);
         planet->setAtmosphereRadius(planetData.atmoRadius);
 
+        if (_atmosphereResolution > 0)
+        {
+            planet->buildAtmosphereTable(_atmosphereResolution);
+        }
+
         _systems.at(planetData.systemName)->addPlanet(planet);
     }
 
+    // Harmonics
+    for (const auto& harmonicData : _harmonicInitData)
+    {
+        auto system = _systems.find(harmonicData.systemName);
+
+        if (system == _systems.end() || system->second->getPlanets().count(harmonicData.planetName) == 0)
+        {
+            std::cout << "Planet name = " + harmonicData.planetName + " does not exist in system name = " + harmonicData.systemName + ". Could not add its harmonics." << std::endl;
+            return false;
+        }
+
+        system->second->getPlanets().at(harmonicData.planetName)->getGravityField().setCoefficient(harmonicData.degree, harmonicData.order, harmonicData.c, harmonicData.s);
+    }
+
+    // Spheres of influence, once every planet is in
+    for (const auto& kv : _systems)
+    {
+        kv.second->buildSpheresOfInfluence();
+    }
+
+    // Engines, from their thrust curves in file order
+    std::map<std::string, std::vector<ThrustSample> > curves;
+    for (const auto& engineData : _engineInitData)
+    {
+        curves[engineData.name].push_back(ThrustSample(engineData.time, engineData.thrust, engineData.isp));
+    }
+
+    for (const auto& kv : curves)
+    {
+        _engines[kv.first].build(kv.first, kv.second);
+    }
+
     // Spacecraft
     for (const auto& spacecraftData : _spacecraftInitData)
     {
-        auto spacecraft = new Spacecraft(this, spacecraftData.name);
+        addSpacecraft(createSpacecraft(spacecraftData));
+    }
+
+    return true;
+}
 
-        spacecraft->setArea(spacecraftData.area);
-        spacecraft->setMass(spacecraftData.mass);
-        spacecraft->setAngularVelocity(spacecraftData.angularVelocity);
-        spacecraft->setMaxVelocity(spacecraftData.maxVelocity);
-        //spacecraft->setTargetVelocity(Vector3<double>(spacecraftData.targetVelX, spacecraftData.targetVelY, spacecraftData.targetVelZ));
-        //spacecraft->setTargetAcceleration(Vector3<double>(spacecraftData.targetAccX, spacecraftData.targetAccY, spacecraftData.targetAccZ));
 
-        addSpacecraft(spacecraft);
+/**
+ * Builds a spacecraft from its initialization data. The caller owns the spacecraft;
+ * it is not added to the scenario.
+ *
+ * @param spacecraftData The initialization data.
+ *
+ * @return The new spacecraft.
+ */
+Spacecraft* Scenario::createSpacecraft(const SpacecraftInitializationData& spacecraftData)
+{
+    auto spacecraft = new Spacecraft(this, spacecraftData.name);
+
+    spacecraft->setArea(spacecraftData.area);
+    spacecraft->setMass(spacecraftData.mass);
+    spacecraft->setAngularVelocity(spacecraftData.angularVelocity);
+
+    // The spacecraft data has no mass distribution; a uniform cube of the same mass and face area stands in
+    spacecraft->setInertia(InertiaTensor::cube(spacecraftData.mass + spacecraftData.fuelMass, std::sqrt(spacecraftData.area)));
+
+    if (spacecraftData.engine != "none")
+    {
+        auto engine = _engines.find(spacecraftData.engine);
+
+        if (engine == _engines.end())
+        {
+            delete spacecraft;
+            throw std::runtime_error("Error: Spacecraft " + spacecraftData.name + " has engine " + spacecraftData.engine + ", which is not in Engines.csv");
+        }
+
+        spacecraft->setEngine(&engine->second, spacecraftData.fuelMass);
     }
 
-    return true;
+    spacecraft->setMaxVelocity(spacecraftData.maxVelocity);
+    spacecraft->setTargetVelocity(Vector3<double>(spacecraftData.targetVelX, spacecraftData.targetVelY, spacecraftData.targetVelZ));
+    //spacecraft->setTargetAcceleration(Vector3<double>(spacecraftData.targetAccX, spacecraftData.targetAccY, spacecraftData.targetAccZ));
+
+    return spacecraft;
+}
+
+
+/**
+ * Places a spacecraft on its home planet and points it at the target planet of the mission.
+ *
+ * @param spacecraft The spacecraft to set up.
+ */
+void Scenario::setupMission(Spacecraft* spacecraft)
+{
+    // set home planet for spacecraft
+    auto planet = _systems.at(_mission.homeSystem)->getPlanets().at(_mission.homePlanet);
+    spacecraft->setPlanetInformation(planet);
+    spacecraft->setVelocity(spacecraft->getVelocity() + planet->getCenterVelocity());
+
+    attachForces(spacecraft, planet);
+
+    // set target for spacecraft
+    planet = _systems.at(_mission.targetSystem)->getPlanets().at(_mission.targetPlanet);
+    spacecraft->setTargetPlanet(planet);
+
+    // leave on the cheapest planned transfer
+    uint32_t departure, arrival;
+    if (_transfer.isBuilt() && _transfer.findBest(departure, arrival))
+    {
+        spacecraft->setTargetVelocity(_transfer.getDepartureVelocity(departure, arrival));
+    }
+}
+
+
+/**
+ * Sets the mission's force pipeline on a spacecraft, with gravity taken about a central body in
+ * its own system, and the mission's coast tolerance. Does nothing when the mission has no forces.
+ *
+ * @param spacecraft The spacecraft to apply the forces to.
+ * @param centralBody The planet gravity is taken about.
+ */
+void Scenario::attachForces(Spacecraft* spacecraft, Planet* centralBody)
+{
+    if (_mission.forces.empty())
+    {
+        return;
+    }
+
+    spacecraft->setForces(findForcePipeline(_mission.forces).acceleration, ForceContext(centralBody, _systems.at(centralBody->getSystemName())));
+    spacecraft->setCoastTolerance(_mission.coastTolerance);
+}
+
+
+/**
+ * Opens the ephemeris the planets move on, generating it first when the file at path is missing
+ * or was made from other planets or another span.
+ *
+ * @param path File the ephemeris is cached in.
+ * @param span Seconds of mission time the ephemeris covers.
+ */
+void Scenario::loadEphemeris(const std::string& path, double span)
+{
+    auto fingerprint = Ephemeris::fingerprint(_systems, span);
+
+    if (!_ephemeris.open(path) || _ephemeris.getFingerprint() != fingerprint)
+    {
+        std::cout << " - Fitting planet orbits over " << span << " s..." << std::endl;
+        _ephemeris.close();
+        Ephemeris::generate(_systems, span, path);
+        _ephemeris.open(path);
+    }
+    else
+    {
+        std::cout << " - Read ephemeris " << path << std::endl;
+    }
+
+    _ephemerisBodies.clear();
+
+    for (const auto& kv : _systems)
+    {
+        for (const auto& pkv : kv.second->getPlanets())
+        {
+            int body = _ephemeris.findBody(pkv.first);
+
+            if (body < 0)
+            {
+                throw std::runtime_error("Error: Planet " + pkv.first + " is not in the ephemeris " + path);
+            }
+
+            _ephemerisBodies.push_back(std::make_pair(pkv.second, body));
+        }
+    }
+}
+
+
+/**
+ * Moves every planet to its place in the ephemeris and everything that depends on where the
+ * planets are: the spheres of influence and the spacecraft's targets and event guards.
+ *
+ * @param time Mission time in seconds.
+ */
+void Scenario::updatePlanets(double time)
+{
+    for (const auto& entry : _ephemerisBodies)
+    {
+        Vector3<double> position, velocity;
+        _ephemeris.getState(entry.second, time, position, velocity);
+        entry.first->setCenterState(position, velocity);
+    }
+
+    for (const auto& kv : _systems)
+    {
+        kv.second->buildSpheresOfInfluence();
+    }
+
+    for (const auto& kv : _spacecraft)
+    {
+        kv.second->followPlanets();
+    }
+}
+
+
+/**
+ * Plans the transfer from the home planet to the target planet. Both must be in the same system;
+ * the transfer is a Lambert arc about the system's primary. The grid spans one Hohmann transfer
+ * time of departures and arrivals from a quarter to three Hohmann times.
+ *
+ * @param path File the table is cached in.
+ * @param threads Threads to solve the grid on.
+ */
+void Scenario::planTransfer(const std::string& path, unsigned int threads)
+{
+    const uint32_t GRID_SIZE = 64;
+
+    if (_mission.homeSystem != _mission.targetSystem)
+    {
+        throw std::runtime_error("Error: Transfers between systems are not supported.");
+    }
+
+    auto system = _systems.at(_mission.homeSystem);
+    auto primary = system->getPrimary();
+    auto home = system->getPlanets().at(_mission.homePlanet);
+    auto target = system->getPlanets().at(_mission.targetPlanet);
+
+    if (!primary || home == primary || target == primary || home == target)
+    {
+        throw std::runtime_error("Error: A transfer needs two planets other than the primary of " + system->getName());
+    }
+
+    const double mu = primary->getGravititationParameter();
+    const double r1 = (home->getCenterPosition() - primary->getCenterPosition()).magnitude();
+    const double r2 = (target->getCenterPosition() - primary->getCenterPosition()).magnitude();
+    const double semiMajorAxis = 0.5 * (r1 + r2);
+    const double hohmann = 3.14159265358979323846 * std::sqrt(semiMajorAxis * semiMajorAxis * semiMajorAxis / mu);
+
+    TimeAxis departures(0.0, hohmann, GRID_SIZE);
+    TimeAxis arrivals(0.25 * hohmann, 3.0 * hohmann, GRID_SIZE);
+
+    // States relative to the primary from the ephemeris where it covers the grid; otherwise the
+    // planets are taken to hold still where they are now
+    int primaryBody = _ephemeris.isOpen() && _ephemeris.getSpan() >= arrivals.at(GRID_SIZE - 1) ? _ephemeris.findBody(primary->getName()) : -1;
+
+    auto ephemeris = [this, primary, primaryBody](Planet* planet) -> BodyEphemeris
+    {
+        int body = primaryBody >= 0 ? _ephemeris.findBody(planet->getName()) : -1;
+
+        if (body < 0)
+        {
+            return [planet, primary](double, Vector3<double>& position, Vector3<double>& velocity)
+            {
+                position = planet->getCenterPosition() - primary->getCenterPosition();
+                velocity = Vector3<double>(0, 0, 0);
+            };
+        }
+
+        return [this, body, primaryBody](double time, Vector3<double>& position, Vector3<double>& velocity)
+        {
+            Vector3<double> origin, originVelocity;
+            _ephemeris.getState(primaryBody, time, origin, originVelocity);
+            _ephemeris.getState(body, time, position, velocity);
+
+            position = position - origin;
+            velocity = velocity - originVelocity;
+        };
+    };
+
+    // The table is only reused for the same planet motion: the ephemeris it was solved from, or
+    // the planets as they stand now
+    const uint64_t source = primaryBody >= 0 ? _ephemeris.getFingerprint() : Ephemeris::fingerprint(_systems, 0.0);
+
+    if (_transfer.load(path) && _transfer.matches(home->getName(), target->getName(), mu, source, departures, arrivals))
+    {
+        std::cout << " - Read transfer table " << path << std::endl;
+    }
+    else
+    {
+        std::cout << " - Solving " << GRID_SIZE * GRID_SIZE << " transfers from " << home->getName() << " to " << target->getName() << " about " << primary->getName() << "..." << std::endl;
+        _transfer.generate(home->getName(), ephemeris(home), target->getName(), ephemeris(target), mu, source, departures, arrivals, threads);
+        _transfer.save(path);
+    }
+
+    uint32_t departure, arrival;
+    if (!_transfer.findBest(departure, arrival))
+    {
+        std::cout << " - No transfer found." << std::endl;
+        return;
+    }
+
+    std::cout << " - Cheapest transfer departs at " << departures.at(departure) << " s and arrives at " << arrivals.at(arrival)
+        << " s, delta-v " << _transfer.getDepartureDeltaV(departure, arrival) << " + " << _transfer.getArrivalDeltaV(departure, arrival) << std::endl;
 }
 
 
 // return code not 0 means error
 // 1 : There is not just 1 spacecraft loaded into scenario.
+// 2 : Stopped by a signal and the checkpoint to resume from could not be written.
 int Scenario::runSimulation()
 {
-    for (const auto& kv2 : _systems)
+    // Input data was already logged by the run that wrote the checkpoint
+    if (!_restored)
     {
-        for (const auto& kv : kv2.second->getPlanets())
+        _database->logRunMetadata("masterSeed", std::to_string(getMasterSeed()));
+        _database->logRunMetadata("randomGenerator", "Philox4x32-10");
+
+        for (const auto& kv2 : _systems)
         {
-            auto planet = kv.second;
+            for (const auto& kv : kv2.second->getPlanets())
+            {
+                auto planet = kv.second;
 
-            _database->logPlanetData(planet);
+                _database->logPlanetData(planet);
+            }
         }
     }
 
@@ -133,21 +450,56 @@ int Scenario::runSimulation()
 
     std::cout << " - Running Continuous Simulation Loop..." << std::endl;
 
-    // set home planet for spacecraft
-    auto planet = _systems.at("Pok'Tul Zar")->getPlanets().at("Smeg");
-    spacecraft->setPlanetInformation(planet);
+    // A restored spacecraft already has its home and target planets and its central body; only
+    // its forces, which are not state, are set again
+    if (!_restored)
+    {
+        if (_ephemeris.isOpen())
+        {
+            updatePlanets(_currentTimestamp);
+        }
 
-    // set target for spacecraft
-    planet = _systems.at("Pok'Tul Zar")->getPlanets().at("Tha Nal");
-    spacecraft->setTargetPlanet(planet);
+        setupMission(spacecraft);
+    }
+    else
+    {
+        auto centralBody = spacecraft->getCentralBody();
+        attachForces(spacecraft, centralBody ? centralBody : _systems.at(_mission.homeSystem)->getPlanets().at(_mission.homePlanet));
+    }
+
+    // log every detected event
+    spacecraft->getEventDetector().registerCallback([this](const SimulationEvent& event) { _database->logEvent(event); });
 
-    int t = 0;
     //while  (spacecraft->getPosition().magnitude() < spacecraft->getPlanet().getRadius() + 100e3)
-    while(!equalVectors(spacecraft->getPosition(), spacecraft->getTargetPlanet().targetPosition) && t < 100)
+    // Each stage runs at its own period on a timeline of base steps. Stages due on the same step
+    // run in this order, which matches ControlSystem::update followed by telemetry.
+    Scheduler scheduler(_mission.timeStep);
+    findPipeline(_mission.pipeline).schedule(scheduler, spacecraft, _mission.guidancePeriod, _mission.controlPeriod, _mission.dynamicsPeriod);
+    scheduler.addStage("telemetry", _mission.telemetryPeriod, [this, spacecraft](double, double)
+    {
+        _database->logSimData(_currentStep, spacecraft->getPosition(), spacecraft->getVelocity(), spacecraft->getAcceleration());
+    }, false);
+
+    // Hold each base step to a fixed wall clock frame when running paced
+    std::unique_ptr<RealTimePacer> pacer;
+    if (_mission.realTimeFactor > 0)
     {
+        pacer.reset(new RealTimePacer(_mission.timeStep / _mission.realTimeFactor));
+        pacer->start();
+    }
+
+    int stopError = 0;
+
+    while(!equalVectors(spacecraft->getPosition(), spacecraft->getTargetPlanet().targetPosition) && !spacecraft->isLanded() && _currentStep < _mission.maxSteps)
+    {
+
+        if (_ephemeris.isOpen())
+        {
+            updatePlanets(_currentTimestamp);
+        }
 
         // std::cout << "Time: " << t << std::endl;
-        spacecraft->update(1);
+        scheduler.runTick(_currentStep, pacer && _mission.skipNonCriticalOnOverrun && pacer->isBehind());
 
 #if 0
         std::cout << "Time: " << t << std::endl;
@@ -158,13 +510,49 @@ int Scenario::runSimulation()
         std::cout << "Thrust: " << spacecraft->getThrust().x << ", " << spacecraft->getThrust().y << ", " << spacecraft->getThrust().z << std::endl;
         std::cout << "---------------------------------------------------" << std::endl;
 #endif
-        _database->logSimData(t, spacecraft->getPosition(), spacecraft->getVelocity(), spacecraft->getAcceleration());
 
-        t += 1;
+        _currentStep += 1;
+        _currentTimestamp += _mission.timeStep;
+
+        if (checkpointRequest == 2)
+        {
+            std::cout << " - Checkpoint requested by signal. Stopping at step " << _currentStep << "..." << std::endl;
+            checkpointRequest = 0;
+
+            // The run cannot be resumed without this one, so it waits for any write in flight
+            if (!saveCheckpoint(true))
+            {
+                std::cerr << "Error: No checkpoint was written on stop. The run cannot be resumed from step " << _currentStep << "." << std::endl;
+                stopError = 2;
+            }
+            break;
+        }
+
+        if (checkpointRequest == 1 || (_checkpointInterval > 0 && _currentStep % _checkpointInterval == 0))
+        {
+            checkpointRequest = 0;
+            saveCheckpoint();
+        }
+
+        if (pacer)
+        {
+            pacer->waitForNextFrame();
+        }
     }
 
+    // Make sure the last checkpoint is on disk before returning
+    _checkpointWriter.wait();
+
     std::cout << " - Finished Continuous Simulation Loop..." << std::endl;
-    return 0;
+
+    scheduler.printReport();
+
+    if (pacer)
+    {
+        pacer->printReport();
+    }
+
+    return stopError;
 }
 
 void Scenario::addSpacecraft(Spacecraft* spacecraft)
@@ -177,6 +565,226 @@ void Scenario::addSystem(System* system)
     _systems.emplace(system->getName(), system);
 }
 
+Planet* Scenario::findPlanet(const std::string& name)
+{
+    for (const auto& kv : _systems)
+    {
+        auto& planets = kv.second->getPlanets();
+        auto i = planets.find(name);
+
+        if (i != planets.end())
+        {
+            return i->second;
+        }
+    }
+
+    return nullptr;
+}
+
+/**
+ * Serializes the complete simulation state into a binary buffer.
+ *
+ * @return The checkpoint bytes, ready to be written to disk.
+ */
+std::vector<char> Scenario::snapshotState() const
+{
+    BinaryWriter writer;
+
+    writer.write(CHECKPOINT_MAGIC);
+    writer.write(CHECKPOINT_VERSION);
+
+    writer.write(_currentStep);
+    writer.write(_currentTimestamp);
+
+    // Random streams are derived from the master seed. Their draw counts are saved with each entity.
+    writer.write(getMasterSeed());
+
+    // The forces are functions, so they are saved by the mission settings they were made from
+    writer.writeString(_mission.forces);
+    writer.write(_mission.coastTolerance);
+
+    // Planets
+    uint32_t planetCount = 0;
+    for (const auto& kv : _systems)
+    {
+        planetCount += static_cast<uint32_t>(kv.second->getPlanets().size());
+    }
+
+    writer.write(planetCount);
+
+    for (const auto& kv : _systems)
+    {
+        for (const auto& kv2 : kv.second->getPlanets())
+        {
+            writer.writeString(kv.first);
+            writer.writeString(kv2.first);
+            kv2.second->saveState(writer);
+        }
+    }
+
+    // Spacecraft
+    writer.write(static_cast<uint32_t>(_spacecraft.size()));
+
+    for (const auto& kv : _spacecraft)
+    {
+        writer.writeString(kv.first);
+        kv.second->saveState(writer);
+    }
+
+    return std::move(writer.getBuffer());
+}
+
+
+/**
+ * Restores the simulation state from a checkpoint buffer. The scenario must already be compiled
+ * from the same input files as the run that wrote the checkpoint.
+ *
+ * @param buffer The checkpoint bytes.
+ */
+void Scenario::restoreState(std::vector<char> buffer)
+{
+    BinaryReader reader(std::move(buffer));
+
+    char magic[sizeof(CHECKPOINT_MAGIC)];
+    for (auto& c : magic)
+    {
+        c = reader.read<char>();
+    }
+
+    if (std::memcmp(magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0)
+    {
+        throw std::runtime_error("Error: File is not a spacecraft simulation checkpoint.");
+    }
+
+    auto version = reader.read<uint32_t>();
+    if (version != CHECKPOINT_VERSION)
+    {
+        throw std::runtime_error("Error: Unsupported checkpoint version " + std::to_string(version));
+    }
+
+    reader.read(_currentStep);
+    reader.read(_currentTimestamp);
+
+    setMasterSeed(reader.read<uint64_t>());
+
+    _mission.forces = reader.readString();
+    reader.read(_mission.coastTolerance);
+
+    if (!_mission.forces.empty())
+    {
+        findForcePipeline(_mission.forces);
+    }
+
+    // Planets
+    auto planetCount = reader.read<uint32_t>();
+
+    for (uint32_t i = 0; i < planetCount; i++)
+    {
+        auto systemName = reader.readString();
+        auto planetName = reader.readString();
+
+        auto system = _systems.find(systemName);
+        if (system == _systems.end() || system->second->getPlanets().find(planetName) == system->second->getPlanets().end())
+        {
+            throw std::runtime_error("Error: Checkpoint planet " + planetName + " in system " + systemName + " is not in the scenario.");
+        }
+
+        system->second->getPlanets().at(planetName)->loadState(reader);
+    }
+
+    // Spacecraft
+    auto spacecraftCount = reader.read<uint32_t>();
+
+    for (uint32_t i = 0; i < spacecraftCount; i++)
+    {
+        auto name = reader.readString();
+
+        auto spacecraft = _spacecraft.find(name);
+        if (spacecraft == _spacecraft.end())
+        {
+            throw std::runtime_error("Error: Checkpoint spacecraft " + name + " is not in the scenario.");
+        }
+
+        spacecraft->second->loadState(reader);
+    }
+
+    _restored = true;
+}
+
+
+/**
+ * Snapshots the state on the calling thread and writes it to the checkpoint path in the background.
+ *
+ * @param wait Finish the write in flight and write this checkpoint before returning, so it is never dropped.
+ *
+ * @return True if the write was started, or with wait made. False if the previous checkpoint is
+ *         still being written, or with wait if the file could not be written.
+ */
+bool Scenario::saveCheckpoint(bool wait)
+{
+    if (_checkpointPath.empty())
+    {
+        return false;
+    }
+
+    if (wait)
+    {
+        _checkpointWriter.wait();
+
+        if (!writeCheckpointFile(snapshotState(), _checkpointPath))
+        {
+            std::cerr << "Error: Could not write checkpoint file " << _checkpointPath << " at step " << _currentStep << "." << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    if (!_checkpointWriter.writeAsync(snapshotState(), _checkpointPath))
+    {
+        std::cerr << "Previous checkpoint is still being written. Skipping checkpoint at step " << _currentStep << "." << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * Restores a checkpoint file and discards any data the crashed run logged after it.
+ *
+ * @param filepath The path to the checkpoint file.
+ *
+ * @return True if the checkpoint was restored.
+ */
+bool Scenario::restoreCheckpoint(const std::string& filepath)
+{
+    restoreState(readCheckpointFile(filepath));
+
+    _database->deleteSimDataAfter(_currentStep, _currentTimestamp);
+
+    std::cout << " - Restored checkpoint " << filepath << " at step " << _currentStep << "." << std::endl;
+    return true;
+}
+
+
+/**
+ * SIGINT and SIGTERM write a checkpoint and stop the simulation loop.
+ * SIGUSR1 (SIGBREAK on Windows) writes a checkpoint and keeps running.
+ */
+void Scenario::installCheckpointSignalHandlers()
+{
+    std::signal(SIGINT, onCheckpointSignal);
+    std::signal(SIGTERM, onCheckpointSignal);
+#ifdef SIGUSR1
+    std::signal(SIGUSR1, onCheckpointSignal);
+#endif
+#ifdef SIGBREAK
+    std::signal(SIGBREAK, onCheckpointSignal);
+#endif
+}
+
+
 /**
  * Loads system initialization data from a CSV file.
  *
@@ -296,8 +904,9 @@ bool Scenario::loadSpacecraftFromFile(const std::string & filepath)
     parser.next();
 
     // Verify the headers in the file
-    std::vector<std::string> headers = { "name","area","mass","angularVelocity","maxVelocity","targetVelocityX","targetVelocityY","targetVelocitZ","targetAccelerationX","targetAccelerationY","targetAccelerationZ" };
-    parser.verifyHeaders(headers);
+    // engine and fuelMass are optional; without them a spacecraft has no engine
+    std::vector<std::string> headers = { "name","area","mass","angularVelocity","maxVelocity","targetVelocityX","targetVelocityY","targetVelocitZ","targetAccelerationX","targetAccelerationY","targetAccelerationZ","engine","fuelMass" };
+    size_t columns = parser.verifyHeaders(headers, 11);
 
     // Skip the headers line
     parser.next();
@@ -323,6 +932,8 @@ bool Scenario::loadSpacecraftFromFile(const std::string & filepath)
         spacecraftInit.targetAccX = parser.convertRowToDouble(row[8]);;
         spacecraftInit.targetAccY = parser.convertRowToDouble(row[9]);;
         spacecraftInit.targetAccZ = parser.convertRowToDouble(row[10]);;
+        spacecraftInit.engine = columns > 11 && row.size() > 11 ? row[11] : "none";
+        spacecraftInit.fuelMass = columns > 12 && row.size() > 12 ? parser.convertRowToDouble(row[12]) : 0.0;
 
         // Add the init object
         _spacecraftInitData.push_back(spacecraftInit);
@@ -333,6 +944,81 @@ bool Scenario::loadSpacecraftFromFile(const std::string & filepath)
 }
 
 
+/**
+ * Loads fully normalized spherical harmonic coefficients of the planets from a CSV file.
+ *
+ * @param filepath The path to the CSV file.
+ *
+ * @return True if the file was loaded successfully, false otherwise.
+ */
+bool Scenario::loadHarmonicsFromFile(const std::string& filepath)
+{
+    CSVParser parser = CSVParser(filepath);
+
+    parser.verifyFile("Harmonics.csv");
+    parser.next();
+
+    std::vector<std::string> headers = { "systemName","planetName","degree","order","C","S" };
+    parser.verifyHeaders(headers);
+    parser.next();
+
+    while (parser.isValid())
+    {
+        auto row = parser.getRow();
+
+        auto harmonicInit = HarmonicInitializationData();
+
+        harmonicInit.systemName = row[0];
+        harmonicInit.planetName = row[1];
+        harmonicInit.degree = parser.convertRowToInt(row[2]);
+        harmonicInit.order = parser.convertRowToInt(row[3]);
+        harmonicInit.c = parser.convertRowToDouble(row[4]);
+        harmonicInit.s = parser.convertRowToDouble(row[5]);
+
+        _harmonicInitData.push_back(harmonicInit);
+    }
+
+    return true;
+}
+
+
+/**
+ * Loads engine thrust curves from a CSV file, one row per sample. The rows of an engine are in
+ * time order from ignition.
+ *
+ * @param filepath The path to the CSV file.
+ *
+ * @return True if the file was loaded successfully, false otherwise.
+ */
+bool Scenario::loadEnginesFromFile(const std::string& filepath)
+{
+    CSVParser parser = CSVParser(filepath);
+
+    parser.verifyFile("Engines.csv");
+    parser.next();
+
+    std::vector<std::string> headers = { "name","time","thrust","isp" };
+    parser.verifyHeaders(headers);
+    parser.next();
+
+    while (parser.isValid())
+    {
+        auto row = parser.getRow();
+
+        auto engineInit = EngineInitializationData();
+
+        engineInit.name = row[0];
+        engineInit.time = parser.convertRowToDouble(row[1]);
+        engineInit.thrust = parser.convertRowToDouble(row[2]);
+        engineInit.isp = parser.convertRowToDouble(row[3]);
+
+        _engineInitData.push_back(engineInit);
+    }
+
+    return true;
+}
+
+
 /*
 // Default values
     auto default_vector = VecDouble(0, 0, 0);
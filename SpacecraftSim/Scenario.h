@@ -1,3 +1,10 @@
+#ifndef SCENARIO_H
+#define SCENARIO_H
+
+#include "Checkpoint.h"
+#include "Ephemeris.h"
+#include "Porkchop.h"
+#include "Propulsion.h"
 #include "Vector3.h"
 
 #include "random_gen.h"
@@ -8,6 +15,7 @@
 const double epsilon = 0.001;
 
 class Database;
+class Planet;
 class Spacecraft;
 class System;
 
@@ -27,6 +35,32 @@ struct PlanetInitializationData
     double atmoRadius;
 };
 
+// One fully normalized spherical harmonic coefficient pair of a planet
+struct HarmonicInitializationData
+{
+    HarmonicInitializationData() {}
+    ~HarmonicInitializationData() {}
+
+    std::string systemName;
+    std::string planetName;
+    int degree;
+    int order;
+    double c;
+    double s;
+};
+
+// One point of an engine's thrust curve
+struct EngineInitializationData
+{
+    EngineInitializationData() {}
+    ~EngineInitializationData() {}
+
+    std::string name;
+    double time;
+    double thrust;
+    double isp;
+};
+
 struct SystemInitializationData
 {
     SystemInitializationData() {}
@@ -51,6 +85,37 @@ struct SpacecraftInitializationData
     double targetAccX;
     double targetAccY;
     double targetAccZ;
+    std::string engine;     // "none" for no engine
+    double fuelMass;
+};
+
+
+// Where the spacecraft starts and where it is sent
+struct MissionDefinition
+{
+    MissionDefinition() : homeSystem("Pok'Tul Zar"), homePlanet("Smeg"), targetSystem("Pok'Tul Zar"), targetPlanet("Tha Nal"), timeStep(1.0), maxSteps(100), pipeline("standard"), coastTolerance(0.0),
+        dynamicsPeriod(1.0), controlPeriod(1.0), guidancePeriod(1.0), telemetryPeriod(1.0), realTimeFactor(0.0), skipNonCriticalOnOverrun(false) {}
+    ~MissionDefinition() {}
+
+    std::string homeSystem;
+    std::string homePlanet;
+    std::string targetSystem;
+    std::string targetPlanet;
+    double timeStep;    // base step of the scheduler; every period is a whole multiple of it
+    int maxSteps;
+    std::string pipeline;   // name of the step pipeline, see Pipeline.h
+    std::string forces;     // name of the force pipeline about the home planet, see ForcePipeline.h; empty for none
+    double coastTolerance;  // perturbation below which arcs are propagated as conics, see ControlSystem::setCoastTolerance; 0, the default, never coasts
+
+    // Stage periods used by runSimulation
+    double dynamicsPeriod;
+    double controlPeriod;
+    double guidancePeriod;
+    double telemetryPeriod;
+
+    // Paced execution. 0 runs free; otherwise one base step takes timeStep / realTimeFactor seconds of wall clock time.
+    double realTimeFactor;
+    bool skipNonCriticalOnOverrun;  // skip telemetry on the frame after an overrun so the loop can catch up
 };
 
 
@@ -74,6 +139,48 @@ class Scenario
         std::map<std::string, Spacecraft*>& getSpacecraft() { return _spacecraft; }
         std::map<std::string, System*>& getSystems() { return _systems; }
 
+        Planet* findPlanet(const std::string& name);
+
+        // Engines from Engines.csv by name, built by compile()
+        const std::map<std::string, Engine>& getEngines() const { return _engines; }
+
+        Spacecraft* createSpacecraft(const SpacecraftInitializationData& spacecraftData);
+        void setupMission(Spacecraft* spacecraft);
+
+        // The mission's force pipeline and coast tolerance about a central body; nothing without forces
+        void attachForces(Spacecraft* spacecraft, Planet* centralBody);
+        MissionDefinition& getMission() { return _mission; }
+
+        std::vector<SpacecraftInitializationData>& getSpacecraftInitData() { return _spacecraftInitData; }
+
+        // Lambert transfers from the home to the target planet about their system's primary over a
+        // porkchop grid, read from path when it holds a table for the same transfer and generated and
+        // written there otherwise. setupMission then seeds the target velocity from the cheapest cell.
+        void planTransfer(const std::string& path, unsigned int threads);
+        const PorkchopTable& getTransferTable() const { return _transfer; }
+
+        // Moving planets. Reads the ephemeris at path when it was generated from these planets over
+        // the same span, and generates it there otherwise. runSimulation then moves the planets
+        // to the ephemeris at the start of every step.
+        void loadEphemeris(const std::string& path, double span);
+        void updatePlanets(double time);
+        const Ephemeris& getEphemeris() const { return _ephemeris; }
+
+        // Altitude step of the planets' atmosphere tables, built by compile(). 0 keeps the analytic model.
+        void setAtmosphereResolution(double metres) { _atmosphereResolution = metres; }
+
+        // Checkpoint methods
+        void setCheckpointPath(const std::string& filepath) { _checkpointPath = filepath; }
+        void setCheckpointInterval(int steps) { _checkpointInterval = steps; }
+        std::vector<char> snapshotState() const;
+        void restoreState(std::vector<char> buffer);
+        bool saveCheckpoint(bool wait = false);
+        bool restoreCheckpoint(const std::string& filepath);
+        static void installCheckpointSignalHandlers();
+
+        int getCurrentStep() const { return _currentStep; }
+        double getCurrentTimestamp() const { return _currentTimestamp; }
+
         bool equalVectors(Vector3<double> a, Vector3<double> b) {
             return fabs(a.x - b.x) < epsilon
                 && fabs(a.y - b.y) < epsilon
@@ -85,13 +192,26 @@ class Scenario
         bool loadSystemsFromFile(const std::string& filepath);
         bool loadPlanetsFromFile(const std::string& filepath);
         bool loadSpacecraftFromFile(const std::string& filepath);
+        bool loadHarmonicsFromFile(const std::string& filepath);
+        bool loadEnginesFromFile(const std::string& filepath);
 
-        std::vector<SpacecraftInitializationData>& getSpacecraftInitData() { return _spacecraftInitData; }
         std::vector<SystemInitializationData>& getSystemInitData() { return _systemInitData; }
         std::vector<PlanetInitializationData>& getPlanetInitData() { return _planetInitData; }
 
+        int _currentStep;
         double _currentTimestamp;
-        
+        bool _restored;
+
+        MissionDefinition _mission;
+        double _atmosphereResolution;
+        PorkchopTable _transfer;
+        Ephemeris _ephemeris;
+        std::vector<std::pair<Planet*, int>> _ephemerisBodies;     // planets and their bodies in the ephemeris
+
+        std::string _checkpointPath;
+        int _checkpointInterval;
+        CheckpointWriter _checkpointWriter;
+
         Database* _database;
 
         std::map<std::string, Spacecraft*> _spacecraft;
@@ -101,5 +221,10 @@ class Scenario
         std::vector<SpacecraftInitializationData> _spacecraftInitData;
         std::vector<SystemInitializationData> _systemInitData;
         std::vector<PlanetInitializationData> _planetInitData;
+        std::vector<HarmonicInitializationData> _harmonicInitData;
+        std::vector<EngineInitializationData> _engineInitData;
+
+        std::map<std::string, Engine> _engines;
 };
 
+#endif // SCENARIO_H
@@ -0,0 +1,83 @@
+#include "Scheduler.h"
+
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+Scheduler::Scheduler(double baseStep) : _baseStep(baseStep)
+{
+    if (!(baseStep > 0))
+    {
+        throw std::runtime_error("Error: Scheduler base step must be positive.");
+    }
+}
+
+void Scheduler::addStage(const std::string& name, double period, ScheduledStage::StageFunction run, bool critical)
+{
+    double ticks = period / _baseStep;
+    double rounded = std::round(ticks);
+
+    if (rounded < 1 || std::fabs(ticks - rounded) > 1e-9 * rounded)
+    {
+        throw std::runtime_error("Error: Period of stage " + name + " = " + std::to_string(period)
+            + " is not a whole multiple of the base step " + std::to_string(_baseStep));
+    }
+
+    _stages.push_back(ScheduledStage(name, static_cast<uint64_t>(rounded), rounded * _baseStep, run, critical));
+}
+
+void Scheduler::runTick(uint64_t tick, bool skipNonCritical)
+{
+    double time = tick * _baseStep;
+
+    for (auto& stage : _stages)
+    {
+        if (tick % stage.periodTicks != 0)
+        {
+            continue;
+        }
+
+        if (skipNonCritical && !stage.critical)
+        {
+            stage.skipped++;
+            continue;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+
+        stage.run(time, stage.period);
+
+        stage.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        stage.executions++;
+    }
+}
+
+void Scheduler::printReport() const
+{
+    double total = 0.0;
+    for (const auto& stage : _stages)
+    {
+        total += stage.seconds;
+    }
+
+    std::cout << " - Stage timing:" << std::endl;
+    std::cout << std::left << std::setw(14) << "   stage" << std::right
+        << std::setw(10) << "period" << std::setw(12) << "runs" << std::setw(10) << "skipped"
+        << std::setw(14) << "total ms" << std::setw(14) << "us per run" << std::setw(10) << "share" << std::endl;
+
+    for (const auto& stage : _stages)
+    {
+        double perRun = stage.executions > 0 ? stage.seconds / stage.executions : 0.0;
+        double share = total > 0 ? 100.0 * stage.seconds / total : 0.0;
+
+        std::cout << std::left << std::setw(14) << "   " + stage.name << std::right << std::fixed
+            << std::setw(10) << std::setprecision(3) << stage.period
+            << std::setw(12) << stage.executions
+            << std::setw(10) << stage.skipped
+            << std::setw(14) << std::setprecision(3) << stage.seconds * 1e3
+            << std::setw(14) << std::setprecision(3) << perRun * 1e6
+            << std::setw(9) << std::setprecision(1) << share << "%" << std::defaultfloat << std::endl;
+    }
+}
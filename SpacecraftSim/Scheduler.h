@@ -0,0 +1,59 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// A unit of work that runs every `period` seconds of simulation time
+struct ScheduledStage
+{
+    typedef std::function<void(double time, double dt)> StageFunction;
+
+    ScheduledStage() {}
+    ScheduledStage(std::string _name, uint64_t _periodTicks, double _period, StageFunction _run, bool _critical) :
+        name(_name), periodTicks(_periodTicks), period(_period), run(_run), critical(_critical), executions(0), skipped(0), seconds(0.0) {}
+    ~ScheduledStage() {}
+
+    std::string name;
+    uint64_t periodTicks;   // period as a whole number of base ticks
+    double period;
+    StageFunction run;
+    bool critical;          // non-critical stages may be skipped when the loop falls behind
+
+    // Profiling
+    uint64_t executions;
+    uint64_t skipped;
+    double seconds;
+};
+
+
+// Runs stages at independent rates on one timeline of base ticks. A stage runs on every tick
+// that is a multiple of its period, so the schedule depends only on the tick number: it is
+// deterministic and resumes from a checkpoint without extra state. Stages that are due on the
+// same tick run in the order they were added.
+class Scheduler
+{
+    public:
+        Scheduler(double baseStep);
+        ~Scheduler() {}
+
+        // The period is rounded to a whole number of base ticks. Throws if it is not close to one.
+        void addStage(const std::string& name, double period, ScheduledStage::StageFunction run, bool critical = true);
+
+        // Runs every stage due at `tick`. With skipNonCritical set, due stages that are not critical are counted as skipped instead.
+        void runTick(uint64_t tick, bool skipNonCritical = false);
+
+        double getBaseStep() const { return _baseStep; }
+        const std::vector<ScheduledStage>& getStages() const { return _stages; }
+
+        // Per-stage execution counts and time spent, with each stage's share of the total
+        void printReport() const;
+
+    protected:
+        double _baseStep;
+        std::vector<ScheduledStage> _stages;
+};
+
+#endif // SCHEDULER_H
@@ -1,10 +1,12 @@
 #include "Spacecraft.h"
+#include "Scenario.h"
 #include "random_gen.h"
 
 #include <cmath>
 #include <iostream>
 
-Spacecraft::Spacecraft(Scenario* scenario, std::string name) : ControlSystem(this), _scenario(scenario), _associatedPlanet(new Planet()), _name(name), _mass(1000) // ,_planet(env)
+Spacecraft::Spacecraft(Scenario* scenario, std::string name) : ControlSystem(this), _scenario(scenario), _associatedPlanet(nullptr), _name(name), _mass(1000), // ,_planet(env)
+    _random(makeRandomStream("spacecraft", name))
 {
 }
 
@@ -12,29 +14,53 @@ Spacecraft::~Spacecraft()
 {
 }
 
-void Spacecraft::update(double elapsedTime)
+void Spacecraft::setPlanetInformation(Planet* planet)
 {
-    // TODO: We will need to check if we are no longer within planet environment
-    
-    // Update the control system based on the new state of the spacecraft and the environment 
-    ControlSystem::update(elapsedTime);
+    setAssociatedPlanet(planet);
+    calcPositionOnPlanet(planet);
+    armEventGuards();
 }
 
 
-void Spacecraft::setPlanetInformation(Planet* planet)
+void Spacecraft::saveState(BinaryWriter& writer) const
 {
-    setAssociatedPlanet(planet);
-    calcPositionOnPlanet(planet);
+    ControlSystem::saveState(writer);
+
+    writer.writeString(_associatedPlanet ? _associatedPlanet->getName() : std::string());
+    writer.write(_angularVelocity);
+    writer.write(_mass);
+    writer.write(_area);
+    writer.write(_maxVelocity);
+    writer.write(_random.getDrawCount());
+}
+
+
+void Spacecraft::loadState(BinaryReader& reader)
+{
+    ControlSystem::loadState(reader);
+
+    auto planetName = reader.readString();
+    _associatedPlanet = planetName.empty() ? nullptr : _scenario->findPlanet(planetName);
+
+    reader.read(_angularVelocity);
+    reader.read(_mass);
+    reader.read(_area);
+    reader.read(_maxVelocity);
+
+    // The master seed has been restored by now, so the stream is rebuilt from it
+    _random = makeRandomStream("spacecraft", _name);
+    _random.setDrawCount(reader.read<uint64_t>());
+
+    // Guards are derived from the associated and target planets
+    armEventGuards();
 }
 
 
 void Spacecraft::calcPositionOnPlanet(Planet* planet)
 {
     // Calculate a random position on the surface of the planet
-    std::uniform_real_distribution<double> dist_theta(-PI_SHORT, PI_SHORT);
-    std::uniform_real_distribution<double> dist_phi(0, 2 * PI_SHORT);
-    double theta = dist_theta(random_gen);
-    double phi = dist_phi(random_gen);
+    double theta = _random.uniform(-PI_SHORT, PI_SHORT);
+    double phi = _random.uniform(0, 2 * PI_SHORT);
 
     double x = planet->getRadius() * sin(theta) * cos(phi);
     double y = planet->getRadius() * sin(theta) * sin(phi);
@@ -4,7 +4,10 @@
 #include "ControlSystem.h"
 #include "Planet.h"
 #include "Vector3.h"
+#include "random_gen.h"
 
+#include <algorithm>
+#include <iostream>
 #include <vector>
 
 class Scenario;
@@ -21,8 +24,6 @@ public:
 
     std::string getName() const { return _name; }
 
-    void update(double elapsedTime);
-
     void setAngularVelocity(double av) { _angularVelocity = av; }
     const double& getAngularVelocity() { return _angularVelocity; }
 
@@ -31,7 +32,9 @@ public:
     void setArea(double area) { _area = area; }
     void setMaxVelocity(double maxV) { _maxVelocity = maxV; }
 
-    double getMass() const { return _mass; }
+    // Dry mass plus the fuel left; setMass() sets the dry mass
+    double getMass() const { return _mass + _fuelMass; }
+    double getDryMass() const { return _mass; }
     //double getDragCoefficient() const { return _dragCoefficient; }
     double getArea() const { return _area; }
     double getMaxVelocity() const { return _maxVelocity; }
@@ -44,6 +47,10 @@ public:
 
     void setPlanetInformation(Planet* planet);
 
+    // Checkpoint methods
+    void saveState(BinaryWriter& writer) const override;
+    void loadState(BinaryReader& reader) override;
+
     // void applyHeating(float heat);
     // void applyForce(const Vector3& force);
 
@@ -59,6 +66,125 @@ public:
         //double _dragCoefficient;
         double _area;
         double _maxVelocity;
+        RandomStream _random;
 };
 
+
+// The stages of ControlSystem::update, here where Spacecraft is complete so that they inline into
+// ControlSystem::update and the pipelines of Pipeline.h
+
+// Runs the PID chain and holds the commanded velocity until the next controller update
+inline void ControlSystem::updateControllers(double elapsedTime)
+{
+    if (_landed)
+    {
+        return;
+    }
+
+    // Update the position, velocity, and acceleration controllers
+   // _accelerationController.update(elapsedTime, _targetAcceleration, _acceleration);
+    //setAcceleration(_accelerationController.getAcceleration());
+
+    //setVelocity(getVelocity() + getAcceleration() * elapsedTime);
+    //setPosition(getPosition() + getVelocity() * elapsedTime);
+    _positionController.update(elapsedTime, getTargetPosition(), _position);
+    _velocityController.update(elapsedTime, _positionController.getOutput(), _velocity);
+    //_accelerationController.update(elapsedTime, _velocityController.getOutput(), _acceleration);
+    auto acceleration = _velocityController.getOutput();
+    auto velocity = acceleration * elapsedTime;
+
+    Vector3<double> command;
+    command.x = std::clamp(velocity.x, -_spacecraft->getMaxVelocity(), _spacecraft->getMaxVelocity());
+    command.y = std::clamp(velocity.y, -_spacecraft->getMaxVelocity(), _spacecraft->getMaxVelocity());
+    command.z = std::clamp(velocity.z, -_spacecraft->getMaxVelocity(), _spacecraft->getMaxVelocity());
+
+    if (!_engine)
+    {
+        // A new velocity is an impulsive burn, so the spacecraft is not ballistic while the
+        // controllers drive it; the next coast attempt waits until they stop
+        if (command.x != _velocity.x || command.y != _velocity.y || command.z != _velocity.z)
+        {
+            _coasting = false;
+            _coastCountdown = COAST_CHECK_STEPS;
+        }
+
+        _velocity = command;
+        return;
+    }
+
+    // The thrust that would reach the commanded velocity over the step, as a share of what the
+    // engine gives there
+    double force;
+    _thrustDirection = ((command - _velocity) * (_spacecraft->getMass() / elapsedTime)).normalizeAndMagnitude(force);
+
+    double available = _engine->getThrust(_burnTime + 0.5 * elapsedTime);
+    _throttle = available > 0 ? std::min(force / available, 1.0) : 0.0;
+}
+
+
+// Advances the state by one dynamics step and handles any events crossed during it
+inline void ControlSystem::integrate(double elapsedTime)
+{
+    if (_landed)
+    {
+        _missionTime += elapsedTime;
+        return;
+    }
+
+    auto previousPosition = getPosition();
+
+    // The thrust acts on the mass the step starts with
+    double mass = _spacecraft->getMass();
+
+    if (_engine)
+    {
+        setThrust(_thrustDirection * _engine->burn(_throttle, elapsedTime, _burnTime, _fuelMass));
+    }
+
+    if (!coast(elapsedTime))
+    {
+        if (_forces)
+        {
+            _acceleration = _forces(_forceContext, ForceState(getPosition(), getVelocity(), getThrust(), _spacecraft->getArea(), mass, _spacecraft->getMaxVelocity()));
+            setVelocity(getVelocity() + _acceleration * elapsedTime);
+        }
+        else if (_engine)
+        {
+            _acceleration = getThrust() / mass;
+            setVelocity(getVelocity() + _acceleration * elapsedTime);
+        }
+
+        setPosition(getPosition() + getVelocity() * elapsedTime);
+    }
+
+    AttitudeDynamics::step(_attitude, _bodyRate, _inertia, _inverseInertia, _torque + getControlTorque(), elapsedTime);
+
+    handleStepEvents(previousPosition, elapsedTime);
+
+    _missionTime += elapsedTime;
+}
+
+
+inline void ControlSystem::updateGNC() 
+{
+    // Atmosphere exit and target approach are boundary crossings located by the event detector in update()
+
+    // Calculate the error between the current position and the target position
+    Vector3<double> targetError = _spacecraft->getPosition() - getTargetPosition();
+
+    if (targetError.magnitude() == 0)
+    {
+        if (_verbose)
+        {
+            std::cout << "targetError = 0. Spacecraft has landed." << std::endl;
+        }
+
+        setAcceleration(Vector3<double>(0, 0, 0));
+        setVelocity(Vector3<double>(0, 0, 0));
+    }
+
+    // Calculate the desired orientation based on the error
+    _spacecraft->setOrientation(targetError.normalize());
+}
+
 #endif // SPACECRAFT_H
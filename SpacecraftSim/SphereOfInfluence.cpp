@@ -0,0 +1,122 @@
+#include "SphereOfInfluence.h"
+
+#include "Planet.h"
+
+#include <algorithm>
+#include <cmath>
+
+void SphereOfInfluenceIndex::build(const std::vector<Planet*>& planets)
+{
+    _spheres.clear();
+    _nodes.clear();
+
+    for (auto planet : planets)
+    {
+        double radius = planet->getSphereOfInfluence();
+        if (std::isfinite(radius))
+        {
+            _spheres.push_back({ planet->getCenterPosition(), radius * radius, planet->getGravititationParameter(), planet });
+        }
+    }
+
+    if (!_spheres.empty())
+    {
+        _nodes.reserve(2 * _spheres.size() / LEAF_SIZE + 1);
+        buildNode(0, static_cast<int>(_spheres.size()));
+    }
+}
+
+int SphereOfInfluenceIndex::buildNode(int begin, int end)
+{
+    Node node;
+    node.left = node.right = -1;
+    node.begin = begin;
+    node.end = end;
+
+    node.low = node.high = _spheres[begin].center;
+    for (int i = begin; i < end; i++)
+    {
+        double radius = std::sqrt(_spheres[i].radiusSquared);
+        const auto& c = _spheres[i].center;
+
+        node.low = Vector3<double>(std::min(node.low.x, c.x - radius), std::min(node.low.y, c.y - radius), std::min(node.low.z, c.z - radius));
+        node.high = Vector3<double>(std::max(node.high.x, c.x + radius), std::max(node.high.y, c.y + radius), std::max(node.high.z, c.z + radius));
+    }
+
+    int index = static_cast<int>(_nodes.size());
+    _nodes.push_back(node);
+
+    if (end - begin <= LEAF_SIZE)
+    {
+        return index;
+    }
+
+    // Median of the centers along the longest axis
+    auto extent = node.high - node.low;
+    int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+    auto coordinate = [axis](const Sphere& sphere) { return axis == 0 ? sphere.center.x : (axis == 1 ? sphere.center.y : sphere.center.z); };
+
+    int middle = begin + (end - begin) / 2;
+    std::nth_element(_spheres.begin() + begin, _spheres.begin() + middle, _spheres.begin() + end,
+        [&coordinate](const Sphere& a, const Sphere& b) { return coordinate(a) < coordinate(b); });
+
+    int left = buildNode(begin, middle);
+    int right = buildNode(middle, end);
+
+    _nodes[index].left = left;
+    _nodes[index].right = right;
+
+    return index;
+}
+
+Planet* SphereOfInfluenceIndex::find(const Vector3<double>& position) const
+{
+    if (_nodes.empty())
+    {
+        return nullptr;
+    }
+
+    Planet* best = nullptr;
+    double strongest = 0.0;
+
+    // Depth is about log2(n / LEAF_SIZE), far below the stack size
+    int stack[64];
+    int depth = 0;
+    stack[depth++] = 0;
+
+    while (depth > 0)
+    {
+        const Node& node = _nodes[stack[--depth]];
+
+        if (position.x < node.low.x || position.y < node.low.y || position.z < node.low.z
+            || position.x > node.high.x || position.y > node.high.y || position.z > node.high.z)
+        {
+            continue;
+        }
+
+        if (node.left >= 0)
+        {
+            stack[depth++] = node.left;
+            stack[depth++] = node.right;
+            continue;
+        }
+
+        for (int i = node.begin; i < node.end; i++)
+        {
+            const auto& sphere = _spheres[i];
+            double distanceSquared = (position - sphere.center).magnitudeSquared();
+
+            if (distanceSquared <= sphere.radiusSquared)
+            {
+                double pull = sphere.mu / std::max(distanceSquared, 1e-300);
+                if (!best || pull > strongest)
+                {
+                    best = sphere.planet;
+                    strongest = pull;
+                }
+            }
+        }
+    }
+
+    return best;
+}
@@ -0,0 +1,61 @@
+#ifndef SPHEREOFINFLUENCE_H
+#define SPHEREOFINFLUENCE_H
+
+#include "Vector3.h"
+
+#include <cmath>
+#include <vector>
+
+class Planet;
+
+// Laplace sphere of influence of a body of mass m at distance d from a body of mass M
+inline double sphereOfInfluenceRadius(double distance, double mass, double parentMass)
+{
+    return distance * std::pow(mass / parentMass, 0.4);
+}
+
+
+// Bounding volume hierarchy over the spheres of influence of a system's planets. Nodes split the
+// spheres at the median of their centers along the longest axis of their bounds, so a lookup
+// descends O(log n) nodes when the spheres do not pile up on each other.
+class SphereOfInfluenceIndex
+{
+    public:
+        SphereOfInfluenceIndex() {}
+        ~SphereOfInfluenceIndex() {}
+
+        // Planets with a finite Planet::getSphereOfInfluence
+        void build(const std::vector<Planet*>& planets);
+
+        // The planet whose sphere holds the position; where spheres overlap, the one pulling
+        // hardest. nullptr outside every sphere.
+        Planet* find(const Vector3<double>& position) const;
+
+        size_t size() const { return _spheres.size(); }
+
+    protected:
+        // Leaves hold up to this many spheres
+        static const int LEAF_SIZE = 4;
+
+        struct Sphere
+        {
+            Vector3<double> center;
+            double radiusSquared;
+            double mu;
+            Planet* planet;
+        };
+
+        struct Node
+        {
+            Vector3<double> low, high;
+            int left, right;        // children, -1 for a leaf
+            int begin, end;         // spheres of a leaf
+        };
+
+        int buildNode(int begin, int end);
+
+        std::vector<Sphere> _spheres;
+        std::vector<Node> _nodes;
+};
+
+#endif // SPHEREOFINFLUENCE_H
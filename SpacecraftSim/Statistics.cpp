@@ -0,0 +1,171 @@
+#include "Statistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+StreamingStatistics::StreamingStatistics() : _count(0), _mean(0.0), _m2(0.0),
+    _min(std::numeric_limits<double>::infinity()), _max(-std::numeric_limits<double>::infinity())
+{
+}
+
+void StreamingStatistics::add(double value)
+{
+    _count++;
+
+    double delta = value - _mean;
+    _mean += delta / _count;
+    _m2 += delta * (value - _mean);
+
+    if (value < _min)
+    {
+        _min = value;
+    }
+
+    if (value > _max)
+    {
+        _max = value;
+    }
+}
+
+void StreamingStatistics::merge(const StreamingStatistics& other)
+{
+    if (other._count == 0)
+    {
+        return;
+    }
+
+    if (_count == 0)
+    {
+        *this = other;
+        return;
+    }
+
+    double count = static_cast<double>(_count + other._count);
+    double delta = other._mean - _mean;
+
+    _mean += delta * other._count / count;
+    _m2 += other._m2 + delta * delta * _count * other._count / count;
+    _count += other._count;
+
+    if (other._min < _min)
+    {
+        _min = other._min;
+    }
+
+    if (other._max > _max)
+    {
+        _max = other._max;
+    }
+}
+
+double StreamingStatistics::getStandardDeviation() const
+{
+    return sqrt(getVariance());
+}
+
+
+QuantileSketch::QuantileSketch(double relativeAccuracy) : _relativeAccuracy(relativeAccuracy), _count(0), _zeroCount(0)
+{
+    _gamma = (1 + relativeAccuracy) / (1 - relativeAccuracy);
+    _logGamma = log(_gamma);
+}
+
+int QuantileSketch::bucketIndex(double magnitude) const
+{
+    return static_cast<int>(ceil(log(magnitude) / _logGamma));
+}
+
+// Any value in bucket i lies in (gamma^(i-1), gamma^i]. This estimate is within the relative accuracy of all of them.
+double QuantileSketch::bucketValue(int index) const
+{
+    return 2 * pow(_gamma, index) / (_gamma + 1);
+}
+
+void QuantileSketch::add(double value)
+{
+    if (std::isnan(value))
+    {
+        return;
+    }
+
+    _count++;
+
+    if (value > std::numeric_limits<double>::min())
+    {
+        _positive[bucketIndex(value)]++;
+    }
+    else if (value < -std::numeric_limits<double>::min())
+    {
+        _negative[bucketIndex(-value)]++;
+    }
+    else
+    {
+        _zeroCount++;
+    }
+}
+
+void QuantileSketch::merge(const QuantileSketch& other)
+{
+    _count += other._count;
+    _zeroCount += other._zeroCount;
+
+    for (const auto& kv : other._positive)
+    {
+        _positive[kv.first] += kv.second;
+    }
+
+    for (const auto& kv : other._negative)
+    {
+        _negative[kv.first] += kv.second;
+    }
+}
+
+double QuantileSketch::quantile(double q) const
+{
+    if (_count == 0)
+    {
+        return 0.0;
+    }
+
+    uint64_t rank = static_cast<uint64_t>(q * (_count - 1));
+    uint64_t seen = 0;
+
+    // Negative values in ascending order are the largest magnitudes first
+    for (auto i = _negative.rbegin(); i != _negative.rend(); ++i)
+    {
+        seen += i->second;
+        if (seen > rank)
+        {
+            return -bucketValue(i->first);
+        }
+    }
+
+    seen += _zeroCount;
+    if (seen > rank)
+    {
+        return 0.0;
+    }
+
+    for (const auto& kv : _positive)
+    {
+        seen += kv.second;
+        if (seen > rank)
+        {
+            return bucketValue(kv.first);
+        }
+    }
+
+    return bucketValue(_positive.rbegin()->first);
+}
+
+
+double OutcomeStatistics::quantile(double q) const
+{
+    if (_statistics.getCount() == 0)
+    {
+        return 0.0;
+    }
+
+    return std::min(std::max(_sketch.quantile(q), _statistics.getMin()), _statistics.getMax());
+}
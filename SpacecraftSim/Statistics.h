@@ -0,0 +1,85 @@
+#ifndef STATISTICS_H
+#define STATISTICS_H
+
+#include <cstdint>
+#include <map>
+
+// Running count, mean, variance, min and max (Welford). Two accumulators can be merged
+// (Chan et al.), so each worker thread keeps its own and they are combined at the end.
+class StreamingStatistics
+{
+    public:
+        StreamingStatistics();
+        ~StreamingStatistics() {}
+
+        void add(double value);
+        void merge(const StreamingStatistics& other);
+
+        uint64_t getCount() const { return _count; }
+        double getMean() const { return _mean; }
+        double getVariance() const { return _count > 1 ? _m2 / (_count - 1) : 0.0; }
+        double getStandardDeviation() const;
+        double getMin() const { return _min; }
+        double getMax() const { return _max; }
+
+    protected:
+        uint64_t _count;
+        double _mean;
+        double _m2;
+        double _min;
+        double _max;
+};
+
+// Mergeable quantile sketch with a bounded relative error (DDSketch, Masson et al.).
+// Values are counted in logarithmic buckets, so memory grows with the dynamic range of the
+// data instead of the number of values, and the result does not depend on insertion order.
+class QuantileSketch
+{
+    public:
+        QuantileSketch(double relativeAccuracy = 0.001);
+        ~QuantileSketch() {}
+
+        void add(double value);
+        void merge(const QuantileSketch& other);
+
+        // q in [0, 1]. Returns 0 if the sketch is empty.
+        double quantile(double q) const;
+
+        uint64_t getCount() const { return _count; }
+        double getRelativeAccuracy() const { return _relativeAccuracy; }
+
+    protected:
+        int bucketIndex(double magnitude) const;
+        double bucketValue(int index) const;
+
+        double _relativeAccuracy;
+        double _gamma;
+        double _logGamma;
+        uint64_t _count;
+        uint64_t _zeroCount;
+        std::map<int, uint64_t> _positive;
+        std::map<int, uint64_t> _negative;
+};
+
+// Statistics and quantiles of one scalar outcome
+class OutcomeStatistics
+{
+    public:
+        OutcomeStatistics() {}
+        ~OutcomeStatistics() {}
+
+        void add(double value) { _statistics.add(value); _sketch.add(value); }
+        void merge(const OutcomeStatistics& other) { _statistics.merge(other._statistics); _sketch.merge(other._sketch); }
+
+        // Sketch quantile, clamped to the exact min and max so it never leaves the observed range
+        double quantile(double q) const;
+
+        const StreamingStatistics& getStatistics() const { return _statistics; }
+        const QuantileSketch& getSketch() const { return _sketch; }
+
+    protected:
+        StreamingStatistics _statistics;
+        QuantileSketch _sketch;
+};
+
+#endif // STATISTICS_H
@@ -2,7 +2,11 @@
 
 #include "Planet.h"
 
-System::System(const std::string& name) : _name(name)
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+System::System(const std::string& name) : _name(name), _primary(nullptr)
 {
 }
 
@@ -28,3 +32,43 @@ void System::removePlanet(Planet* planet)
         _planets.erase(planet->getName());
     }
 }
+
+void System::buildSpheresOfInfluence()
+{
+    _primary = nullptr;
+
+    for (const auto& kv : _planets)
+    {
+        if (!_primary || kv.second->getMass() > _primary->getMass())
+        {
+            _primary = kv.second;
+        }
+    }
+
+    std::vector<Planet*> planets;
+
+    for (const auto& kv : _planets)
+    {
+        auto planet = kv.second;
+
+        if (planet == _primary)
+        {
+            planet->setSphereOfInfluence(std::numeric_limits<double>::infinity());
+            continue;
+        }
+
+        double distance = (planet->getCenterPosition() - _primary->getCenterPosition()).magnitude();
+        double radius = sphereOfInfluenceRadius(distance, planet->getMass(), _primary->getMass());
+
+        planet->setSphereOfInfluence(std::max(radius, planet->getAtmosphereRadius()));
+        planets.push_back(planet);
+    }
+
+    _spheresOfInfluence.build(planets);
+}
+
+Planet* System::findDominantBody(const Vector3<double>& position) const
+{
+    auto planet = _spheresOfInfluence.find(position);
+    return planet ? planet : _primary;
+}
@@ -1,7 +1,11 @@
 #ifndef SYSTEM_H
 #define SYSTEM_H
 
+#include "SphereOfInfluence.h"
+#include "Vector3.h"
+
 #include <map>
+#include <string>
 
 class Planet;
 
@@ -18,9 +22,21 @@ class System
         std::string getName() const { return _name; }
         std::map<std::string, Planet*>& getPlanets() { return _planets; }
 
+        // Patched conics. Planets.csv has no orbits, so the most massive planet is the primary and
+        // every other planet's sphere of influence comes from its mass ratio to the primary at its
+        // current distance, never smaller than its atmosphere radius. Call after adding planets.
+        void buildSpheresOfInfluence();
+
+        // The planet whose sphere of influence holds a position, the primary outside all of them
+        Planet* findDominantBody(const Vector3<double>& position) const;
+        Planet* getPrimary() const { return _primary; }
+
     protected:
         std::string _name;
         std::map<std::string, Planet*> _planets;
+
+        Planet* _primary;
+        SphereOfInfluenceIndex _spheresOfInfluence;
         
 };
 
@@ -83,6 +83,22 @@ class Vector3 {
             return Vector3(x / m, y / m, z / m);
         }
 
+        // Squared length without the sqrt, for comparisons and for callers that need |v|^2 anyway
+        T magnitudeSquared() const {
+            return x * x + y * y + z * z;
+        }
+
+        // normalize() and magnitude() together with a single sqrt. Gives the same values as
+        // calling both, including the zero vector for zero or infinite magnitudes.
+        Vector3 normalizeAndMagnitude(T& m) const {
+            m = magnitude();
+            if (m == 0) {
+                return Vector3(0, 0, 0);
+            }
+
+            return Vector3(x / m, y / m, z / m);
+        }
+
         T dot(const Vector3 &v) const {
             return x * v.x + y * v.y + z * v.z;
         }
@@ -1,17 +1,133 @@
 #include "Scenario.h"
+#include "Benchmark.h"
 #include "Database.h"
+#include "MonteCarlo.h"
+#include "PIDTuner.h"
+#include "Parallel.h"
 
 #include <iostream>
 #include <map>
+#include <sstream>
+#include <string>
+#include <vector>
 
-int main()
+// Command line options are given as "--name value" pairs
+std::map<std::string, std::string> parseOptions(int argc, char* argv[])
+{
+    std::map<std::string, std::string> options;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+
+        if (arg.rfind("--", 0) != 0)
+        {
+            std::cerr << "Ignoring unexpected argument " << arg << std::endl;
+            continue;
+        }
+
+        if (i + 1 < argc && std::string(argv[i + 1]).rfind("--", 0) != 0)
+        {
+            options[arg.substr(2)] = argv[++i];
+        }
+        else
+        {
+            options[arg.substr(2)] = "";
+        }
+    }
+
+    return options;
+}
+
+int main(int argc, char* argv[])
 {
     std::cout << "Booting up Spacecraft Simulation..." << std::endl;
 
+    auto options = parseOptions(argc, argv);
+
+    // The seed must be set before compile() so every entity derives its random stream from it
+    if (options.count("seed"))
+    {
+        setMasterSeed(std::stoull(options["seed"]));
+    }
+
+    std::cout << " - Master seed = " << getMasterSeed() << std::endl;
+
     Scenario* scenario = new Scenario();
 
+    // A restored run appends to the tables of the run that wrote the checkpoint
+    if (options.count("restore") == 0)
+    {
+        scenario->getDatabase()->dropTables();
+    }
+
     scenario->getDatabase()->createTables();
 
+    if (options.count("checkpoint"))
+    {
+        scenario->setCheckpointPath(options["checkpoint"]);
+    }
+
+    if (options.count("checkpoint-interval"))
+    {
+        scenario->setCheckpointInterval(std::stoi(options["checkpoint-interval"]));
+    }
+
+    // --rates dynamics,control,guidance,telemetry periods in seconds
+    if (options.count("rates"))
+    {
+        std::stringstream rates(options["rates"]);
+        std::string period;
+        std::vector<double*> periods = { &scenario->getMission().dynamicsPeriod, &scenario->getMission().controlPeriod,
+            &scenario->getMission().guidancePeriod, &scenario->getMission().telemetryPeriod };
+
+        for (auto p : periods)
+        {
+            if (std::getline(rates, period, ','))
+            {
+                *p = std::stod(period);
+            }
+        }
+    }
+
+    // --pipeline standard|open-loop|coast
+    if (options.count("pipeline"))
+    {
+        scenario->getMission().pipeline = options["pipeline"];
+    }
+
+    // --forces point-mass|oblate|harmonic|powered|atmospheric|full
+    if (options.count("forces"))
+    {
+        scenario->getMission().forces = options["forces"];
+    }
+
+    // --coast-tolerance relative perturbation below which ballistic arcs are propagated analytically; 0, the default, always integrates
+    if (options.count("coast-tolerance"))
+    {
+        scenario->getMission().coastTolerance = std::stod(options["coast-tolerance"]);
+    }
+
+    // --realtime [factor] paces the loop against the wall clock, 1 by default
+    if (options.count("realtime"))
+    {
+        scenario->getMission().realTimeFactor = options["realtime"].empty() ? 1.0 : std::stod(options["realtime"]);
+    }
+
+    // --atmosphere-resolution metres between atmosphere table entries, 0 for the analytic model
+    if (options.count("atmosphere-resolution"))
+    {
+        scenario->setAtmosphereResolution(std::stod(options["atmosphere-resolution"]));
+    }
+
+    // --degrade skips non-critical stages on the frame after an overrun
+    if (options.count("degrade"))
+    {
+        scenario->getMission().skipNonCriticalOnOverrun = true;
+    }
+
+    Scenario::installCheckpointSignalHandlers();
+
     std::cout << "Loading in files..." << std::endl;
 
     if (!scenario->loadFiles())
@@ -25,8 +141,83 @@ int main()
         std::cout << " - Failed to compile data." << std::endl;
     }
 
-    std::cout << "Running simulation..." << std::endl;
-    auto error_code = scenario->runSimulation();
+    // --ephemeris [file] moves the planets on orbits about their primaries, fitted over --ephemeris-span
+    // seconds (the mission length by default) and cached in the file
+    if (options.count("ephemeris"))
+    {
+        double span = options.count("ephemeris-span") ? std::stod(options["ephemeris-span"]) : scenario->getMission().maxSteps * scenario->getMission().timeStep;
+
+        std::cout << "Loading ephemeris..." << std::endl;
+        scenario->loadEphemeris(options["ephemeris"].empty() ? "planets.ephemeris" : options["ephemeris"], span);
+    }
+
+    // --porkchop [file] plans the transfer to the target planet, cached in the file
+    if (options.count("porkchop"))
+    {
+        unsigned int threads = options.count("threads") ? std::stoi(options["threads"]) : defaultThreadCount();
+
+        std::cout << "Planning transfer..." << std::endl;
+        scenario->planTransfer(options["porkchop"].empty() ? "transfer.porkchop" : options["porkchop"], threads);
+    }
+
+    if (options.count("restore"))
+    {
+        std::cout << "Restoring checkpoint..." << std::endl;
+        scenario->restoreCheckpoint(options["restore"]);
+    }
+
+    int error_code = 0;
+
+    if (options.count("benchmark"))
+    {
+        std::cout << "Running benchmarks..." << std::endl;
+        error_code = runBenchmarks(scenario, options["benchmark"]);
+    }
+    else if (options.count("monte-carlo"))
+    {
+        auto samples = std::stoull(options["monte-carlo"]);
+        unsigned int threads = options.count("threads") ? std::stoi(options["threads"]) : defaultThreadCount();
+
+        std::cout << "Running Monte Carlo with " << samples << " samples on " << threads << " threads..." << std::endl;
+        if (scenario->getEphemeris().isOpen())
+        {
+            std::cout << " - Planets are held at their starting positions; samples do not follow the ephemeris." << std::endl;
+        }
+
+        MonteCarloRunner runner(scenario);
+        auto results = runner.run(samples, threads);
+
+        runner.printResults(results);
+        runner.logResults(results);
+    }
+    else if (options.count("tune"))
+    {
+        unsigned int threads = options.count("threads") ? std::stoi(options["threads"]) : defaultThreadCount();
+        PIDTuner tuner(scenario);
+        std::vector<TuningResult> results;
+
+        if (options["tune"] == "nelder-mead")
+        {
+            int iterations = options.count("iterations") ? std::stoi(options["iterations"]) : 50;
+
+            std::cout << "Tuning PID gains with Nelder-Mead for " << iterations << " iterations on " << threads << " threads..." << std::endl;
+            results.push_back(tuner.nelderMead(TuningCandidate(), iterations, threads));
+        }
+        else
+        {
+            std::cout << "Tuning PID gains with a grid search on " << threads << " threads..." << std::endl;
+            results = tuner.gridSearch({ 0.05, 0.1, 0.2 }, { 0.005, 0.01, 0.02 }, { 0.0005, 0.001, 0.002 },
+                { 0.05, 0.1, 0.2 }, { 0.01 }, { 0.001 }, threads);
+        }
+
+        tuner.printResults(results, 10);
+        tuner.logResults(results);
+    }
+    else
+    {
+        std::cout << "Running simulation..." << std::endl;
+        error_code = scenario->runSimulation();
+    }
 
     if (error_code > 0)
     {
@@ -37,7 +228,7 @@ int main()
 
     delete scenario;
 
-    return 0;
+    return error_code;
 }
 
 
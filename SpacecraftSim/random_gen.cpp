@@ -1,4 +1,132 @@
 #include "random_gen.h"
 
-unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-std::mt19937 random_gen(seed);
+#include <chrono>
+#include <cmath>
+
+static uint64_t masterSeed = std::chrono::system_clock::now().time_since_epoch().count();
+
+std::array<uint32_t, 4> philox4x32(std::array<uint32_t, 4> counter, std::array<uint32_t, 2> key)
+{
+    const uint32_t M0 = 0xD2511F53u;
+    const uint32_t M1 = 0xCD9E8D57u;
+    const uint32_t W0 = 0x9E3779B9u;
+    const uint32_t W1 = 0xBB67AE85u;
+
+    for (int round = 0; round < 10; round++)
+    {
+        uint64_t product0 = static_cast<uint64_t>(M0) * counter[0];
+        uint64_t product1 = static_cast<uint64_t>(M1) * counter[2];
+
+        uint32_t hi0 = static_cast<uint32_t>(product0 >> 32);
+        uint32_t lo0 = static_cast<uint32_t>(product0);
+        uint32_t hi1 = static_cast<uint32_t>(product1 >> 32);
+        uint32_t lo1 = static_cast<uint32_t>(product1);
+
+        counter = { hi1 ^ counter[1] ^ key[0], lo1, hi0 ^ counter[3] ^ key[1], lo0 };
+
+        key[0] += W0;
+        key[1] += W1;
+    }
+
+    return counter;
+}
+
+RandomStream::RandomStream() : RandomStream(0, 0)
+{
+}
+
+RandomStream::RandomStream(uint64_t seed, uint64_t streamId) : _seed(seed), _streamId(streamId), _drawCount(0), _cachedBlock(UINT64_MAX), _block()
+{
+}
+
+RandomStream::result_type RandomStream::operator()()
+{
+    uint64_t block = _drawCount / 4;
+
+    if (block != _cachedBlock)
+    {
+        std::array<uint32_t, 4> counter = {
+            static_cast<uint32_t>(block), static_cast<uint32_t>(block >> 32),
+            static_cast<uint32_t>(_streamId), static_cast<uint32_t>(_streamId >> 32) };
+        std::array<uint32_t, 2> key = { static_cast<uint32_t>(_seed), static_cast<uint32_t>(_seed >> 32) };
+
+        _block = philox4x32(counter, key);
+        _cachedBlock = block;
+    }
+
+    return _block[_drawCount++ % 4];
+}
+
+double RandomStream::uniform(double a, double b)
+{
+    uint64_t high = (*this)() >> 5;
+    uint64_t low = (*this)() >> 6;
+    double unit = (high * 67108864.0 + low) / 9007199254740992.0;
+
+    return a + (b - a) * unit;
+}
+
+double RandomStream::normal(double mean, double sigma)
+{
+    const double twoPi = 6.283185307179586;
+
+    // 1 - u keeps the logarithm away from zero
+    double u1 = 1.0 - uniform(0.0, 1.0);
+    double u2 = uniform(0.0, 1.0);
+
+    return mean + sigma * sqrt(-2.0 * log(u1)) * cos(twoPi * u2);
+}
+
+// 64-bit FNV-1a
+static uint64_t hashBytes(uint64_t hash, const void* data, size_t size)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ull;
+    }
+
+    return hash;
+}
+
+uint64_t makeStreamId(const std::string& domain, const std::string& name)
+{
+    uint64_t hash = hashBytes(0xCBF29CE484222325ull, domain.data(), domain.size());
+    hash = hashBytes(hash, "/", 1);
+    return hashBytes(hash, name.data(), name.size());
+}
+
+uint64_t makeStreamId(const std::string& domain, uint64_t index)
+{
+    unsigned char bytes[8];
+    for (int i = 0; i < 8; i++)
+    {
+        bytes[i] = static_cast<unsigned char>(index >> (8 * i));
+    }
+
+    uint64_t hash = hashBytes(0xCBF29CE484222325ull, domain.data(), domain.size());
+    hash = hashBytes(hash, "#", 1);
+    return hashBytes(hash, bytes, sizeof(bytes));
+}
+
+void setMasterSeed(uint64_t seed)
+{
+    masterSeed = seed;
+}
+
+uint64_t getMasterSeed()
+{
+    return masterSeed;
+}
+
+RandomStream makeRandomStream(const std::string& domain, const std::string& name)
+{
+    return RandomStream(masterSeed, makeStreamId(domain, name));
+}
+
+RandomStream makeRandomStream(const std::string& domain, uint64_t index)
+{
+    return RandomStream(masterSeed, makeStreamId(domain, index));
+}
@@ -1,9 +1,63 @@
 #ifndef RANDOM_GEN_H
 #define RANDOM_GEN_H
 
-#include <chrono>
-#include <random>
+#include <array>
+#include <cstdint>
+#include <string>
 
-extern std::mt19937 random_gen;
+// Philox4x32-10 counter-based generator (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3").
+// Output block n of a stream is a pure function of (key, counter), so any draw can be computed
+// independently of every other draw and of thread scheduling.
+std::array<uint32_t, 4> philox4x32(std::array<uint32_t, 4> counter, std::array<uint32_t, 2> key);
 
-#endif // RANDOM_GEN_H
\ No newline at end of file
+// An independent stream of random numbers derived from (master seed, stream id).
+// The master seed is the Philox key and the stream id fills the upper half of the counter,
+// so streams never overlap. Satisfies UniformRandomBitGenerator.
+class RandomStream
+{
+    public:
+        typedef uint32_t result_type;
+
+        RandomStream();
+        RandomStream(uint64_t seed, uint64_t streamId);
+        ~RandomStream() {}
+
+        static constexpr result_type min() { return 0; }
+        static constexpr result_type max() { return 0xFFFFFFFFu; }
+
+        result_type operator()();
+
+        // Uniform double in [a, b) built from 53 random bits. Unlike std::uniform_real_distribution
+        // the result is identical on every standard library.
+        double uniform(double a, double b);
+
+        // Normal deviate from the Box-Muller transform. Always consumes four 32-bit draws.
+        double normal(double mean, double sigma);
+
+        uint64_t getSeed() const { return _seed; }
+        uint64_t getStreamId() const { return _streamId; }
+
+        // The number of 32-bit values drawn so far. This is the only mutable state of the stream.
+        uint64_t getDrawCount() const { return _drawCount; }
+        void setDrawCount(uint64_t drawCount) { _drawCount = drawCount; _cachedBlock = UINT64_MAX; }
+
+    protected:
+        uint64_t _seed;
+        uint64_t _streamId;
+        uint64_t _drawCount;
+        uint64_t _cachedBlock;
+        std::array<uint32_t, 4> _block;
+};
+
+// Stream ids are a hash of an entity domain (e.g. "planet", "spacecraft") and the entity's name or index
+uint64_t makeStreamId(const std::string& domain, const std::string& name);
+uint64_t makeStreamId(const std::string& domain, uint64_t index);
+
+// The master seed of the run. Defaults to the system clock at startup.
+void setMasterSeed(uint64_t seed);
+uint64_t getMasterSeed();
+
+RandomStream makeRandomStream(const std::string& domain, const std::string& name);
+RandomStream makeRandomStream(const std::string& domain, uint64_t index);
+
+#endif // RANDOM_GEN_H